@@ -0,0 +1,438 @@
+#ifndef ASYNCDAO_HPP
+#define ASYNCDAO_HPP
+
+#if !(__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L))
+#error "AsyncDAO.hpp requires C++20 coroutines, compile with /std:c++20"
+#endif
+
+#include "Runtime.hpp"
+#include "UserDAO.hpp"
+#include "LoginDAO.hpp"
+#include "PasswordSecurity.hpp"
+#include "nlohmann\\json.hpp"
+#include <coroutine>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+template <typename T>
+class Task;
+
+namespace async_detail {
+
+    template <typename T>
+    using Stored = std::conditional_t<std::is_void_v<T>, char, T>;
+
+    struct TaskPromiseBase
+    {
+        std::coroutine_handle<> continuation = std::noop_coroutine();
+        std::exception_ptr error;
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        //hands control straight to whoever awaited the task instead of growing the stack
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+            {
+                return handle.promise().continuation;
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception()
+        {
+            error = std::current_exception();
+        }
+    };
+
+    template <typename T>
+    struct TaskPromise : TaskPromiseBase
+    {
+        std::optional<T> value;
+
+        Task<T> get_return_object();
+
+        void return_value(T result)
+        {
+            value = std::move(result);
+        }
+    };
+
+    template <>
+    struct TaskPromise<void> : TaskPromiseBase
+    {
+        Task<void> get_return_object();
+
+        void return_void() {}
+    };
+
+    //coroutine that starts at once and frees itself when done, used to drive a Task from plain code
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            DetachedTask get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+}
+
+/// <summary>
+/// lazily started coroutine producing a T. awaiting it starts it and resumes the awaiting
+/// coroutine when it finishes, on whatever thread it finished on
+/// </summary>
+template <typename T = void>
+class Task {
+public:
+
+    using promise_type = async_detail::TaskPromise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> _handle) : handle(_handle) {}
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    ~Task()
+    {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume()
+    {
+        if (handle.promise().error) {
+            std::rethrow_exception(handle.promise().error);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*handle.promise().value);
+        }
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <typename T>
+Task<T> async_detail::TaskPromise<T>::get_return_object()
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> async_detail::TaskPromise<void>::get_return_object()
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/// <summary>
+/// runs a task to completion from code that is not a coroutine, blocking the calling thread.
+/// meant for main and tests, business logic awaits instead
+/// </summary>
+template <typename T>
+T syncWait(Task<T> task)
+{
+    std::promise<T> done;
+    std::future<T> result = done.get_future();
+
+    //the task's frame is destroyed before the waiting thread is released
+    [](Task<T> inner, std::promise<T>& finished) -> async_detail::DetachedTask {
+        std::optional<async_detail::Stored<T>> value;
+        std::exception_ptr error;
+        {
+            Task<T> owned = std::move(inner);
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    co_await owned;
+                    value.emplace();
+                }
+                else {
+                    value.emplace(co_await owned);
+                }
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        if (error) {
+            finished.set_exception(error);
+        }
+        else if constexpr (std::is_void_v<T>) {
+            finished.set_value();
+        }
+        else {
+            finished.set_value(std::move(*value));
+        }
+    }(std::move(task), done);
+
+    return result.get();
+}
+
+/// <summary>
+/// awaitable that runs work on a connection of a DatabaseExecutor, then resumes the awaiting
+/// coroutine on the compute pool so database threads only ever run statements. pending, when
+/// given, counts it from suspension until the resumed coroutine returns control, which lets the
+/// owner of the executors wait for every continuation before stopping them
+/// </summary>
+template <typename Result>
+class DatabaseAwaitable {
+public:
+
+    DatabaseAwaitable(DatabaseExecutor& _executor, ThreadPool& _resume_pool, std::function<Result(DatabaseManager&)> _work,
+        std::atomic<size_t>* _pending = nullptr)
+        : executor(&_executor), resume_pool(&_resume_pool), work(std::move(_work)), pending(_pending) {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting)
+    {
+        if (pending != nullptr) {
+            pending->fetch_add(1);
+        }
+        executor->post([this, awaiting](DatabaseManager& connection) {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    work(connection);
+                    value.emplace();
+                }
+                else {
+                    value.emplace(work(connection));
+                }
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            //the awaitable lives in the coroutine frame and may be gone once it resumes
+            resume_pool->post([awaiting, pending = pending] {
+                awaiting.resume();
+                if (pending != nullptr) {
+                    pending->fetch_sub(1);
+                }
+            });
+        });
+    }
+
+    Result await_resume()
+    {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if constexpr (!std::is_void_v<Result>) {
+            return std::move(*value);
+        }
+    }
+
+private:
+    DatabaseExecutor* executor;
+    ThreadPool* resume_pool;
+    std::function<Result(DatabaseManager&)> work;
+    std::atomic<size_t>* pending;
+    std::optional<async_detail::Stored<Result>> value;
+    std::exception_ptr error;
+};
+
+/// <summary>
+/// awaitable that runs cpu bound work on the compute pool and continues there, counted in
+/// pending like DatabaseAwaitable
+/// </summary>
+template <typename Result>
+class ComputeAwaitable {
+public:
+
+    ComputeAwaitable(ThreadPool& _pool, std::function<Result()> _work, std::atomic<size_t>* _pending = nullptr)
+        : pool(&_pool), work(std::move(_work)), pending(_pending) {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting)
+    {
+        if (pending != nullptr) {
+            pending->fetch_add(1);
+        }
+        pool->post([this, awaiting, pending = pending] {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    work();
+                    value.emplace();
+                }
+                else {
+                    value.emplace(work());
+                }
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            awaiting.resume();
+            if (pending != nullptr) {
+                pending->fetch_sub(1);
+            }
+        });
+    }
+
+    Result await_resume()
+    {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if constexpr (!std::is_void_v<Result>) {
+            return std::move(*value);
+        }
+    }
+
+private:
+    ThreadPool* pool;
+    std::function<Result()> work;
+    std::atomic<size_t>* pending;
+    std::optional<async_detail::Stored<Result>> value;
+    std::exception_ptr error;
+};
+
+/// <summary>
+/// awaitable DAO operations over the executors of the Runtime layer: statements run on the
+/// reader pool or the writer queue, hashing on the compute pool, and a coroutine awaiting them
+/// holds no thread while it waits. a login reads top to bottom:
+///     auto user = co_await async_dao.retrieveUserByName(name);
+///     bool valid = co_await async_dao.verifyPassword(user["user_passhash"], password, user["user_salt"]);
+///     co_await async_dao.recordLogin(user["user_id"], valid);
+/// </summary>
+class AsyncDAO {
+public:
+
+    AsyncDAO(DatabaseExecutor& _readers, DatabaseExecutor& _writer, ThreadPool& _compute, std::atomic<size_t>* _pending = nullptr)
+        : readers(&_readers), writer(&_writer), compute_pool(&_compute), pending(_pending) {}
+
+    //the executors of a running ApplicationController, which waits for these awaitables before it stops them
+    explicit AsyncDAO(ApplicationController& controller)
+        : AsyncDAO(controller.readerPool(), controller.writerQueue(), controller.computePool(), &controller.pendingAwaits()) {}
+
+    // Generic Operations ---------------------------------------------------------------------------------
+
+    template <typename F>
+    DatabaseAwaitable<std::invoke_result_t<F, DatabaseManager&>> read(F&& work)
+    {
+        return { *readers, *compute_pool, std::forward<F>(work), pending };
+    }
+
+    template <typename F>
+    DatabaseAwaitable<std::invoke_result_t<F, DatabaseManager&>> write(F&& work)
+    {
+        return { *writer, *compute_pool, std::forward<F>(work), pending };
+    }
+
+    template <typename F>
+    ComputeAwaitable<std::invoke_result_t<F>> compute(F&& work)
+    {
+        return { *compute_pool, std::forward<F>(work), pending };
+    }
+
+    // DAO Operations -------------------------------------------------------------------------------------
+
+    //the user row with user_id added, null when no user has the name
+    DatabaseAwaitable<nlohmann::json> retrieveUserByName(std::string username)
+    {
+        return read([username = std::move(username)](DatabaseManager& connection) -> nlohmann::json {
+            UserDAO users(connection);
+            std::optional<int> user_id = users.getIdGivenUsername(username);
+            if (!user_id.has_value()) {
+                return nullptr;
+            }
+            nlohmann::json user = users.retrieveRecordById(user_id.value());
+            user["user_id"] = user_id.value();
+            return user;
+        });
+    }
+
+    ComputeAwaitable<std::string> hashPassword(std::string password, std::string salt)
+    {
+        return compute([password = std::move(password), salt = std::move(salt)] {
+            return PasswordSecurity::hash_password(password, salt);
+        });
+    }
+
+    ComputeAwaitable<bool> verifyPassword(std::string hashed, std::string password, std::string salt)
+    {
+        return compute([hashed = std::move(hashed), password = std::move(password), salt = std::move(salt)] {
+            return PasswordSecurity::validate_password(hashed, password, salt);
+        });
+    }
+
+    DatabaseAwaitable<bool> recordLogin(int user_id, bool success)
+    {
+        return write([user_id, success](DatabaseManager& connection) {
+            LoginDAO logins(connection);
+            return logins.insertRecord({ {"login_user", std::to_string(user_id)}, {"login_success", success ? 1 : 0} });
+        });
+    }
+
+    /// <summary>
+    /// look up the user, verify the password and record the attempt
+    /// </summary>
+    /// <returns>the user's id when the password matches</returns>
+    Task<std::optional<int>> login(std::string username, std::string password)
+    {
+        nlohmann::json user = co_await retrieveUserByName(std::move(username));
+        if (user.is_null() || user.value("user_visibility", 1) == 0) {
+            co_return std::nullopt;
+        }
+
+        const int user_id = user["user_id"].get<int>();
+        bool valid = co_await verifyPassword(user["user_passhash"].get<std::string>(), std::move(password), user["user_salt"].get<std::string>());
+        co_await recordLogin(user_id, valid);
+
+        if (!valid) {
+            co_return std::nullopt;
+        }
+        co_return user_id;
+    }
+
+private:
+    DatabaseExecutor* readers;
+    DatabaseExecutor* writer;
+    ThreadPool* compute_pool;
+    std::atomic<size_t>* pending;
+};
+
+#endif //ASYNCDAO_HPP
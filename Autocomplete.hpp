@@ -0,0 +1,332 @@
+#ifndef AUTOCOMPLETE_HPP
+#define AUTOCOMPLETE_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include "GenericDAO.hpp"
+#include "ElementGuid.hpp"
+#include "nlohmann\\json.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+/// <summary>
+/// type-ahead over one set of names. every distinct name is interned once with a reference
+/// count, so a name shared by many rows such as "Top shelf" costs one entry, and the interned
+/// ids are kept in an array sorted by the case folded name. the completions of a prefix are a
+/// contiguous run of that array found with two binary searches
+/// </summary>
+class PrefixIndex {
+public:
+
+    void clear()
+    {
+        terms.clear();
+        sorted_terms.clear();
+        term_index.clear();
+        free_terms.clear();
+    }
+
+    //names added in bulk are sorted once instead of inserted one at a time
+    void build(const std::vector<std::string>& names)
+    {
+        clear();
+        for (const std::string& name : names) {
+            uint32_t term;
+            if (intern(name, term)) {
+                sorted_terms.push_back(term);
+            }
+        }
+        std::sort(sorted_terms.begin(), sorted_terms.end(), [this](uint32_t left, uint32_t right) { return lessTerm(left, right); });
+    }
+
+    void add(const std::string& name)
+    {
+        uint32_t term;
+        if (intern(name, term)) {
+            sorted_terms.insert(std::lower_bound(sorted_terms.begin(), sorted_terms.end(), term,
+                [this](uint32_t left, uint32_t right) { return lessTerm(left, right); }), term);
+        }
+    }
+
+    //the name disappears from completions once no row uses it
+    void remove(const std::string& name)
+    {
+        auto found = term_index.find(name);
+        if (found == term_index.end() || --terms[found->second].references > 0) {
+            return;
+        }
+
+        uint32_t term = found->second;
+        auto position = std::lower_bound(sorted_terms.begin(), sorted_terms.end(), term,
+            [this](uint32_t left, uint32_t right) { return lessTerm(left, right); });
+        if (position != sorted_terms.end() && *position == term) {
+            sorted_terms.erase(position);
+        }
+        term_index.erase(found);
+        terms[term].folded.clear();
+        terms[term].name.clear();
+        free_terms.push_back(term);
+    }
+
+    /// <summary>
+    /// up to limit names starting with the prefix, ignoring case, in alphabetical order
+    /// </summary>
+    std::vector<std::string> complete(const std::string& prefix, size_t limit = 10) const
+    {
+        std::vector<std::string> completions;
+        const std::string folded_prefix = fold(prefix);
+
+        auto first = std::lower_bound(sorted_terms.begin(), sorted_terms.end(), folded_prefix,
+            [this](uint32_t term, const std::string& search) { return terms[term].folded < search; });
+
+        for (auto current = first; current != sorted_terms.end() && completions.size() < limit; ++current) {
+            const std::string& folded = terms[*current].folded;
+            if (folded.compare(0, folded_prefix.size(), folded_prefix) != 0) {
+                break;
+            }
+            completions.push_back(terms[*current].name);
+        }
+        return completions;
+    }
+
+    size_t size() const
+    {
+        return sorted_terms.size();
+    }
+
+private:
+
+    struct Term
+    {
+        std::string name;
+        std::string folded;
+        uint32_t references;
+    };
+
+    //ASCII case folding, bytes of multi byte characters compare as they are
+    static std::string fold(const std::string& name)
+    {
+        std::string folded = name;
+        for (char& character : folded) {
+            if (character >= 'A' && character <= 'Z') {
+                character = static_cast<char>(character - 'A' + 'a');
+            }
+        }
+        return folded;
+    }
+
+    //names equal when folded are ordered by their original spelling so the order is total
+    bool lessTerm(uint32_t left, uint32_t right) const
+    {
+        int compared = terms[left].folded.compare(terms[right].folded);
+        return compared != 0 ? compared < 0 : terms[left].name < terms[right].name;
+    }
+
+    //returns true when the name is new and its term still has to be placed in sorted_terms
+    bool intern(const std::string& name, uint32_t& term)
+    {
+        auto found = term_index.find(name);
+        if (found != term_index.end()) {
+            ++terms[found->second].references;
+            term = found->second;
+            return false;
+        }
+
+        if (!free_terms.empty()) {
+            term = free_terms.back();
+            free_terms.pop_back();
+            terms[term] = { name, fold(name), 1 };
+        }
+        else {
+            term = static_cast<uint32_t>(terms.size());
+            terms.push_back({ name, fold(name), 1 });
+        }
+        term_index.emplace(name, term);
+        return true;
+    }
+
+    std::vector<Term> terms;
+    std::vector<uint32_t> sorted_terms;
+    std::unordered_map<std::string, uint32_t> term_index;
+    std::vector<uint32_t> free_terms;
+};
+
+/// <summary>
+/// completions for user names, element names and category names, loaded once and then
+/// following UserDAO, ElementDAO and CategoryDAO writes as a RecordObserver so no keystroke
+/// reaches sqlite. hidden rows are left out
+/// </summary>
+class Autocomplete : public RecordObserver {
+public:
+
+    bool load(DatabaseManager& db_manager)
+    {
+        user_names.clear();
+        element_names.clear();
+        category_names.clear();
+
+        std::vector<std::string> names;
+        bool loaded = loadNames(db_manager, "SELECT user_id, user_name FROM Users WHERE user_visibility = 1;",
+            [&](sqlite3_stmt* row) {
+                names.push_back(text(row, 1));
+                user_names[sqlite3_column_int(row, 0)] = names.back();
+            });
+        users.build(names);
+
+        names.clear();
+        loaded = loaded && loadNames(db_manager, "SELECT element_guid, element_name FROM Element WHERE element_visibility = 1;",
+            [&](sqlite3_stmt* row) {
+                auto guid = ElementGuid::decode(text(row, 0));
+                if (guid.has_value()) {
+                    names.push_back(text(row, 1));
+                    element_names[guid.value()] = names.back();
+                }
+            });
+        elements.build(names);
+
+        names.clear();
+        loaded = loaded && loadNames(db_manager, "SELECT category_id, category_name FROM Categories WHERE category_visibility = 1;",
+            [&](sqlite3_stmt* row) {
+                names.push_back(text(row, 1));
+                category_names[sqlite3_column_int(row, 0)] = names.back();
+            });
+        categories.build(names);
+
+        return loaded;
+    }
+
+    std::vector<std::string> completeUserName(const std::string& prefix, size_t limit = 10) const
+    {
+        return users.complete(prefix, limit);
+    }
+
+    std::vector<std::string> completeElementName(const std::string& prefix, size_t limit = 10) const
+    {
+        return elements.complete(prefix, limit);
+    }
+
+    std::vector<std::string> completeCategoryName(const std::string& prefix, size_t limit = 10) const
+    {
+        return categories.complete(prefix, limit);
+    }
+
+    // Incremental Updates --------------------------------------------------------------------------------
+
+    void onRecordInserted(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name == "Users" && record.contains("user_id")) {
+            setName(users, user_names, record["user_id"].get<int>(), record["user_name"].get<std::string>());
+        }
+        else if (table_name == "Element") {
+            auto guid = ElementGuid::decode(record["element_guid"].get<std::string>());
+            if (guid.has_value()) {
+                setName(elements, element_names, guid.value(), record["element_name"].get<std::string>());
+            }
+        }
+        else if (table_name == "Categories") {
+            setName(categories, category_names, record["category_id"].get<int>(), record["category_name"].get<std::string>());
+        }
+    }
+
+    //updates carry the whole row, a rename replaces the old name and hiding removes it
+    void onRecordUpdated(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name == "Users" && record.contains("user_id")) {
+            updateName(users, user_names, record["user_id"].get<int>(), record, "user_name", "user_visibility");
+        }
+        else if (table_name == "Element" && record.contains("element_guid")) {
+            auto guid = ElementGuid::decode(record["element_guid"].get<std::string>());
+            if (guid.has_value()) {
+                updateName(elements, element_names, guid.value(), record, "element_name", "element_visibility");
+            }
+        }
+        else if (table_name == "Categories" && record.contains("category_id")) {
+            updateName(categories, category_names, record["category_id"].get<int>(), record, "category_name", "category_visibility");
+        }
+    }
+
+    void onRecordDeleted(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name == "Element") {
+            auto guid = ElementGuid::decode(record["element_guid"].get<std::string>());
+            if (guid.has_value()) {
+                removeName(elements, element_names, guid.value());
+            }
+        }
+        else if (table_name == "Categories") {
+            removeName(categories, category_names, record["category_id"].get<int>());
+        }
+    }
+
+private:
+
+    static std::string text(sqlite3_stmt* row, int column)
+    {
+        const unsigned char* value = sqlite3_column_text(row, column);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+
+    template <typename RowHandler>
+    static bool loadNames(DatabaseManager& db_manager, const std::string& sql, RowHandler handle)
+    {
+        if (!db_manager.prepareStatement(sql)) {
+            return false;
+        }
+        sqlite3_stmt* prepared_statement = db_manager.getPreparedStatement();
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            handle(prepared_statement);
+        }
+        sqlite3_finalize(prepared_statement);
+        return true;
+    }
+
+    template <typename Key>
+    static void setName(PrefixIndex& index, std::unordered_map<Key, std::string>& names, Key key, const std::string& name)
+    {
+        auto current = names.find(key);
+        if (current != names.end()) {
+            if (current->second == name) {
+                return;
+            }
+            index.remove(current->second);
+        }
+        names[key] = name;
+        index.add(name);
+    }
+
+    template <typename Key>
+    static void removeName(PrefixIndex& index, std::unordered_map<Key, std::string>& names, Key key)
+    {
+        auto current = names.find(key);
+        if (current != names.end()) {
+            index.remove(current->second);
+            names.erase(current);
+        }
+    }
+
+    template <typename Key>
+    static void updateName(PrefixIndex& index, std::unordered_map<Key, std::string>& names, Key key,
+        const nlohmann::json& record, const char* name_field, const char* visibility_field)
+    {
+        if (record.contains(visibility_field) && record[visibility_field].get<int>() == 0) {
+            removeName(index, names, key);
+        }
+        else if (record.contains(name_field)) {
+            setName(index, names, key, record[name_field].get<std::string>());
+        }
+    }
+
+    PrefixIndex users;
+    PrefixIndex elements;
+    PrefixIndex categories;
+
+    //current name of every indexed row, needed to withdraw it on rename or removal
+    std::unordered_map<int, std::string> user_names;
+    std::unordered_map<uint32_t, std::string> element_names;
+    std::unordered_map<int, std::string> category_names;
+};
+
+#endif //AUTOCOMPLETE_HPP
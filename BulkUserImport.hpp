@@ -0,0 +1,403 @@
+#ifndef BULKUSERIMPORT_HPP
+#define BULKUSERIMPORT_HPP
+
+#include "DatabaseManager.hpp"
+#include "GenericDAO.hpp"
+#include "PasswordSecurity.hpp"
+#include "ThreadPool.hpp"
+#include "nlohmann\\json.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <future>
+
+/// <summary>
+/// creates users in bulk from a JSON Lines or CSV file. rows are streamed in chunks,
+/// validated, salted and hashed on a thread pool while the previous chunk is written,
+/// and inserted through one reused prepared INSERT inside a transaction per chunk.
+/// a bad row is reported and skipped without aborting the rest of the file. observers of
+/// the connection, and any added here, hear of each chunk's users once it has committed
+/// </summary>
+class BulkUserImport {
+public:
+
+    enum class FileFormat
+    {
+        JSONL,
+        CSV
+    };
+
+    struct RowReject
+    {
+        size_t line_number;
+        std::string reason;
+    };
+
+    struct ImportReport
+    {
+        size_t rows_read = 0;
+        size_t rows_imported = 0;
+        std::vector<RowReject> rejects;
+        double elapsed_seconds = 0.0;
+
+        double rowsPerSecond() const
+        {
+            return elapsed_seconds > 0.0 ? rows_imported / elapsed_seconds : 0.0;
+        }
+    };
+
+    BulkUserImport(DatabaseManager& _db_manager, ThreadPool& _hash_pool, size_t _chunk_rows = 1000)
+        : db_manager(&_db_manager), hash_pool(&_hash_pool), chunk_rows(_chunk_rows == 0 ? 1 : _chunk_rows),
+        observers(_db_manager.getRecordObservers()) {}
+
+    void addObserver(RecordObserver* observer)
+    {
+        observers.push_back(observer);
+    }
+
+    /// <summary>
+    /// imports every row of the file, CSV files must start with a header naming the columns.
+    /// recognised fields are user_name, user_password, user_legalname, user_phonenumber,
+    /// user_emailaddress, user_description and user_permission
+    /// </summary>
+    ImportReport importFile(const std::string& file_path, FileFormat format)
+    {
+        ImportReport report;
+        auto start = std::chrono::steady_clock::now();
+
+        std::ifstream input(file_path);
+        if (!input) {
+            report.rejects.push_back({ 0, "cannot open " + file_path });
+            return report;
+        }
+
+        size_t line_number = 0;
+        std::vector<std::string> csv_header;
+        if (format == FileFormat::CSV) {
+            std::string header_line;
+            if (std::getline(input, header_line)) {
+                ++line_number;
+                csv_header = splitCsvLine(header_line);
+            }
+        }
+
+        if (!db_manager->prepareStatement(
+            "INSERT INTO Users (user_name, user_salt, user_passhash, user_legalname, user_phonenumber, "
+            "user_emailaddress, user_description, user_permission, user_visibility, user_timestamp) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);"))
+        {
+            report.rejects.push_back({ 0, "cannot prepare insert" });
+            return report;
+        }
+
+        //hashing of the next chunk overlaps with writing of the current one
+        std::future<std::vector<ImportRow>> pending_chunk;
+        bool has_pending = false;
+
+        while (true)
+        {
+            std::vector<ImportRow> chunk = readChunk(input, format, csv_header, line_number, report);
+            bool has_chunk = !chunk.empty();
+
+            std::future<std::vector<ImportRow>> next_chunk;
+            if (has_chunk) {
+                next_chunk = hashChunk(std::move(chunk));
+            }
+
+            if (has_pending) {
+                writeChunk(pending_chunk.get(), report);
+            }
+
+            if (!has_chunk) {
+                break;
+            }
+            pending_chunk = std::move(next_chunk);
+            has_pending = true;
+        }
+
+        db_manager->finalizePrepared();
+
+        report.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return report;
+    }
+
+    static void printReport(const ImportReport& report, std::ostream& output)
+    {
+        output << "Imported " << report.rows_imported << " of " << report.rows_read << " rows in "
+            << report.elapsed_seconds << "s (" << static_cast<long long>(report.rowsPerSecond()) << " rows/sec)" << std::endl;
+        for (const RowReject& reject : report.rejects) {
+            output << "  line " << reject.line_number << ": " << reject.reason << std::endl;
+        }
+    }
+
+private:
+
+    struct ImportRow
+    {
+        size_t line_number;
+        nlohmann::json fields;
+        std::string salt;
+        std::string passhash;
+    };
+
+    std::vector<ImportRow> readChunk(std::ifstream& input, FileFormat format, const std::vector<std::string>& csv_header,
+        size_t& line_number, ImportReport& report)
+    {
+        std::vector<ImportRow> chunk;
+        std::string line;
+
+        while (chunk.size() < chunk_rows && std::getline(input, line))
+        {
+            ++line_number;
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+            ++report.rows_read;
+
+            ImportRow row{ line_number, nlohmann::json::object(), "", "" };
+            if (format == FileFormat::JSONL) {
+                row.fields = nlohmann::json::parse(line, nullptr, false);
+                if (!row.fields.is_object()) {
+                    report.rejects.push_back({ line_number, "malformed JSON object" });
+                    continue;
+                }
+            }
+            else {
+                std::vector<std::string> values = splitCsvLine(line);
+                if (values.size() != csv_header.size()) {
+                    report.rejects.push_back({ line_number, "expected " + std::to_string(csv_header.size()) + " columns" });
+                    continue;
+                }
+                for (size_t column = 0; column < values.size(); ++column) {
+                    if (!values[column].empty()) {
+                        row.fields[csv_header[column]] = values[column];
+                    }
+                }
+            }
+
+            std::string reason = validateRow(row.fields);
+            if (!reason.empty()) {
+                report.rejects.push_back({ line_number, reason });
+                continue;
+            }
+
+            chunk.push_back(std::move(row));
+        }
+
+        return chunk;
+    }
+
+    //splits the chunk into one slice per worker, each slice salts and hashes its rows
+    std::future<std::vector<ImportRow>> hashChunk(std::vector<ImportRow> chunk)
+    {
+        auto shared_chunk = std::make_shared<std::vector<ImportRow>>(std::move(chunk));
+        const size_t slice_count = std::min(hash_pool->size(), shared_chunk->size());
+        const size_t slice_rows = (shared_chunk->size() + slice_count - 1) / slice_count;
+
+        auto slices = std::make_shared<std::vector<std::future<void>>>();
+        for (size_t first = 0; first < shared_chunk->size(); first += slice_rows) {
+            size_t last = std::min(first + slice_rows, shared_chunk->size());
+            slices->push_back(hash_pool->submit([shared_chunk, first, last] {
+                for (size_t index = first; index < last; ++index) {
+                    ImportRow& row = (*shared_chunk)[index];
+                    row.salt = PasswordSecurity::generate_salt();
+                    row.passhash = PasswordSecurity::hash_password(row.fields["user_password"].get<std::string>(), row.salt);
+                }
+            }));
+        }
+
+        //deferred so the caller only blocks on the slices when it is ready to write the chunk
+        return std::async(std::launch::deferred, [shared_chunk, slices] {
+            for (std::future<void>& slice : *slices) {
+                slice.get();
+            }
+            return std::move(*shared_chunk);
+        });
+    }
+
+    void writeChunk(const std::vector<ImportRow>& chunk, ImportReport& report)
+    {
+        const int timestamp = static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+
+        if (!db_manager->beginTransaction()) {
+            for (const ImportRow& row : chunk) {
+                report.rejects.push_back({ row.line_number, "cannot begin transaction" });
+            }
+            return;
+        }
+
+        //accepted rows are only imported once the chunk commits
+        std::vector<size_t> accepted_lines;
+        std::vector<nlohmann::json> inserted;
+        for (const ImportRow& row : chunk)
+        {
+            db_manager->bindParameter<std::string>(1, row.fields["user_name"].get<std::string>());
+            db_manager->bindParameter<std::string>(2, row.salt);
+            db_manager->bindParameter<std::string>(3, row.passhash);
+
+            db_manager->bindOptional<std::string>(4, row.fields, "user_legalname", std::nullopt);
+            db_manager->bindOptional<std::string>(5, row.fields, "user_phonenumber", std::nullopt);
+            db_manager->bindOptional<std::string>(6, row.fields, "user_emailaddress", std::nullopt);
+            db_manager->bindOptional<std::string>(7, row.fields, "user_description", std::nullopt);
+
+            db_manager->bindParameter<int>(8, permissionOf(row.fields));
+            db_manager->bindParameter<int>(9, 1);
+            db_manager->bindParameter<int>(10, timestamp);
+
+            //a failed row such as a duplicate user_name only rolls back its own statement
+            if (db_manager->executeAndReset()) {
+                accepted_lines.push_back(row.line_number);
+                if (!observers.empty()) {
+                    inserted.push_back(insertedRecord(row, db_manager->getLastInsertRowId(), timestamp));
+                }
+            }
+            else {
+                report.rejects.push_back({ row.line_number, db_manager->getLastError() });
+            }
+        }
+
+        //rows rejected above are already reported
+        if (!db_manager->commitTransaction()) {
+            db_manager->rollbackTransaction();
+            for (size_t line_number : accepted_lines) {
+                report.rejects.push_back({ line_number, "chunk transaction failed to commit" });
+            }
+            return;
+        }
+
+        report.rows_imported += accepted_lines.size();
+        if (!inserted.empty()) {
+            db_manager->runAfterCommit([observers = observers, inserted = std::move(inserted)]() {
+                for (const nlohmann::json& record : inserted) {
+                    for (RecordObserver* observer : observers) {
+                        observer->onRecordInserted("Users", record);
+                    }
+                }
+            });
+        }
+    }
+
+    //the row as UserDAO reports an insert, without the password
+    static nlohmann::json insertedRecord(const ImportRow& row, sqlite3_int64 user_id, int timestamp)
+    {
+        nlohmann::json record = row.fields;
+        record.erase("user_password");
+        record["user_id"] = static_cast<int>(user_id);
+        record["user_salt"] = row.salt;
+        record["user_passhash"] = row.passhash;
+        record["user_permission"] = permissionOf(row.fields);
+        record["user_visibility"] = 1;
+        record["user_timestamp"] = timestamp;
+        return record;
+    }
+
+    //returns an empty string for a valid row, otherwise the reason it is rejected
+    static std::string validateRow(nlohmann::json& fields)
+    {
+        for (auto field = fields.begin(); field != fields.end(); ++field) {
+            if (field.key() != "user_permission" && !field.value().is_string()) {
+                return field.key() + " must be a string";
+            }
+        }
+
+        if (!fields.contains("user_name") || fields["user_name"].get<std::string>().empty()) {
+            return "missing user_name";
+        }
+        if (fields["user_name"].get<std::string>().size() > 32) {
+            return "user_name longer than 32 characters";
+        }
+        if (!fields.contains("user_password") || fields["user_password"].get<std::string>().empty()) {
+            return "missing user_password";
+        }
+
+        if (fields.contains("user_emailaddress")) {
+            const std::string& email = fields["user_emailaddress"].get_ref<const std::string&>();
+            size_t at = email.find('@');
+            if (at == std::string::npos || email.find('.', at) == std::string::npos) {
+                return "malformed user_emailaddress";
+            }
+        }
+
+        if (fields.contains("user_phonenumber")) {
+            const std::string& phone = fields["user_phonenumber"].get_ref<const std::string&>();
+            if (phone.size() > 15 || phone.find_first_not_of("0123456789") != std::string::npos) {
+                return "user_phonenumber must be at most 15 digits";
+            }
+        }
+
+        if (fields.contains("user_permission")) {
+            int permission = permissionOf(fields);
+            if (permission < 0 || permission > 3) {
+                return "user_permission must be between 0 and 3";
+            }
+        }
+
+        return "";
+    }
+
+    //permission arrives as a number from JSON Lines and as text from CSV, BASE when absent
+    static int permissionOf(const nlohmann::json& fields)
+    {
+        if (!fields.contains("user_permission")) {
+            return 1;
+        }
+
+        const nlohmann::json& permission = fields["user_permission"];
+        if (permission.is_number_integer()) {
+            return permission.get<int>();
+        }
+        if (permission.is_string()) {
+            const std::string& text = permission.get_ref<const std::string&>();
+            if (!text.empty() && text.find_first_not_of("0123456789") == std::string::npos && text.size() < 3) {
+                return std::stoi(text);
+            }
+        }
+        return -1;
+    }
+
+    //comma separated fields, double quoted fields may contain commas and "" escapes
+    static std::vector<std::string> splitCsvLine(const std::string& line)
+    {
+        std::vector<std::string> values(1);
+        bool quoted = false;
+
+        for (size_t i = 0; i < line.size(); ++i) {
+            char character = line[i];
+            if (quoted) {
+                if (character == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                    values.back() += '"';
+                    ++i;
+                }
+                else if (character == '"') {
+                    quoted = false;
+                }
+                else {
+                    values.back() += character;
+                }
+            }
+            else if (character == '"') {
+                quoted = true;
+            }
+            else if (character == ',') {
+                values.emplace_back();
+            }
+            else {
+                values.back() += character;
+            }
+        }
+
+        return values;
+    }
+
+    DatabaseManager* db_manager;
+    ThreadPool* hash_pool;
+    size_t chunk_rows;
+    std::vector<RecordObserver*> observers;
+};
+
+#endif //BULKUSERIMPORT_HPP
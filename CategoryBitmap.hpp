@@ -0,0 +1,427 @@
+#ifndef CATEGORYBITMAP_HPP
+#define CATEGORYBITMAP_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/// <summary>
+/// compressed set of 32 bit ordinals in the roaring layout: values are grouped by their
+/// upper 16 bits into containers, a container holding up to 4096 values keeps them as a
+/// sorted array and a fuller one switches to a 65536 bit bitmap. bitmap against bitmap
+/// operations are straight loops over 64 bit words that the compiler vectorizes
+/// </summary>
+class CategoryBitmap {
+public:
+
+    bool contains(uint32_t value) const
+    {
+        const Container* container = findContainer(highBits(value));
+        if (container == nullptr) {
+            return false;
+        }
+        uint16_t low = lowBits(value);
+        if (container->isBitmap()) {
+            return (container->words[low >> 6] >> (low & 63)) & 1;
+        }
+        return std::binary_search(container->values.begin(), container->values.end(), low);
+    }
+
+    //returns false when the value was already present
+    bool add(uint32_t value)
+    {
+        Container& container = containerFor(highBits(value));
+        uint16_t low = lowBits(value);
+
+        if (container.isBitmap()) {
+            uint64_t bit = uint64_t(1) << (low & 63);
+            if (container.words[low >> 6] & bit) {
+                return false;
+            }
+            container.words[low >> 6] |= bit;
+            ++container.count;
+            return true;
+        }
+
+        auto position = std::lower_bound(container.values.begin(), container.values.end(), low);
+        if (position != container.values.end() && *position == low) {
+            return false;
+        }
+        container.values.insert(position, low);
+        ++container.count;
+        if (container.count > array_limit) {
+            toBitmap(container);
+        }
+        return true;
+    }
+
+    //returns false when the value was not present
+    bool remove(uint32_t value)
+    {
+        auto position = lowerBound(highBits(value));
+        if (position == containers.end() || position->key != highBits(value)) {
+            return false;
+        }
+        Container& container = *position;
+        uint16_t low = lowBits(value);
+
+        if (container.isBitmap()) {
+            uint64_t bit = uint64_t(1) << (low & 63);
+            if (!(container.words[low >> 6] & bit)) {
+                return false;
+            }
+            container.words[low >> 6] &= ~bit;
+            --container.count;
+        }
+        else {
+            auto found = std::lower_bound(container.values.begin(), container.values.end(), low);
+            if (found == container.values.end() || *found != low) {
+                return false;
+            }
+            container.values.erase(found);
+            --container.count;
+        }
+
+        if (container.count == 0) {
+            containers.erase(position);
+        }
+        else if (container.isBitmap() && container.count <= array_limit) {
+            toArray(container);
+        }
+        return true;
+    }
+
+    size_t cardinality() const
+    {
+        size_t total = 0;
+        for (const Container& container : containers) {
+            total += container.count;
+        }
+        return total;
+    }
+
+    bool empty() const
+    {
+        return containers.empty();
+    }
+
+    void clear()
+    {
+        containers.clear();
+    }
+
+    //calls visit(value) for every value in ascending order
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        for (const Container& container : containers)
+        {
+            uint32_t base = uint32_t(container.key) << 16;
+            if (!container.isBitmap()) {
+                for (uint16_t low : container.values) {
+                    visit(base | low);
+                }
+                continue;
+            }
+            for (size_t word = 0; word < words_per_bitmap; ++word) {
+                uint64_t bits = container.words[word];
+                while (bits != 0) {
+                    visit(base | uint32_t(word * 64 + countTrailingZeros(bits)));
+                    bits &= bits - 1;
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> toVector() const
+    {
+        std::vector<uint32_t> values;
+        values.reserve(cardinality());
+        forEach([&](uint32_t value) { values.push_back(value); });
+        return values;
+    }
+
+    // Set Operations -------------------------------------------------------------------------------------
+
+    static CategoryBitmap intersect(const CategoryBitmap& left, const CategoryBitmap& right)
+    {
+        CategoryBitmap result;
+        auto left_it = left.containers.begin();
+        auto right_it = right.containers.begin();
+
+        while (left_it != left.containers.end() && right_it != right.containers.end())
+        {
+            if (left_it->key < right_it->key) {
+                ++left_it;
+            }
+            else if (right_it->key < left_it->key) {
+                ++right_it;
+            }
+            else {
+                Container container = intersectContainers(*left_it, *right_it);
+                if (container.count > 0) {
+                    result.containers.push_back(std::move(container));
+                }
+                ++left_it;
+                ++right_it;
+            }
+        }
+        return result;
+    }
+
+    static CategoryBitmap unite(const CategoryBitmap& left, const CategoryBitmap& right)
+    {
+        CategoryBitmap result;
+        auto left_it = left.containers.begin();
+        auto right_it = right.containers.begin();
+
+        while (left_it != left.containers.end() || right_it != right.containers.end())
+        {
+            if (right_it == right.containers.end() || (left_it != left.containers.end() && left_it->key < right_it->key)) {
+                result.containers.push_back(*left_it++);
+            }
+            else if (left_it == left.containers.end() || right_it->key < left_it->key) {
+                result.containers.push_back(*right_it++);
+            }
+            else {
+                result.containers.push_back(uniteContainers(*left_it, *right_it));
+                ++left_it;
+                ++right_it;
+            }
+        }
+        return result;
+    }
+
+    //values of left that are not in right
+    static CategoryBitmap subtract(const CategoryBitmap& left, const CategoryBitmap& right)
+    {
+        CategoryBitmap result;
+        auto right_it = right.containers.begin();
+
+        for (const Container& container : left.containers)
+        {
+            while (right_it != right.containers.end() && right_it->key < container.key) {
+                ++right_it;
+            }
+            if (right_it == right.containers.end() || right_it->key != container.key) {
+                result.containers.push_back(container);
+                continue;
+            }
+            Container difference = subtractContainers(container, *right_it);
+            if (difference.count > 0) {
+                result.containers.push_back(std::move(difference));
+            }
+        }
+        return result;
+    }
+
+private:
+
+    static constexpr uint32_t array_limit = 4096;
+    static constexpr size_t words_per_bitmap = 1024;
+
+    //either values (sorted, at most array_limit) or words (exactly words_per_bitmap) is in use
+    struct Container
+    {
+        uint16_t key = 0;
+        uint32_t count = 0;
+        std::vector<uint16_t> values;
+        std::vector<uint64_t> words;
+
+        bool isBitmap() const { return !words.empty(); }
+    };
+
+    static uint16_t highBits(uint32_t value) { return static_cast<uint16_t>(value >> 16); }
+    static uint16_t lowBits(uint32_t value) { return static_cast<uint16_t>(value & 0xFFFF); }
+
+    static uint32_t popcount(uint64_t word)
+    {
+#ifdef _MSC_VER
+        return static_cast<uint32_t>(__popcnt64(word));
+#else
+        return static_cast<uint32_t>(__builtin_popcountll(word));
+#endif
+    }
+
+    static uint32_t countTrailingZeros(uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(word));
+#endif
+    }
+
+    static uint32_t countWords(const std::vector<uint64_t>& words)
+    {
+        uint32_t count = 0;
+        for (size_t word = 0; word < words_per_bitmap; ++word) {
+            count += popcount(words[word]);
+        }
+        return count;
+    }
+
+    std::vector<Container>::iterator lowerBound(uint16_t key)
+    {
+        return std::lower_bound(containers.begin(), containers.end(), key,
+            [](const Container& container, uint16_t search) { return container.key < search; });
+    }
+
+    const Container* findContainer(uint16_t key) const
+    {
+        auto position = std::lower_bound(containers.begin(), containers.end(), key,
+            [](const Container& container, uint16_t search) { return container.key < search; });
+        return position != containers.end() && position->key == key ? &*position : nullptr;
+    }
+
+    Container& containerFor(uint16_t key)
+    {
+        auto position = lowerBound(key);
+        if (position == containers.end() || position->key != key) {
+            Container container;
+            container.key = key;
+            position = containers.insert(position, std::move(container));
+        }
+        return *position;
+    }
+
+    static void toBitmap(Container& container)
+    {
+        container.words.assign(words_per_bitmap, 0);
+        for (uint16_t low : container.values) {
+            container.words[low >> 6] |= uint64_t(1) << (low & 63);
+        }
+        container.values.clear();
+        container.values.shrink_to_fit();
+    }
+
+    static void toArray(Container& container)
+    {
+        container.values.clear();
+        container.values.reserve(container.count);
+        for (size_t word = 0; word < words_per_bitmap; ++word) {
+            uint64_t bits = container.words[word];
+            while (bits != 0) {
+                container.values.push_back(static_cast<uint16_t>(word * 64 + countTrailingZeros(bits)));
+                bits &= bits - 1;
+            }
+        }
+        container.words.clear();
+        container.words.shrink_to_fit();
+    }
+
+    //bitmap results that fall back under the limit are stored as arrays again
+    static Container finishBitmap(Container container)
+    {
+        container.count = countWords(container.words);
+        if (container.count <= array_limit) {
+            toArray(container);
+        }
+        return container;
+    }
+
+    static Container intersectContainers(const Container& left, const Container& right)
+    {
+        Container result;
+        result.key = left.key;
+
+        if (left.isBitmap() && right.isBitmap()) {
+            result.words.resize(words_per_bitmap);
+            for (size_t word = 0; word < words_per_bitmap; ++word) {
+                result.words[word] = left.words[word] & right.words[word];
+            }
+            return finishBitmap(std::move(result));
+        }
+
+        if (left.isBitmap() || right.isBitmap()) {
+            const Container& array = left.isBitmap() ? right : left;
+            const Container& bitmap = left.isBitmap() ? left : right;
+            for (uint16_t low : array.values) {
+                if ((bitmap.words[low >> 6] >> (low & 63)) & 1) {
+                    result.values.push_back(low);
+                }
+            }
+        }
+        else {
+            std::set_intersection(left.values.begin(), left.values.end(), right.values.begin(), right.values.end(),
+                std::back_inserter(result.values));
+        }
+        result.count = static_cast<uint32_t>(result.values.size());
+        return result;
+    }
+
+    static Container uniteContainers(const Container& left, const Container& right)
+    {
+        Container result;
+        result.key = left.key;
+
+        if (!left.isBitmap() && !right.isBitmap() && left.count + right.count <= array_limit) {
+            std::set_union(left.values.begin(), left.values.end(), right.values.begin(), right.values.end(),
+                std::back_inserter(result.values));
+            result.count = static_cast<uint32_t>(result.values.size());
+            return result;
+        }
+
+        result.words.assign(words_per_bitmap, 0);
+        for (const Container* side : { &left, &right }) {
+            if (side->isBitmap()) {
+                for (size_t word = 0; word < words_per_bitmap; ++word) {
+                    result.words[word] |= side->words[word];
+                }
+            }
+            else {
+                for (uint16_t low : side->values) {
+                    result.words[low >> 6] |= uint64_t(1) << (low & 63);
+                }
+            }
+        }
+        return finishBitmap(std::move(result));
+    }
+
+    static Container subtractContainers(const Container& left, const Container& right)
+    {
+        Container result;
+        result.key = left.key;
+
+        if (left.isBitmap()) {
+            result.words = left.words;
+            if (right.isBitmap()) {
+                for (size_t word = 0; word < words_per_bitmap; ++word) {
+                    result.words[word] &= ~right.words[word];
+                }
+            }
+            else {
+                for (uint16_t low : right.values) {
+                    result.words[low >> 6] &= ~(uint64_t(1) << (low & 63));
+                }
+            }
+            return finishBitmap(std::move(result));
+        }
+
+        if (right.isBitmap()) {
+            for (uint16_t low : left.values) {
+                if (!((right.words[low >> 6] >> (low & 63)) & 1)) {
+                    result.values.push_back(low);
+                }
+            }
+        }
+        else {
+            std::set_difference(left.values.begin(), left.values.end(), right.values.begin(), right.values.end(),
+                std::back_inserter(result.values));
+        }
+        result.count = static_cast<uint32_t>(result.values.size());
+        return result;
+    }
+
+    std::vector<Container> containers;
+};
+
+#endif //CATEGORYBITMAP_HPP
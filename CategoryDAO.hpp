@@ -0,0 +1,221 @@
+#ifndef CATEGORYDAO_HPP
+#define CATEGORYDAO_HPP
+
+#include "DatabaseManager.hpp"
+#include "GenericDAO.hpp"
+#include <string>
+#include <optional>
+#include "nlohmann\\json.hpp"
+#include <chrono>
+
+//Categories is the list of keywords, ElementCategories the EAV relation assigning them to
+//elements. assignments are written and withdrawn here so observers such as CategoryIndex
+//see every change to the relation
+class CategoryDAO : public GenericDAO {
+public:
+
+    CategoryDAO(DatabaseManager &db_manager) : GenericDAO(&db_manager) {}
+
+    //the C in CRUD
+    bool insertRecord(const nlohmann::json& json_data) override
+    {
+        std::string parameter_insert =
+            "INSERT INTO Categories (category_name, category_description, category_visibility, category_timestamp) "
+            "VALUES (?, ?, ?, ?) RETURNING category_id;";
+
+        db_manager->prepareStatement(parameter_insert);
+
+        //required bindings already validated
+        db_manager->bindParameter<std::string>(1, json_data["category_name"]);
+        db_manager->bindOptional<std::string>(2, json_data, "category_description", std::nullopt);
+        db_manager->bindOptional<int>(3, json_data, "category_visibility", 1);
+        db_manager->bindOptional<int>(4, json_data, "category_timestamp", std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+        std::optional<int> category_id;
+        bool written = db_manager->executeReturning([&category_id](sqlite3_stmt* row) {
+            category_id = sqlite3_column_int(row, 0);
+        });
+        if (!written || !category_id.has_value())
+        {
+            std::cerr << "Error in insertRecord" << std::endl;
+            return false;
+        }
+        last_inserted_id = category_id.value();
+
+        nlohmann::json inserted = json_data;
+        inserted["category_id"] = last_inserted_id;
+        notifyInserted("Categories", inserted);
+        return true;
+    }
+
+    //id given to the category written by the last successful insertRecord
+    int getLastInsertedId() const
+    {
+        return last_inserted_id;
+    }
+
+    //R in CRUD
+    nlohmann::json retrieveRecordById(int id) override
+    {
+        nlohmann::json json_result;
+
+        db_manager->prepareStatement(
+            "SELECT category_id, category_name, category_description, category_visibility, category_timestamp "
+            "FROM Categories WHERE category_id = ?;");
+        db_manager->bindParameter<int>(1, id);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        if (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            db_manager->getParameter<int>(0, json_result, "category_id", prepared_statement);
+            db_manager->getParameter<std::string>(1, json_result, "category_name", prepared_statement);
+            db_manager->getParameter<std::string>(2, json_result, "category_description", prepared_statement);
+            db_manager->getParameter<int>(3, json_result, "category_visibility", prepared_statement);
+            db_manager->getParameter<int>(4, json_result, "category_timestamp", prepared_statement);
+        }
+
+        sqlite3_finalize(prepared_statement);
+        return json_result;
+    }
+
+    std::optional<int> getIdGivenName(const std::string& category_name)
+    {
+        db_manager->prepareStatement("SELECT category_id FROM Categories WHERE category_name = ?;");
+        db_manager->bindParameter<std::string>(1, category_name);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        std::optional<int> category_id;
+        if (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            category_id = sqlite3_column_int(prepared_statement, 0);
+        }
+        sqlite3_finalize(prepared_statement);
+        return category_id;
+    }
+
+    //U in CRUD
+    bool updateRecordById(int id, nlohmann::json& json_data) override
+    {
+        const std::map<std::string, DataType> mutable_fields =
+        {
+            {"category_name", DataType::TEXT},
+            {"category_description", DataType::TEXT},
+            {"category_visibility", DataType::INTEGER}
+        };
+        std::string sql = "UPDATE Categories SET ";
+        bool first = true;
+
+        // First Pass: Build SQL Query
+        for (const auto& field : mutable_fields) {
+            if (json_data.contains(field.first)) {
+                if (!first) {
+                    sql += ", ";
+                }
+                sql += field.first + " = ?";
+                first = false;
+            }
+        }
+
+        if (first) {
+            std::cerr << "No valid fields provided for update." << std::endl;
+            return false;
+        }
+
+        sql += " WHERE category_id = ?;";
+        db_manager->prepareStatement(sql);
+
+        // Second Pass: Bind Parameters
+        int param_index = 1;
+        for (const auto& field : mutable_fields) {
+            if (json_data.contains(field.first)) {
+                switch (field.second) {
+                case DataType::TEXT:
+                    db_manager->bindParameter<std::string>(param_index, json_data.at(field.first).get<std::string>());
+                    break;
+                case DataType::INTEGER:
+                    db_manager->bindParameter<int>(param_index, json_data.at(field.first).get<int>());
+                    break;
+                case DataType::REAL:
+                    db_manager->bindParameter<double>(param_index, json_data.at(field.first).get<double>());
+                    break;
+                }
+                ++param_index;
+            }
+        }
+
+        db_manager->bindParameter<int>(param_index, id);
+
+        if (!db_manager->executePrepared()) {
+            std::cerr << "Error in updateRecordById" << std::endl;
+            return false;
+        }
+
+        if (!observers.empty()) {
+            notifyUpdated("Categories", retrieveRecordById(id));
+        }
+        return true;
+    }
+
+    //D in CRUD, categories are hidden so past assignments keep their meaning
+    bool deleteRecordById(int id) override
+    {
+        db_manager->prepareStatement("UPDATE Categories SET category_visibility = ? WHERE category_id = ?;");
+        db_manager->bindParameter<int>(1, 0);
+        db_manager->bindParameter<int>(2, id);
+        if (!db_manager->executePrepared())
+        {
+            std::cerr << "Error in deleteRecordById." << std::endl;
+            return false;
+        }
+
+        notifyDeleted("Categories", { {"category_id", id} });
+        return true;
+    }
+
+    // Assignments ----------------------------------------------------------------------------------------
+
+    //assigning an already assigned category makes a hidden assignment visible again
+    bool assignCategory(const std::string& element_guid, int category_id)
+    {
+        db_manager->prepareStatement(
+            "INSERT INTO ElementCategories (elemcat_item_guid, elemcat_category_id, elemcat_visibility, elemcat_timestamp) "
+            "VALUES (?, ?, 1, ?) ON CONFLICT (elemcat_item_guid, elemcat_category_id) DO UPDATE SET elemcat_visibility = 1;");
+        db_manager->bindParameter<std::string>(1, element_guid);
+        db_manager->bindParameter<int>(2, category_id);
+        db_manager->bindParameter<int>(3, std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+        if (!db_manager->executePrepared())
+        {
+            std::cerr << "Error in assignCategory" << std::endl;
+            return false;
+        }
+
+        notifyInserted("ElementCategories", { {"elemcat_item_guid", element_guid}, {"elemcat_category_id", category_id} });
+        return true;
+    }
+
+    bool unassignCategory(const std::string& element_guid, int category_id)
+    {
+        db_manager->prepareStatement("DELETE FROM ElementCategories WHERE elemcat_item_guid = ? AND elemcat_category_id = ?;");
+        db_manager->bindParameter<std::string>(1, element_guid);
+        db_manager->bindParameter<int>(2, category_id);
+
+        if (!db_manager->executePrepared())
+        {
+            std::cerr << "Error in unassignCategory" << std::endl;
+            return false;
+        }
+
+        notifyDeleted("ElementCategories", { {"elemcat_item_guid", element_guid}, {"elemcat_category_id", category_id} });
+        return true;
+    }
+
+    bool existenceOfRecordByField(const std::string& field_name, const std::string& value)
+    {
+        return GenericDAO::existenceOfRecordByField("Categories", field_name, value);
+    }
+
+private:
+
+    int last_inserted_id = 0;
+};
+
+#endif //CATEGORYDAO_HPP
@@ -0,0 +1,479 @@
+#ifndef CATEGORYINDEX_HPP
+#define CATEGORYINDEX_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include "GenericDAO.hpp"
+#include "ElementGuid.hpp"
+#include "CategoryBitmap.hpp"
+#include "nlohmann\\json.hpp"
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cctype>
+#include <cstdlib>
+#include <unordered_map>
+#include <iostream>
+
+/// <summary>
+/// one CategoryBitmap per category over dense element ordinals, so set questions such as
+/// tools AND (red OR blue) AND NOT broken are answered with bitmap operations instead of
+/// INTERSECT and UNION over ElementCategories. loaded once, then kept current as a
+/// RecordObserver of both ElementDAO and CategoryDAO
+/// </summary>
+class CategoryIndex : public RecordObserver {
+public:
+
+    //the connection is kept to read back the assignments of elements and categories that are restored
+    bool load(DatabaseManager& db_manager)
+    {
+        clear();
+        source = &db_manager;
+
+        //ordinals follow rowid order so elements created together sit in the same containers
+        if (!db_manager.prepareStatement("SELECT element_guid FROM Element WHERE element_visibility = 1 ORDER BY rowid;")) {
+            return false;
+        }
+        sqlite3_stmt* prepared_statement = db_manager.getPreparedStatement();
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            addElement(reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 0)));
+        }
+        sqlite3_finalize(prepared_statement);
+
+        if (!db_manager.prepareStatement("SELECT category_id, category_name FROM Categories WHERE category_visibility = 1;")) {
+            return false;
+        }
+        prepared_statement = db_manager.getPreparedStatement();
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            addCategory(sqlite3_column_int(prepared_statement, 0), reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 1)));
+        }
+        sqlite3_finalize(prepared_statement);
+
+        if (!db_manager.prepareStatement("SELECT elemcat_item_guid, elemcat_category_id FROM ElementCategories WHERE elemcat_visibility = 1;")) {
+            return false;
+        }
+        prepared_statement = db_manager.getPreparedStatement();
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            assign(reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 0)), sqlite3_column_int(prepared_statement, 1));
+        }
+        sqlite3_finalize(prepared_statement);
+
+        return true;
+    }
+
+    void clear()
+    {
+        ordinal_index.clear();
+        ordinal_guids.clear();
+        free_ordinals.clear();
+        universe.clear();
+        bitmaps.clear();
+        category_ids.clear();
+        category_names.clear();
+    }
+
+    // Queries --------------------------------------------------------------------------------------------
+
+    /// <summary>
+    /// evaluates a boolean category expression. operands are category names, quoted with
+    /// double quotes when they contain spaces, or #id; operators are NOT, AND and OR in
+    /// decreasing precedence with parentheses for grouping
+    /// </summary>
+    /// <returns>ordinals of the matching elements, nullopt for a malformed expression or unknown category</returns>
+    std::optional<CategoryBitmap> evaluate(const std::string& expression) const
+    {
+        ExpressionParser parser{ *this, expression, 0, std::string(), 0 };
+        std::optional<CategoryBitmap> result = parser.parseOr();
+        if (result.has_value() && parser.peek() != Token::END) {
+            std::cerr << "Error in category expression: unexpected input at position " << parser.position << std::endl;
+            return std::nullopt;
+        }
+        return result;
+    }
+
+    //guids of the matching elements in ordinal order
+    std::vector<std::string> query(const std::string& expression) const
+    {
+        std::vector<std::string> guids;
+        std::optional<CategoryBitmap> result = evaluate(expression);
+        if (result.has_value()) {
+            guids.reserve(result->cardinality());
+            result->forEach([&](uint32_t ordinal) { guids.push_back(ElementGuid::encode(ordinal_guids[ordinal])); });
+        }
+        return guids;
+    }
+
+    size_t countMatching(const std::string& expression) const
+    {
+        std::optional<CategoryBitmap> result = evaluate(expression);
+        return result.has_value() ? result->cardinality() : 0;
+    }
+
+    size_t elementCount() const
+    {
+        return universe.cardinality();
+    }
+
+    std::optional<uint32_t> ordinalOf(const std::string& guid) const
+    {
+        auto packed = ElementGuid::decode(guid);
+        if (!packed.has_value()) {
+            return std::nullopt;
+        }
+        auto ordinal = ordinal_index.find(packed.value());
+        if (ordinal == ordinal_index.end()) {
+            return std::nullopt;
+        }
+        return ordinal->second;
+    }
+
+    std::string guidOf(uint32_t ordinal) const
+    {
+        return ElementGuid::encode(ordinal_guids[ordinal]);
+    }
+
+    // Incremental Updates --------------------------------------------------------------------------------
+
+    void onRecordInserted(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name == "Element") {
+            addElement(record["element_guid"].get<std::string>());
+        }
+        else if (table_name == "Categories") {
+            addCategory(record["category_id"].get<int>(), record["category_name"].get<std::string>());
+        }
+        else if (table_name == "ElementCategories") {
+            assign(record["elemcat_item_guid"].get<std::string>(), record["elemcat_category_id"].get<int>());
+        }
+    }
+
+    void onRecordUpdated(const std::string& table_name, const nlohmann::json& record) override
+    {
+        //ElementDAO hides rather than deletes, a hidden element leaves every set and a restored one
+        //comes back with its assignments
+        if (table_name == "Element" && record.contains("element_visibility")) {
+            const std::string guid = record["element_guid"].get<std::string>();
+            if (record["element_visibility"].get<int>() == 0) {
+                removeElement(guid);
+            }
+            else if (!ordinalOf(guid).has_value()) {
+                addElement(guid);
+                reloadAssignments("SELECT elemcat_item_guid, elemcat_category_id FROM ElementCategories "
+                    "WHERE elemcat_item_guid = ? AND elemcat_visibility = 1;", guid);
+            }
+            return;
+        }
+        if (table_name != "Categories" || !record.contains("category_id")) {
+            return;
+        }
+
+        int category_id = record["category_id"].get<int>();
+        if (record.contains("category_visibility") && record["category_visibility"].get<int>() == 0) {
+            removeCategory(category_id);
+            return;
+        }
+        if (category_names.count(category_id) == 0 && record.contains("category_name")) {
+            addCategory(category_id, record["category_name"].get<std::string>());
+            reloadAssignments("SELECT elemcat_item_guid, elemcat_category_id FROM ElementCategories "
+                "WHERE elemcat_category_id = ? AND elemcat_visibility = 1;", std::to_string(category_id));
+            return;
+        }
+
+        //a renamed category keeps its bitmap under the new name
+        auto current = category_names.find(category_id);
+        if (current != category_names.end() && record.contains("category_name")) {
+            category_ids.erase(current->second);
+            current->second = record["category_name"].get<std::string>();
+            category_ids[current->second] = category_id;
+        }
+    }
+
+    void onRecordDeleted(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name == "Element") {
+            removeElement(record["element_guid"].get<std::string>());
+        }
+        else if (table_name == "Categories") {
+            removeCategory(record["category_id"].get<int>());
+        }
+        else if (table_name == "ElementCategories") {
+            std::optional<uint32_t> ordinal = ordinalOf(record["elemcat_item_guid"].get<std::string>());
+            auto bitmap = bitmaps.find(record["elemcat_category_id"].get<int>());
+            if (ordinal.has_value() && bitmap != bitmaps.end()) {
+                bitmap->second.remove(ordinal.value());
+            }
+        }
+    }
+
+private:
+
+    void addElement(const std::string& guid)
+    {
+        auto packed = ElementGuid::decode(guid);
+        if (!packed.has_value() || ordinal_index.count(packed.value()) > 0) {
+            return;
+        }
+
+        uint32_t ordinal;
+        if (!free_ordinals.empty()) {
+            ordinal = free_ordinals.back();
+            free_ordinals.pop_back();
+            ordinal_guids[ordinal] = packed.value();
+        }
+        else {
+            ordinal = static_cast<uint32_t>(ordinal_guids.size());
+            ordinal_guids.push_back(packed.value());
+        }
+        ordinal_index[packed.value()] = ordinal;
+        universe.add(ordinal);
+    }
+
+    //the ordinal is cleared from every category before it is handed to another element
+    void removeElement(const std::string& guid)
+    {
+        std::optional<uint32_t> ordinal = ordinalOf(guid);
+        if (!ordinal.has_value()) {
+            return;
+        }
+        for (auto& bitmap : bitmaps) {
+            bitmap.second.remove(ordinal.value());
+        }
+        universe.remove(ordinal.value());
+        ordinal_index.erase(ordinal_guids[ordinal.value()]);
+        free_ordinals.push_back(ordinal.value());
+    }
+
+    void addCategory(int category_id, const std::string& category_name)
+    {
+        category_ids[category_name] = category_id;
+        category_names[category_id] = category_name;
+        bitmaps[category_id];
+    }
+
+    void removeCategory(int category_id)
+    {
+        auto name = category_names.find(category_id);
+        if (name != category_names.end()) {
+            category_ids.erase(name->second);
+            category_names.erase(name);
+        }
+        bitmaps.erase(category_id);
+    }
+
+    //assignments to hidden elements or categories are not indexed
+    void assign(const std::string& guid, int category_id)
+    {
+        std::optional<uint32_t> ordinal = ordinalOf(guid);
+        auto bitmap = bitmaps.find(category_id);
+        if (ordinal.has_value() && bitmap != bitmaps.end()) {
+            bitmap->second.add(ordinal.value());
+        }
+    }
+
+    void reloadAssignments(const std::string& sql, const std::string& key)
+    {
+        if (source == nullptr || !source->prepareStatement(sql)) {
+            return;
+        }
+        source->bindParameter<std::string>(1, key);
+        sqlite3_stmt* prepared_statement = source->getPreparedStatement();
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            assign(reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 0)), sqlite3_column_int(prepared_statement, 1));
+        }
+        sqlite3_finalize(prepared_statement);
+    }
+
+    enum class Token
+    {
+        AND,
+        OR,
+        NOT,
+        OPEN,
+        CLOSE,
+        OPERAND,
+        END
+    };
+
+    //recursive descent over the expression, one method per precedence level
+    struct ExpressionParser
+    {
+        //NOT and parentheses recurse, a typed expression cannot nest deep enough to exhaust the stack
+        static constexpr size_t max_depth = 128;
+
+        const CategoryIndex& index;
+        const std::string& text;
+        size_t position = 0;
+        std::string operand;
+        size_t depth = 0;
+
+        bool descend()
+        {
+            if (depth == max_depth) {
+                std::cerr << "Error in category expression: nested deeper than " << max_depth << " at position " << position << std::endl;
+                return false;
+            }
+            ++depth;
+            return true;
+        }
+
+        Token peek()
+        {
+            size_t saved = position;
+            Token token = next();
+            position = saved;
+            return token;
+        }
+
+        Token next()
+        {
+            while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) {
+                ++position;
+            }
+            if (position == text.size()) {
+                return Token::END;
+            }
+            if (text[position] == '(') {
+                ++position;
+                return Token::OPEN;
+            }
+            if (text[position] == ')') {
+                ++position;
+                return Token::CLOSE;
+            }
+
+            operand.clear();
+            if (text[position] == '"') {
+                size_t closing = text.find('"', position + 1);
+                if (closing == std::string::npos) {
+                    closing = text.size();
+                }
+                operand = text.substr(position + 1, closing - position - 1);
+                position = std::min(closing + 1, text.size());
+                return Token::OPERAND;
+            }
+
+            while (position < text.size() && !std::isspace(static_cast<unsigned char>(text[position]))
+                && text[position] != '(' && text[position] != ')') {
+                operand += text[position++];
+            }
+            if (operand == "AND" || operand == "and") {
+                return Token::AND;
+            }
+            if (operand == "OR" || operand == "or") {
+                return Token::OR;
+            }
+            if (operand == "NOT" || operand == "not") {
+                return Token::NOT;
+            }
+            return Token::OPERAND;
+        }
+
+        std::optional<CategoryBitmap> parseOr()
+        {
+            std::optional<CategoryBitmap> result = parseAnd();
+            while (result.has_value() && peek() == Token::OR) {
+                next();
+                std::optional<CategoryBitmap> right = parseAnd();
+                if (!right.has_value()) {
+                    return std::nullopt;
+                }
+                result = CategoryBitmap::unite(result.value(), right.value());
+            }
+            return result;
+        }
+
+        //NOT directly under AND is applied as a difference rather than against the universe
+        std::optional<CategoryBitmap> parseAnd()
+        {
+            std::optional<CategoryBitmap> result = parseNot();
+            while (result.has_value() && peek() == Token::AND) {
+                next();
+                bool negated = false;
+                while (peek() == Token::NOT) {
+                    next();
+                    negated = !negated;
+                }
+                std::optional<CategoryBitmap> right = parsePrimary();
+                if (!right.has_value()) {
+                    return std::nullopt;
+                }
+                result = negated ? CategoryBitmap::subtract(result.value(), right.value())
+                    : CategoryBitmap::intersect(result.value(), right.value());
+            }
+            return result;
+        }
+
+        std::optional<CategoryBitmap> parseNot()
+        {
+            if (peek() != Token::NOT) {
+                return parsePrimary();
+            }
+            next();
+            if (!descend()) {
+                return std::nullopt;
+            }
+            std::optional<CategoryBitmap> operand_set = parseNot();
+            --depth;
+            if (!operand_set.has_value()) {
+                return std::nullopt;
+            }
+            return CategoryBitmap::subtract(index.universe, operand_set.value());
+        }
+
+        std::optional<CategoryBitmap> parsePrimary()
+        {
+            size_t start = position;
+            Token token = next();
+
+            if (token == Token::OPEN) {
+                if (!descend()) {
+                    return std::nullopt;
+                }
+                std::optional<CategoryBitmap> result = parseOr();
+                --depth;
+                if (result.has_value() && next() != Token::CLOSE) {
+                    std::cerr << "Error in category expression: missing ) at position " << position << std::endl;
+                    return std::nullopt;
+                }
+                return result;
+            }
+            if (token != Token::OPERAND) {
+                std::cerr << "Error in category expression: expected a category at position " << start << std::endl;
+                return std::nullopt;
+            }
+
+            std::optional<int> category_id;
+            if (operand.size() > 1 && operand[0] == '#') {
+                category_id = std::atoi(operand.c_str() + 1);
+            }
+            else {
+                auto found = index.category_ids.find(operand);
+                if (found != index.category_ids.end()) {
+                    category_id = found->second;
+                }
+            }
+
+            auto bitmap = category_id.has_value() ? index.bitmaps.find(category_id.value()) : index.bitmaps.end();
+            if (bitmap == index.bitmaps.end()) {
+                std::cerr << "Error in category expression: unknown category " << operand << std::endl;
+                return std::nullopt;
+            }
+            return bitmap->second;
+        }
+    };
+
+    //packed guid to ordinal and back, ordinals of deleted elements are reused
+    std::unordered_map<uint32_t, uint32_t> ordinal_index;
+    std::vector<uint32_t> ordinal_guids;
+    std::vector<uint32_t> free_ordinals;
+    CategoryBitmap universe;
+
+    std::unordered_map<int, CategoryBitmap> bitmaps;
+    std::unordered_map<std::string, int> category_ids;
+    std::unordered_map<int, std::string> category_names;
+
+    DatabaseManager* source = nullptr;
+};
+
+#endif //CATEGORYINDEX_HPP
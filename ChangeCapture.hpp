@@ -0,0 +1,322 @@
+#ifndef CHANGECAPTURE_HPP
+#define CHANGECAPTURE_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <algorithm>
+
+/// <summary>
+/// bounded queue for exactly one producer thread and one consumer thread. push and pop only
+/// touch two atomic counters, neither side ever waits for the other
+/// </summary>
+template <typename T>
+class SpscQueue {
+public:
+
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        slots.resize(rounded);
+        mask = rounded - 1;
+    }
+
+    //false when full, the value is left untouched
+    bool push(T& value)
+    {
+        const size_t tail = write_index.load(std::memory_order_relaxed);
+        if (tail - read_index.load(std::memory_order_acquire) == slots.size()) {
+            return false;
+        }
+        slots[tail & mask] = std::move(value);
+        write_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value)
+    {
+        const size_t head = read_index.load(std::memory_order_relaxed);
+        if (head == write_index.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots[head & mask]);
+        read_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const
+    {
+        return write_index.load(std::memory_order_acquire) - read_index.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const
+    {
+        return slots.size();
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+    //apart so the two threads do not keep taking the same cache line from each other
+    alignas(64) std::atomic<size_t> read_index{ 0 };
+    alignas(64) std::atomic<size_t> write_index{ 0 };
+};
+
+/// <summary>
+/// one row written by a committed transaction. the row is named by table and rowid, a
+/// subscriber that needs the values reads them itself
+/// </summary>
+struct RowChange
+{
+    enum Operation
+    {
+        //not INSERT and DELETE, windows.h defines DELETE
+        INSERTED = SQLITE_INSERT,
+        UPDATED = SQLITE_UPDATE,
+        DELETED = SQLITE_DELETE
+    };
+
+    Operation operation;
+    std::string table;
+    sqlite3_int64 rowid;
+};
+
+//the rows of one committed transaction, sequence counts commits that changed rows from 1
+struct ChangeSet
+{
+    uint64_t sequence = 0;
+    std::vector<RowChange> changes;
+
+    bool touches(const std::string& table) const
+    {
+        return std::any_of(changes.begin(), changes.end(), [&table](const RowChange& change) { return change.table == table; });
+    }
+};
+
+/// <summary>
+/// what one subscriber receives. polled from a single consumer thread, such as a GUI timer or a
+/// thread keeping an index up to date. when the consumer falls more than the queue's capacity
+/// behind, change sets are dropped and overflowed reports it, the consumer then rebuilds
+/// from the tables instead of applying deltas
+/// </summary>
+class ChangeSubscription {
+public:
+
+    explicit ChangeSubscription(size_t capacity) : queue(capacity) {}
+
+    bool poll(std::shared_ptr<const ChangeSet>& change_set)
+    {
+        return queue.pop(change_set);
+    }
+
+    //hands every queued change set to consume, returns how many there were
+    template <typename Consume>
+    size_t drain(Consume consume)
+    {
+        size_t drained = 0;
+        std::shared_ptr<const ChangeSet> change_set;
+        while (queue.pop(change_set)) {
+            consume(*change_set);
+            ++drained;
+        }
+        return drained;
+    }
+
+    //true once since the last call when change sets were dropped
+    bool takeOverflow()
+    {
+        return overflowed.exchange(false, std::memory_order_acq_rel);
+    }
+
+    size_t queued() const
+    {
+        return queue.size();
+    }
+
+private:
+    friend class ChangeCapture;
+
+    SpscQueue<std::shared_ptr<const ChangeSet>> queue;
+    std::atomic<bool> overflowed{ false };
+    std::atomic<bool> closed{ false };
+};
+
+/// <summary>
+/// change data capture for one connection. sqlite's update hook reports every row the
+/// connection inserts, updates or deletes; the rows are buffered per transaction, dropped when
+/// it rolls back, and published as one ChangeSet once it has committed, so subscribers never
+/// see work that did not stick. the commit hook runs before the commit is written and only sets
+/// the rows aside, they are published when DatabaseManager reports the connection back in
+/// autocommit mode after COMMIT or an autocommit statement. savepoints opened through
+/// DatabaseManager's nested transactions are followed too, a rolled back savepoint takes its
+/// rows out of the buffer, and so does a statement run through prepareStatement that fails.
+/// the hooks run on the thread using the connection, which is the only producer of every
+/// subscriber queue, and publishing only locks to take the current subscriber list.
+/// not reported: WITHOUT ROWID tables and rows removed by the truncate optimization of a DELETE
+/// without WHERE. wrongly reported: rows of a statement that fails halfway inside an open
+/// transaction when it ran through executeQuery or was stepped by hand. published late: a commit
+/// stepped by hand, which goes out with the next statement DatabaseManager runs
+/// </summary>
+class ChangeCapture {
+public:
+
+    explicit ChangeCapture(DatabaseManager& _db_manager) : db_manager(&_db_manager)
+    {
+        sqlite3* connection = db_manager->database_connection;
+        sqlite3_update_hook(connection, &ChangeCapture::onUpdate, this);
+        sqlite3_commit_hook(connection, &ChangeCapture::onCommit, this);
+        db_manager->setTransactionListener([this](DatabaseManager::TransactionEvent event) { onTransaction(event); });
+    }
+
+    ~ChangeCapture()
+    {
+        sqlite3* connection = db_manager->database_connection;
+        sqlite3_update_hook(connection, nullptr, nullptr);
+        sqlite3_commit_hook(connection, nullptr, nullptr);
+        db_manager->setTransactionListener(nullptr);
+    }
+
+    ChangeCapture(const ChangeCapture&) = delete;
+    ChangeCapture& operator=(const ChangeCapture&) = delete;
+
+    /// <summary>
+    /// a new subscriber receiving every change set committed from now on
+    /// </summary>
+    /// <param name="capacity">change sets held for the subscriber before they are dropped</param>
+    std::shared_ptr<ChangeSubscription> subscribe(size_t capacity = 1024)
+    {
+        auto subscription = std::make_shared<ChangeSubscription>(capacity);
+        std::lock_guard<std::mutex> lock(subscribers_mutex);
+        auto updated = std::make_shared<SubscriberList>(*subscribers);
+        updated->push_back(subscription);
+        subscribers = std::move(updated);
+        return subscription;
+    }
+
+    void unsubscribe(const std::shared_ptr<ChangeSubscription>& subscription)
+    {
+        subscription->closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(subscribers_mutex);
+        auto updated = std::make_shared<SubscriberList>(*subscribers);
+        updated->erase(std::remove(updated->begin(), updated->end(), subscription), updated->end());
+        subscribers = std::move(updated);
+    }
+
+    //change sets published so far
+    uint64_t committedSets() const
+    {
+        return sequence.load(std::memory_order_acquire);
+    }
+
+    //rows of the transaction in progress and of a commit not yet known to have succeeded
+    size_t bufferedChanges() const
+    {
+        return buffer.size() + committing.size();
+    }
+
+private:
+
+    using SubscriberList = std::vector<std::shared_ptr<ChangeSubscription>>;
+
+    static void onUpdate(void* context, int operation, const char*, const char* table, sqlite3_int64 rowid)
+    {
+        ChangeCapture* capture = static_cast<ChangeCapture*>(context);
+        capture->buffer.push_back({ static_cast<RowChange::Operation>(operation), table, rowid });
+    }
+
+    //runs before the commit is written, which can still fail. a COMMIT refused as busy leaves
+    //the transaction open and runs the hook again on the next attempt, so rows are added
+    static int onCommit(void* context)
+    {
+        ChangeCapture* capture = static_cast<ChangeCapture*>(context);
+        capture->committing.insert(capture->committing.end(), capture->buffer.begin(), capture->buffer.end());
+        capture->buffer.clear();
+        capture->savepoint_marks.clear();
+        return 0;
+    }
+
+    void onTransaction(DatabaseManager::TransactionEvent event)
+    {
+        switch (event) {
+        case DatabaseManager::TransactionEvent::OPEN:
+            savepoint_marks.push_back(buffer.size());
+            break;
+        case DatabaseManager::TransactionEvent::RELEASE:
+            if (!savepoint_marks.empty()) {
+                savepoint_marks.pop_back();
+            }
+            break;
+        case DatabaseManager::TransactionEvent::ROLLBACK:
+            if (!savepoint_marks.empty()) {
+                buffer.resize(std::min(buffer.size(), savepoint_marks.back()));
+                savepoint_marks.pop_back();
+            }
+            break;
+        case DatabaseManager::TransactionEvent::STATEMENT:
+            statement_mark = buffer.size();
+            break;
+        case DatabaseManager::TransactionEvent::STATEMENT_FAILED:
+            buffer.resize(std::min(buffer.size(), statement_mark));
+            break;
+        case DatabaseManager::TransactionEvent::COMMIT:
+            publish();
+            break;
+        case DatabaseManager::TransactionEvent::ABORT:
+            buffer.clear();
+            committing.clear();
+            savepoint_marks.clear();
+            break;
+        }
+    }
+
+    void publish()
+    {
+        if (committing.empty()) {
+            return;
+        }
+
+        auto change_set = std::make_shared<ChangeSet>();
+        change_set->sequence = sequence.load(std::memory_order_relaxed) + 1;
+        change_set->changes.swap(committing);
+        std::shared_ptr<const ChangeSet> published = std::move(change_set);
+        sequence.store(published->sequence, std::memory_order_release);
+
+        std::shared_ptr<const SubscriberList> current;
+        {
+            std::lock_guard<std::mutex> lock(subscribers_mutex);
+            current = subscribers;
+        }
+        for (const std::shared_ptr<ChangeSubscription>& subscription : *current) {
+            if (subscription->closed.load(std::memory_order_acquire)) {
+                continue;
+            }
+            std::shared_ptr<const ChangeSet> copy = published;
+            if (!subscription->queue.push(copy)) {
+                subscription->overflowed.store(true, std::memory_order_release);
+            }
+        }
+    }
+
+    DatabaseManager* db_manager;
+
+    //only touched from the connection's thread, inside the hooks
+    std::vector<RowChange> buffer;
+    std::vector<RowChange> committing;
+    std::vector<size_t> savepoint_marks;
+    size_t statement_mark = 0;
+    std::atomic<uint64_t> sequence{ 0 };
+
+    //copied on subscribe and unsubscribe, a commit only holds the mutex to take the current list
+    std::shared_ptr<const SubscriberList> subscribers = std::make_shared<const SubscriberList>();
+    std::mutex subscribers_mutex;
+};
+
+#endif //CHANGECAPTURE_HPP
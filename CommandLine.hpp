@@ -0,0 +1,583 @@
+#ifndef COMMANDLINE_HPP
+#define COMMANDLINE_HPP
+
+#include "Runtime.hpp"
+#include "ElementGuid.hpp"
+#include "nlohmann\\json.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <future>
+#include <optional>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <array>
+#include <string_view>
+#include <initializer_list>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+
+// Command Table ----------------------------------------------------------------------------------------
+
+enum class ArgumentKind
+{
+    WORD,
+    INTEGER,
+    GUID
+};
+
+struct ArgumentSpec
+{
+    std::string_view name;
+    ArgumentKind kind = ArgumentKind::WORD;
+    bool optional = false;
+};
+
+/// <summary>
+/// one command of the command line: its word, what the session must hold, where it runs, its
+/// handler and the arguments it takes. optional arguments come after the required ones
+/// </summary>
+struct CommandSpec
+{
+    static constexpr size_t max_arguments = 8;
+
+    using Handler = ApplicationController::CommandResult(*)(ApplicationController::CommandContext&);
+
+    std::string_view name;
+    uint32_t required_capabilities = 0;
+    ApplicationController::Workload workload = ApplicationController::Workload::READ;
+    Handler handler = nullptr;
+    std::array<ArgumentSpec, max_arguments> arguments{};
+    size_t argument_count = 0;
+    size_t required_count = 0;
+
+    constexpr CommandSpec() = default;
+
+    constexpr CommandSpec(std::string_view _name, uint32_t _required_capabilities, ApplicationController::Workload _workload,
+        Handler _handler, std::initializer_list<ArgumentSpec> _arguments = {})
+        : name(_name), required_capabilities(_required_capabilities), workload(_workload), handler(_handler)
+    {
+        if (_arguments.size() > max_arguments) {
+            throw std::logic_error("command takes too many arguments");
+        }
+        for (const ArgumentSpec& argument : _arguments) {
+            if (!argument.optional) {
+                if (required_count != argument_count) {
+                    throw std::logic_error("required argument after an optional one");
+                }
+                ++required_count;
+            }
+            arguments[argument_count++] = argument;
+        }
+    }
+};
+
+enum class ParseStatus
+{
+    OK,
+    EMPTY,
+    UNKNOWN_COMMAND,
+    TOO_MANY_WORDS,
+    MISSING_ARGUMENT,
+    TOO_MANY_ARGUMENTS,
+    INVALID_ARGUMENT
+};
+
+struct ParsedCommand
+{
+    ParseStatus status = ParseStatus::EMPTY;
+    const CommandSpec* command = nullptr;
+    TokenList words;
+    //the command word or argument name the status is about
+    std::string_view subject;
+
+    bool ok() const
+    {
+        return status == ParseStatus::OK;
+    }
+};
+
+inline const char* parseStatusMessage(ParseStatus status)
+{
+    switch (status) {
+    case ParseStatus::OK: return "ok";
+    case ParseStatus::EMPTY: return "empty command";
+    case ParseStatus::UNKNOWN_COMMAND: return "unknown command";
+    case ParseStatus::TOO_MANY_WORDS: return "too many words";
+    case ParseStatus::MISSING_ARGUMENT: return "missing argument";
+    case ParseStatus::TOO_MANY_ARGUMENTS: return "too many arguments";
+    case ParseStatus::INVALID_ARGUMENT: return "invalid argument";
+    }
+    return "";
+}
+
+namespace command_detail {
+
+    //FNV-1a with the seed folded into the offset basis and the high bits folded down for the mask
+    constexpr uint32_t hashName(std::string_view name, uint32_t seed)
+    {
+        uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (char character : name) {
+            hash ^= static_cast<uint8_t>(character);
+            hash *= 16777619u;
+        }
+        return hash ^ (hash >> 16);
+    }
+
+    //at most one command in four slots keeps the seed search short
+    constexpr size_t slotCountFor(size_t command_count)
+    {
+        size_t slots = 8;
+        while (slots < command_count * 4) {
+            slots *= 2;
+        }
+        return slots;
+    }
+
+    constexpr uint16_t empty_slot = 0xFFFF;
+
+    constexpr const CommandSpec* findCommand(const CommandSpec* commands, const uint16_t* slots, size_t slot_mask, uint32_t seed, std::string_view name)
+    {
+        uint16_t index = slots[hashName(name, seed) & slot_mask];
+        if (index == empty_slot || commands[index].name != name) {
+            return nullptr;
+        }
+        return &commands[index];
+    }
+
+    inline bool argumentValid(const ArgumentSpec& argument, std::string_view word)
+    {
+        switch (argument.kind) {
+        case ArgumentKind::WORD:
+            return !word.empty();
+        case ArgumentKind::INTEGER: {
+            long long value = 0;
+            auto [end, error] = std::from_chars(word.data(), word.data() + word.size(), value);
+            return error == std::errc() && end == word.data() + word.size();
+        }
+        case ArgumentKind::GUID:
+            return ElementGuid::decode(word).has_value();
+        }
+        return false;
+    }
+}
+
+/// <summary>
+/// non-template handle on a CommandTable, so code that only looks commands up does not need
+/// to know how many there are
+/// </summary>
+class CommandTableView {
+public:
+
+    constexpr CommandTableView(const CommandSpec* _commands, size_t _command_count, const uint16_t* _slots, size_t _slot_count, uint32_t _seed)
+        : commands(_commands), command_count(_command_count), slots(_slots), slot_mask(_slot_count - 1), seed(_seed) {}
+
+    constexpr const CommandSpec* find(std::string_view name) const
+    {
+        return command_detail::findCommand(commands, slots, slot_mask, seed, name);
+    }
+
+    /// <summary>
+    /// tokenizes line in place, looks the command up and checks the words against its
+    /// arguments. nothing is allocated, the parsed words are views into line
+    /// </summary>
+    ParsedCommand parse(char* text, size_t length) const
+    {
+        ParsedCommand parsed;
+        parsed.words = tokenizeInPlace(text, length);
+        if (parsed.words.size() == 0) {
+            parsed.status = ParseStatus::EMPTY;
+            return parsed;
+        }
+        parsed.subject = parsed.words[0];
+        if (parsed.words.overflow) {
+            parsed.status = ParseStatus::TOO_MANY_WORDS;
+            return parsed;
+        }
+
+        parsed.command = find(parsed.words[0]);
+        if (parsed.command == nullptr) {
+            parsed.status = ParseStatus::UNKNOWN_COMMAND;
+            return parsed;
+        }
+        parsed.status = validate(*parsed.command, parsed.words.size() - 1,
+            [&parsed](size_t index) { return parsed.words[index + 1]; }, parsed.subject);
+        return parsed;
+    }
+
+    ParsedCommand parse(std::string& line) const
+    {
+        return parse(line.data(), line.size());
+    }
+
+    /// <summary>
+    /// checks argument_count words, read through word_at, against the arguments of command.
+    /// on failure subject names the argument at fault
+    /// </summary>
+    template <typename WordAt>
+    static ParseStatus validate(const CommandSpec& command, size_t argument_count, WordAt word_at, std::string_view& subject)
+    {
+        if (argument_count < command.required_count) {
+            subject = command.arguments[argument_count].name;
+            return ParseStatus::MISSING_ARGUMENT;
+        }
+        if (argument_count > command.argument_count) {
+            subject = command.name;
+            return ParseStatus::TOO_MANY_ARGUMENTS;
+        }
+        for (size_t index = 0; index < argument_count; ++index) {
+            if (!command_detail::argumentValid(command.arguments[index], word_at(index))) {
+                subject = command.arguments[index].name;
+                return ParseStatus::INVALID_ARGUMENT;
+            }
+        }
+        return ParseStatus::OK;
+    }
+
+    /// <summary>
+    /// registers every command with the controller and has it resolve command words through
+    /// find on the words it tokenized in place. the arguments are checked against the schema
+    /// on the dispatch stage, so a line sent straight to the controller is held to the same
+    /// arguments and a malformed one never reaches a handler. the table has to outlive the controller
+    /// </summary>
+    void install(ApplicationController& controller) const
+    {
+        std::vector<size_t> positions;
+        positions.reserve(size());
+        for (const CommandSpec& command : *this) {
+            const CommandSpec* spec = &command;
+            positions.push_back(controller.registerCommand(std::string(command.name), command.required_capabilities, command.workload,
+                command.handler, [spec](const TokenList& words) -> std::optional<std::string> {
+                    std::string_view subject;
+                    ParseStatus status = validate(*spec, words.size() - 1, [&words](size_t index) { return words[index + 1]; }, subject);
+                    if (status == ParseStatus::OK) {
+                        return std::nullopt;
+                    }
+                    return std::string(parseStatusMessage(status)) + " " + std::string(subject);
+                }));
+        }
+
+        controller.setCommandLookup([table = *this, positions = std::move(positions)](std::string_view word) -> std::optional<size_t> {
+            const CommandSpec* command = table.find(word);
+            if (command == nullptr) {
+                return std::nullopt;
+            }
+            return positions[static_cast<size_t>(command - table.begin())];
+        });
+    }
+
+    //commands in name order
+    constexpr const CommandSpec* begin() const
+    {
+        return commands;
+    }
+
+    constexpr const CommandSpec* end() const
+    {
+        return commands + command_count;
+    }
+
+    constexpr size_t size() const
+    {
+        return command_count;
+    }
+
+private:
+    const CommandSpec* commands;
+    size_t command_count;
+    const uint16_t* slots;
+    size_t slot_mask;
+    uint32_t seed;
+};
+
+/// <summary>
+/// command table built at compile time. the commands are sorted by name for listing, and a
+/// seed is searched for so that hashing every name lands in its own slot: a lookup hashes the
+/// word once, reads one slot and compares one name. a duplicate name, or a table no seed
+/// separates, fails to compile. declare tables constexpr through makeCommandTable:
+///     inline constexpr auto commands = makeCommandTable({ CommandSpec{ "countusers", ... }, ... });
+/// </summary>
+template <size_t N>
+class CommandTable {
+public:
+
+    static_assert(N > 0 && N < command_detail::empty_slot, "a command table holds 1 to 65534 commands");
+
+    static constexpr size_t slot_count = command_detail::slotCountFor(N);
+
+    constexpr explicit CommandTable(const CommandSpec (&specs)[N])
+    {
+        for (size_t index = 0; index < N; ++index) {
+            commands[index] = specs[index];
+        }
+
+        //insertion sort, std::sort is not constexpr before C++20
+        for (size_t index = 1; index < N; ++index) {
+            for (size_t position = index; position > 0 && commands[position].name < commands[position - 1].name; --position) {
+                CommandSpec moved = commands[position];
+                commands[position] = commands[position - 1];
+                commands[position - 1] = moved;
+            }
+        }
+        for (size_t index = 1; index < N; ++index) {
+            if (commands[index].name == commands[index - 1].name) {
+                throw std::logic_error("duplicate command name");
+            }
+        }
+
+        seed = findSeed();
+        for (size_t slot = 0; slot < slot_count; ++slot) {
+            slots[slot] = command_detail::empty_slot;
+        }
+        for (size_t index = 0; index < N; ++index) {
+            slots[command_detail::hashName(commands[index].name, seed) & (slot_count - 1)] = static_cast<uint16_t>(index);
+        }
+    }
+
+    constexpr const CommandSpec* find(std::string_view name) const
+    {
+        return command_detail::findCommand(commands.data(), slots.data(), slot_count - 1, seed, name);
+    }
+
+    constexpr CommandTableView view() const
+    {
+        return CommandTableView(commands.data(), N, slots.data(), slot_count, seed);
+    }
+
+private:
+
+    constexpr uint32_t findSeed() const
+    {
+        for (uint32_t candidate = 0; candidate < 4096; ++candidate) {
+            std::array<bool, slot_count> taken{};
+            bool separated = true;
+            for (size_t index = 0; index < N && separated; ++index) {
+                size_t slot = command_detail::hashName(commands[index].name, candidate) & (slot_count - 1);
+                separated = !taken[slot];
+                taken[slot] = true;
+            }
+            if (separated) {
+                return candidate;
+            }
+        }
+        throw std::logic_error("no seed separates the command names");
+    }
+
+    std::array<CommandSpec, N> commands{};
+    std::array<uint16_t, slot_count> slots{};
+    uint32_t seed = 0;
+};
+
+template <size_t N>
+constexpr CommandTable<N> makeCommandTable(const CommandSpec (&specs)[N])
+{
+    return CommandTable<N>(specs);
+}
+
+// Batch Mode -------------------------------------------------------------------------------------------
+
+/// <summary>
+/// non-interactive mode of the command line for scripted work such as nightly imports and bulk
+/// moves. commands are read one per line from a file or stdin and run through the
+/// ApplicationController under one session without waiting for each other. consecutive write
+/// commands are grouped into one transaction on the writer, and whenever the script switches
+/// between writes and other commands the batch waits for what is in flight, so a read always
+/// sees the writes above it. blank lines and lines starting with # are skipped. only the command
+/// word is read here to tell writes from other commands, the controller tokenizes each line once
+/// and, with a command table installed, refuses a malformed line before any handler runs
+/// </summary>
+class BatchMode {
+public:
+
+    struct Summary
+    {
+        size_t commands = 0;
+        size_t succeeded = 0;
+        size_t failed = 0;
+        size_t transactions = 0;
+        double elapsed_ms = 0.0;
+        double commands_per_second = 0.0;
+    };
+
+    BatchMode(ApplicationController& _controller, const std::string& _token, size_t _max_in_flight = 256, size_t _max_transaction = 500)
+        : controller(&_controller), token(_token),
+        max_in_flight(_max_in_flight == 0 ? 1 : _max_in_flight), max_transaction(_max_transaction == 0 ? 1 : _max_transaction) {}
+
+    //the table's commands must be the ones installed in the controller, it is searched for workloads only
+    void setCommandTable(const CommandTableView& _table)
+    {
+        table = _table;
+    }
+
+    /// <summary>
+    /// runs every command of input, writing one line per command to report:
+    /// line number, ok or error, time in the handler and the output or error
+    /// </summary>
+    Summary run(std::istream& input, std::ostream& report)
+    {
+        summary = Summary();
+        in_flight.clear();
+        writes.clear();
+        writing = false;
+
+        auto started = std::chrono::steady_clock::now();
+        std::string line;
+        size_t line_number = 0;
+        while (std::getline(input, line))
+        {
+            ++line_number;
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                continue;
+            }
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+
+            std::optional<ApplicationController::Workload> workload = workloadOf(std::string_view(line).substr(first));
+
+            //unknown commands are refused by the controller, they take the current side
+            bool is_write = workload.has_value() ? workload.value() == ApplicationController::Workload::WRITE : writing;
+
+            if (is_write != writing) {
+                flushWrites();
+                drain(report, 0);
+                writing = is_write;
+            }
+
+            if (is_write) {
+                writes.push_back({ line_number, line });
+                if (writes.size() >= max_transaction) {
+                    flushWrites();
+                }
+            }
+            else {
+                in_flight.push_back({ line_number, controller->execute(token, line) });
+            }
+            drain(report, max_in_flight);
+        }
+        flushWrites();
+        drain(report, 0);
+
+        summary.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        if (summary.elapsed_ms > 0.0) {
+            summary.commands_per_second = summary.commands * 1000.0 / summary.elapsed_ms;
+        }
+        std::ios::fmtflags flags = report.flags();
+        std::streamsize precision = report.precision();
+        report << summary.commands << " commands, " << summary.succeeded << " succeeded, " << summary.failed << " failed, "
+            << summary.transactions << " transactions in " << std::fixed << std::setprecision(1) << summary.elapsed_ms << " ms ("
+            << std::setprecision(0) << summary.commands_per_second << " commands/s)" << std::endl;
+        report.flags(flags);
+        report.precision(precision);
+        return summary;
+    }
+
+    /// <summary>
+    /// runs the commands of a file, "-" reads stdin
+    /// </summary>
+    /// <returns>the summary, empty when the file cannot be opened</returns>
+    std::optional<Summary> runFile(const std::string& path, std::ostream& report)
+    {
+        if (path == "-") {
+            return run(std::cin, report);
+        }
+
+        std::ifstream input(path);
+        if (!input) {
+            std::cerr << "Error in runFile: cannot open " << path << std::endl;
+            return std::nullopt;
+        }
+        return run(input, report);
+    }
+
+private:
+
+    struct Pending
+    {
+        size_t line_number;
+        std::future<ApplicationController::CommandResult> result;
+    };
+
+    struct QueuedWrite
+    {
+        size_t line_number;
+        std::string line;
+    };
+
+    //where the command of a line runs, read from its first word. a quoted command word is left
+    //to the controller, the line then takes the current side
+    std::optional<ApplicationController::Workload> workloadOf(std::string_view line) const
+    {
+        std::string_view word = line.substr(0, line.find_first_of(" \t\r\n"));
+        if (word.find('"') != std::string_view::npos) {
+            return std::nullopt;
+        }
+        if (table.has_value()) {
+            const CommandSpec* command = table->find(word);
+            return command == nullptr ? std::nullopt : std::optional<ApplicationController::Workload>(command->workload);
+        }
+        return controller->workloadOf(word);
+    }
+
+    void flushWrites()
+    {
+        if (writes.empty()) {
+            return;
+        }
+
+        std::vector<std::string> lines;
+        lines.reserve(writes.size());
+        for (const QueuedWrite& write : writes) {
+            lines.push_back(write.line);
+        }
+        std::vector<std::future<ApplicationController::CommandResult>> results = controller->executeTransaction(token, lines);
+        for (size_t index = 0; index < writes.size(); ++index) {
+            in_flight.push_back({ writes[index].line_number, std::move(results[index]) });
+        }
+        writes.clear();
+        ++summary.transactions;
+    }
+
+    //reports finished commands in script order until at most limit are outstanding
+    void drain(std::ostream& report, size_t limit)
+    {
+        while (in_flight.size() > limit)
+        {
+            Pending& pending = in_flight.front();
+            ApplicationController::CommandResult result = pending.result.get();
+
+            ++summary.commands;
+            if (result.success) {
+                ++summary.succeeded;
+            }
+            else {
+                ++summary.failed;
+            }
+            std::ios::fmtflags flags = report.flags();
+            std::streamsize precision = report.precision();
+            report << pending.line_number << '\t' << (result.success ? "ok" : "error") << '\t'
+                << std::fixed << std::setprecision(3) << result.elapsed_us / 1000.0 << " ms\t"
+                << (result.success ? (result.output.is_null() ? "" : result.output.dump()) : result.error) << '\n';
+            report.flags(flags);
+            report.precision(precision);
+            in_flight.pop_front();
+        }
+    }
+
+    ApplicationController* controller;
+    std::string token;
+    size_t max_in_flight;
+    size_t max_transaction;
+    std::optional<CommandTableView> table;
+
+    Summary summary;
+    std::deque<Pending> in_flight;
+    std::vector<QueuedWrite> writes;
+    bool writing = false;
+};
+
+#endif //COMMANDLINE_HPP
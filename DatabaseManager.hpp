@@ -7,8 +7,15 @@
 #include <stdexcept>
 #include <iostream>
 #include <map>
+#include <optional>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iterator>
 #include "nlohmann\\json.hpp"
 
+class RecordObserver;
+
 /// <summary>
 /// Base level sqlite3 interface class
 /// @date: 11/26/23
@@ -24,6 +31,7 @@ public:
             std::cerr << "Failed to open database: " << sqlite3_errmsg(database_connection) << std::endl;
             exit(EXIT_FAILURE);
         }
+        sqlite3_rollback_hook(database_connection, &DatabaseManager::onRollback, this);
     }
     
     //Destructor
@@ -41,6 +49,20 @@ public:
             sqlite3_close(database_connection);
             exit(EXIT_FAILURE);
         }
+        notifyIfCommitted();
+    }
+
+    //same as executeQuery but reports failure to the caller instead of terminating,
+    //for statements that are allowed to fail such as a transaction that has to roll back
+    bool tryExecuteQuery(const std::string& query) {
+        char* error_message = nullptr;
+        if (sqlite3_exec(database_connection, query.c_str(), nullptr, nullptr, &error_message) != SQLITE_OK) {
+            std::cerr << "Error in tryExecuteQuery: " << error_message << std::endl;
+            sqlite3_free(error_message);
+            return false;
+        }
+        notifyIfCommitted();
+        return true;
     }
 
     void createTableIfNotExists(const std::string& table_name, const std::string& table_schema) {
@@ -48,6 +70,97 @@ public:
         executeQuery(create_table_sql);
     }
 
+    //handed to every DAO built on this connection afterwards, so writes made through a DAO
+    //created for a single call still reach observers such as the session manager
+    void addRecordObserver(RecordObserver* observer) {
+        record_observers.push_back(observer);
+    }
+
+    const std::vector<RecordObserver*>& getRecordObservers() const {
+        return record_observers;
+    }
+
+    // Transactions -----------------------------------------------------------------------------------------
+
+    enum class TransactionEvent {
+        OPEN,
+        RELEASE,
+        ROLLBACK,
+        //a prepared statement is about to run, sqlite undoes its rows alone when it fails
+        STATEMENT,
+        STATEMENT_FAILED,
+        //a statement left the connection in autocommit mode, so a transaction it ended has committed
+        COMMIT,
+        //the whole transaction rolled back, by ROLLBACK or by sqlite after an error. reported from
+        //inside sqlite's rollback hook, the listener must not use the connection
+        ABORT
+    };
+
+    //told about nested transactions, statement boundaries and completed commits, which sqlite's
+    //own hooks do not report, see ChangeCapture
+    void setTransactionListener(std::function<void(TransactionEvent)> listener) {
+        transaction_listener = std::move(listener);
+    }
+
+    //runs callback once the writes made so far are committed: at once outside a transaction,
+    //otherwise when the outermost transaction commits. dropped when the savepoint or transaction
+    //it was queued in rolls back, so observers never follow a write that did not stick
+    void runAfterCommit(std::function<void()> callback) {
+        if (sqlite3_get_autocommit(database_connection)) {
+            callback();
+            return;
+        }
+        pending_outcomes.push_back({ std::move(callback), true });
+    }
+
+    //runs callback when the savepoint or transaction open now rolls back, for state kept outside
+    //the database that has to be undone with it. dropped on commit and outside a transaction.
+    //may run from inside sqlite's rollback hook, the callback must not use the connection
+    void runAfterRollback(std::function<void()> callback) {
+        if (sqlite3_get_autocommit(database_connection)) {
+            return;
+        }
+        pending_outcomes.push_back({ std::move(callback), false });
+    }
+
+    //inside an open transaction a begin opens a savepoint instead, so a DAO call that wraps
+    //itself in a transaction can run as one step of a caller's larger transaction
+    bool beginTransaction() {
+        return beginFrame("BEGIN;");
+    }
+
+    //takes the write lock at BEGIN, a batch holding it cannot fail halfway with SQLITE_BUSY
+    bool beginImmediateTransaction() {
+        return beginFrame("BEGIN IMMEDIATE;");
+    }
+
+    bool commitTransaction() {
+        if (openSavepoints() > 0) {
+            if (!tryExecuteQuery("RELEASE nested_" + std::to_string(savepoint_depth) + ";")) {
+                return false;
+            }
+            --savepoint_depth;
+            if (!pending_marks.empty()) {
+                pending_marks.pop_back();
+            }
+            notifyTransaction(TransactionEvent::RELEASE);
+            return true;
+        }
+        return tryExecuteQuery("COMMIT;");
+    }
+
+    //a nested rollback only undoes the work since its savepoint, the outer transaction stays open
+    bool rollbackTransaction() {
+        if (openSavepoints() > 0) {
+            std::string savepoint = "nested_" + std::to_string(savepoint_depth--);
+            bool rolled_back = tryExecuteQuery("ROLLBACK TO " + savepoint + ";");
+            settleSavepoint(rolled_back);
+            notifyTransaction(rolled_back ? TransactionEvent::ROLLBACK : TransactionEvent::RELEASE);
+            return rolled_back && tryExecuteQuery("RELEASE " + savepoint + ";");
+        }
+        return tryExecuteQuery("ROLLBACK;");
+    }
+
     // Prepared Statements ----------------------------------------------------------------------------------
 
     bool prepareStatement(const std::string& sql) {
@@ -58,6 +171,7 @@ public:
             return false;
         }
 
+        notifyTransaction(TransactionEvent::STATEMENT);
         return true;
     }
 
@@ -73,14 +187,96 @@ public:
             std::cerr << "Error in executePrepared: " << sqlite3_errmsg(database_connection) << std::endl;
             sqlite3_reset(prepared_statement);
             statement_error = false;
+            notifyTransaction(TransactionEvent::STATEMENT_FAILED);
             return false;
         }
         //successful execution of prepared statement
         sqlite3_finalize(prepared_statement);
         statement_error = false;
+        notifyIfCommitted();
+        return true;
+    }
+
+
+    //steps the prepared statement and rewinds it with cleared bindings instead of finalizing,
+    //so a single INSERT can be reused across many rows, failures are left in getLastError
+    bool executeAndReset() {
+        if (statement_error == true)
+        {
+            last_error = "previous error prevents futher modification";
+            sqlite3_reset(prepared_statement);
+            sqlite3_clear_bindings(prepared_statement);
+            statement_error = false;
+            return false;
+        }
+
+        bool success = sqlite3_step(prepared_statement) == SQLITE_DONE;
+        if (!success) {
+            last_error = sqlite3_errmsg(database_connection);
+        }
+        sqlite3_reset(prepared_statement);
+        sqlite3_clear_bindings(prepared_statement);
+
+        //each step is a statement of its own, a failing row does not undo the rows before it
+        if (success) {
+            notifyIfCommitted();
+        }
+        notifyTransaction(success ? TransactionEvent::STATEMENT : TransactionEvent::STATEMENT_FAILED);
+        return success;
+    }
+
+    //steps a statement that returns rows, such as an INSERT ... RETURNING, handing each row to
+    //read_row, then finalizes it. reported to the listener and to runAfterCommit like executePrepared
+    template <typename ReadRow>
+    bool executeReturning(ReadRow read_row) {
+        if (statement_error == true)
+        {
+            std::cerr << "Error in executeReturning: previous error prevents futher modification" << std::endl;
+            sqlite3_finalize(prepared_statement);
+            statement_error = false;
+            return false;
+        }
+
+        int result;
+        while ((result = sqlite3_step(prepared_statement)) == SQLITE_ROW) {
+            read_row(prepared_statement);
+        }
+        if (result != SQLITE_DONE) {
+            std::cerr << "Error in executeReturning: " << sqlite3_errmsg(database_connection) << std::endl;
+            sqlite3_finalize(prepared_statement);
+            notifyTransaction(TransactionEvent::STATEMENT_FAILED);
+            return false;
+        }
+        sqlite3_finalize(prepared_statement);
+        notifyIfCommitted();
         return true;
     }
 
+    //discards pending bindings and any bind error so the statement can take a fresh row
+    void clearPrepared() {
+        sqlite3_reset(prepared_statement);
+        sqlite3_clear_bindings(prepared_statement);
+        statement_error = false;
+    }
+
+    void finalizePrepared() {
+        sqlite3_finalize(prepared_statement);
+        prepared_statement = nullptr;
+        statement_error = false;
+    }
+
+    //rows modified by the most recently completed INSERT, UPDATE or DELETE
+    int getChangedRowCount() {
+        return sqlite3_changes(database_connection);
+    }
+
+    sqlite3_int64 getLastInsertRowId() {
+        return sqlite3_last_insert_rowid(database_connection);
+    }
+
+    const std::string& getLastError() const {
+        return last_error;
+    }
 
     sqlite3_stmt* getPreparedStatement() {
         return prepared_statement;
@@ -105,9 +301,15 @@ public:
         else if constexpr (std::is_same_v<T, int>) {
             result = sqlite3_bind_int(prepared_statement, param_index, value);
         }
+        else if constexpr (std::is_same_v<T, long long>) {
+            result = sqlite3_bind_int64(prepared_statement, param_index, value);
+        }
         else if constexpr (std::is_same_v<T, double>) {
             result = sqlite3_bind_double(prepared_statement, param_index, value);
         }
+        else if constexpr (std::is_same_v<T, std::vector<unsigned char>>) {
+            result = sqlite3_bind_blob(prepared_statement, param_index, value.data(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
+        }
         else {
             std::cerr << "Error: Unsupported data type" << std::endl;
             statement_error = true;
@@ -192,11 +394,108 @@ public:
 
 private:
 
+    bool beginFrame(const std::string& begin) {
+        if (sqlite3_get_autocommit(database_connection)) {
+            savepoint_depth = 0;
+            //a commit stepped by hand outside this class is settled before the next one starts
+            notifyIfCommitted();
+            return tryExecuteQuery(begin);
+        }
+        if (!tryExecuteQuery("SAVEPOINT nested_" + std::to_string(savepoint_depth + 1) + ";")) {
+            return false;
+        }
+        ++savepoint_depth;
+        pending_marks.push_back(pending_outcomes.size());
+        notifyTransaction(TransactionEvent::OPEN);
+        return true;
+    }
+
+    void notifyTransaction(TransactionEvent event) {
+        if (transaction_listener) {
+            transaction_listener(event);
+        }
+    }
+
+    void notifyIfCommitted() {
+        if (sqlite3_get_autocommit(database_connection)) {
+            notifyTransaction(TransactionEvent::COMMIT);
+            settleCommit();
+        }
+    }
+
+    //taken out before running, a callback that writes through this connection queues afresh
+    void settleCommit() {
+        if (pending_outcomes.empty()) {
+            return;
+        }
+        std::vector<PendingOutcome> settled;
+        settled.swap(pending_outcomes);
+        pending_marks.clear();
+        for (PendingOutcome& outcome : settled) {
+            if (outcome.on_commit) {
+                outcome.callback();
+            }
+        }
+    }
+
+    //a savepoint that could not roll back stays part of its parent, as if it had been released
+    void settleSavepoint(bool rolled_back) {
+        if (pending_marks.empty()) {
+            return;
+        }
+        size_t mark = std::min(pending_marks.back(), pending_outcomes.size());
+        pending_marks.pop_back();
+        if (!rolled_back) {
+            return;
+        }
+        std::vector<PendingOutcome> undone(std::make_move_iterator(pending_outcomes.begin() + mark), std::make_move_iterator(pending_outcomes.end()));
+        pending_outcomes.resize(mark);
+        for (PendingOutcome& outcome : undone) {
+            if (!outcome.on_commit) {
+                outcome.callback();
+            }
+        }
+    }
+
+    static void onRollback(void* context) {
+        DatabaseManager* manager = static_cast<DatabaseManager*>(context);
+        std::vector<PendingOutcome> undone;
+        undone.swap(manager->pending_outcomes);
+        manager->pending_marks.clear();
+        for (PendingOutcome& outcome : undone) {
+            if (!outcome.on_commit) {
+                outcome.callback();
+            }
+        }
+        manager->notifyTransaction(TransactionEvent::ABORT);
+    }
+
+    //sqlite ends the whole transaction on some errors, savepoints do not outlive it
+    int openSavepoints() {
+        if (sqlite3_get_autocommit(database_connection)) {
+            savepoint_depth = 0;
+        }
+        return savepoint_depth;
+    }
+
+    struct PendingOutcome {
+        std::function<void()> callback;
+        bool on_commit;
+    };
+
     bool statement_error;
+    int savepoint_depth = 0;
+    //callbacks waiting on the open transaction, marks hold where each savepoint's began
+    std::vector<PendingOutcome> pending_outcomes;
+    std::vector<size_t> pending_marks;
+    std::function<void(TransactionEvent)> transaction_listener;
+    std::vector<RecordObserver*> record_observers;
     sqlite3* database_connection = nullptr;
     sqlite3_stmt* prepared_statement = nullptr;
     std::string database_path;
+    std::string last_error;
     friend class GenericDAO;
+    friend class ChangeCapture;
 
 };
 
@@ -0,0 +1,1011 @@
+#ifndef ELEMENTDAO_HPP
+#define ELEMENTDAO_HPP
+
+#include "DatabaseManager.hpp"
+#include "GenericDAO.hpp"
+#include "ElementGuid.hpp"
+#include <string>
+#include <optional>
+#include "nlohmann\\json.hpp"
+#include <chrono>
+
+//Element rows form the WAREHOUSE > STOREROOM > BAY > RACK > SHELF > CONTAINER > ITEM tree
+//through element_parent_guid. alongside it the ElementClosure table stores one row for every
+//ancestor/descendant pair with the distance between them, kept in step with the tree inside
+//the same transaction as each insert and move, so subtree, ancestor path and containment
+//questions are single indexed queries no matter how deep the nesting goes
+class ElementDAO : public GenericDAO {
+public:
+
+    enum class ElementClass
+    {
+        WAREHOUSE,
+        STOREROOM,
+        BAY,
+        RACK,
+        SHELF,
+        CONTAINER,
+        ITEM,
+        BULK,
+        MATERIAL
+    };
+
+    //what happens to the children of an element that is truly deleted
+    enum class DeletionContingency
+    {
+        ASSIGN_TO_PARENT,
+        ASSIGN_TO_ROOT,
+        DEPRECATE,
+        CASCADE
+    };
+
+    inline static const std::string root_guid = "000000";
+    inline static const std::string deprecated_guid = "111111";
+
+    //user_permission of ADMIN, ordered LOCK 0, BASE 1, SUPER 2, ADMIN 3
+    inline static const int admin_permission = 3;
+
+    ElementDAO(DatabaseManager &db_manager) : GenericDAO(&db_manager) {}
+
+    //records inserted without an element_guid are given one from the generator
+    void setGuidGenerator(ElementGuid* generator)
+    {
+        guid_generator = generator;
+    }
+
+    //guid of the element written by the last successful insertRecord, generated or supplied
+    const std::string& getLastInsertedGuid() const
+    {
+        return last_inserted_guid;
+    }
+
+    //closure rows are (ancestor, descendant, depth) with a depth 0 row of every element to itself,
+    //an existing Element table is walked once to seed an empty closure
+    void createHierarchyTables()
+    {
+        db_manager->executeQuery(
+            "CREATE TABLE IF NOT EXISTS ElementClosure ("
+            "closure_ancestor       TEXT        NOT NULL, "
+            "closure_descendant     TEXT        NOT NULL, "
+            "closure_depth          INTEGER     NOT NULL, "
+            "PRIMARY KEY (closure_ancestor, closure_descendant)"
+            ") WITHOUT ROWID;");
+        db_manager->executeQuery(
+            "CREATE INDEX IF NOT EXISTS ElementClosure_descendant ON ElementClosure (closure_descendant, closure_depth);");
+        db_manager->executeQuery(
+            "CREATE INDEX IF NOT EXISTS Element_parent ON Element (element_parent_guid);");
+
+        db_manager->prepareStatement("SELECT NOT EXISTS(SELECT 1 FROM ElementClosure) AND EXISTS(SELECT 1 FROM Element);");
+        if (db_manager->fetchBooleanResult()) {
+            db_manager->executeQuery(
+                "INSERT INTO ElementClosure (closure_ancestor, closure_descendant, closure_depth) "
+                "WITH RECURSIVE paths (ancestor, descendant, depth) AS ("
+                "SELECT element_guid, element_guid, 0 FROM Element "
+                "UNION ALL "
+                "SELECT paths.ancestor, Element.element_guid, paths.depth + 1 FROM paths "
+                "JOIN Element ON Element.element_parent_guid = paths.descendant) "
+                "SELECT ancestor, descendant, depth FROM paths;");
+        }
+    }
+
+    //the C in CRUD, element and its closure rows are written in one transaction
+    bool insertRecord(const nlohmann::json& json_data) override
+    {
+        std::string guid;
+        if (json_data.contains("element_guid") && json_data["element_guid"].is_string()) {
+            guid = json_data["element_guid"].get<std::string>();
+            if (!ElementGuid::isCanonical(guid)) {
+                std::cerr << "Error in insertRecord: " << guid << " is not a base32 element guid" << std::endl;
+                return false;
+            }
+        }
+        else if (guid_generator != nullptr) {
+            auto generated = guid_generator->next();
+            if (!generated.has_value()) {
+                return false;
+            }
+            guid = generated.value();
+        }
+        else {
+            std::cerr << "Error in insertRecord: element_guid missing and no generator set" << std::endl;
+            return false;
+        }
+
+        std::optional<std::string> parent_guid;
+        if (json_data.contains("element_parent_guid") && !json_data["element_parent_guid"].is_null()) {
+            parent_guid = json_data["element_parent_guid"].get<std::string>();
+            if (!existenceOfRecordByField("element_guid", parent_guid.value())) {
+                std::cerr << "Error in insertRecord: parent " << parent_guid.value() << " does not exist" << std::endl;
+                return false;
+            }
+        }
+
+        if (!db_manager->beginTransaction()) {
+            return false;
+        }
+
+        std::string parameter_insert =
+            "INSERT INTO Element (element_guid, element_name, element_description, element_class, element_parent_guid, "
+            "element_owner, element_thumbpath, element_visibility, element_timestamp) "
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);";
+
+        db_manager->prepareStatement(parameter_insert);
+
+        //required bindings already validated
+        db_manager->bindParameter<std::string>(1, guid);
+        db_manager->bindParameter<std::string>(2, json_data["element_name"]);
+        db_manager->bindOptional<std::string>(3, json_data, "element_description", std::nullopt);
+        db_manager->bindParameter<int>(4, json_data["element_class"]);
+        db_manager->bindOptional<std::string>(5, json_data, "element_parent_guid", std::nullopt);
+        db_manager->bindParameter<int>(6, json_data["element_owner"]);
+        db_manager->bindOptional<std::string>(7, json_data, "element_thumbpath", std::nullopt);
+        db_manager->bindOptional<int>(8, json_data, "element_visibility", 1);
+        db_manager->bindOptional<int>(9, json_data, "element_timestamp", std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+        if (!db_manager->executePrepared())
+        {
+            std::cerr << "Error in insertRecord" << std::endl;
+            db_manager->rollbackTransaction();
+            return false;
+        }
+
+        //the new element is a descendant of everything its parent descends from, plus itself
+        db_manager->prepareStatement(
+            "INSERT INTO ElementClosure (closure_ancestor, closure_descendant, closure_depth) "
+            "SELECT closure_ancestor, ?1, closure_depth + 1 FROM ElementClosure WHERE closure_descendant = ?2 "
+            "UNION ALL SELECT ?1, ?1, 0;");
+        db_manager->bindParameter<std::string>(1, guid);
+        if (parent_guid.has_value()) {
+            db_manager->bindParameter<std::string>(2, parent_guid.value());
+        }
+        else {
+            db_manager->bindNull(2);
+        }
+
+        if (!db_manager->executePrepared() || !db_manager->commitTransaction())
+        {
+            std::cerr << "Error in insertRecord" << std::endl;
+            db_manager->rollbackTransaction();
+            return false;
+        }
+
+        last_inserted_guid = guid;
+        nlohmann::json inserted = json_data;
+        inserted["element_guid"] = guid;
+        notifyInserted("Element", inserted);
+        return true;
+    }
+
+    //ids of elements are the packed value of their guid, unlike the implicit rowid of Element
+    //which VACUUM may renumber they stay the same for the life of the element
+    static std::optional<int> getIdGivenGuid(const std::string& guid)
+    {
+        auto packed = ElementGuid::decode(guid);
+        if (!packed.has_value()) {
+            return std::nullopt;
+        }
+        return static_cast<int>(packed.value());
+    }
+
+    //R in CRUD
+    nlohmann::json retrieveRecordById(int id) override
+    {
+        auto guid = guidOfId(id);
+        if (!guid.has_value()) {
+            return nlohmann::json();
+        }
+        return retrieveRecordByGuid(guid.value());
+    }
+
+    nlohmann::json retrieveRecordByGuid(const std::string& guid)
+    {
+        return retrieveSingle("SELECT " + element_columns + " FROM Element WHERE element_guid = ?;", guid);
+    }
+
+    //U in CRUD, the parent is changed through moveElement so the closure follows it and the owner
+    //through transferOwnership so its permission checks apply. an element holding stock keeps a
+    //class that can hold stock
+    bool updateRecordById(int id, nlohmann::json& json_data) override
+    {
+        auto guid = guidOfId(id);
+        if (!guid.has_value()) {
+            std::cerr << "Error in updateRecordById: " << id << " is not an element id" << std::endl;
+            return false;
+        }
+
+        if (json_data.contains("element_class") && stock_tracked && !holdsStock(json_data["element_class"].get<int>())) {
+            db_manager->prepareStatement("SELECT EXISTS(SELECT 1 FROM ElementStock WHERE stock_element = ?);");
+            db_manager->bindParameter<std::string>(1, guid.value());
+            if (db_manager->fetchBooleanResult()) {
+                std::cerr << "Error in updateRecordById: " << guid.value() << " holds stock, its class cannot change to " << json_data["element_class"].get<int>() << std::endl;
+                return false;
+            }
+        }
+
+        const std::map<std::string, DataType> mutable_fields =
+        {
+            {"element_name", DataType::TEXT},
+            {"element_description", DataType::TEXT},
+            {"element_class", DataType::INTEGER},
+            {"element_thumbpath", DataType::TEXT},
+            {"element_visibility", DataType::INTEGER}
+        };
+        std::string sql = "UPDATE Element SET ";
+        bool first = true;
+
+        // First Pass: Build SQL Query
+        for (const auto& field : mutable_fields) {
+            if (json_data.contains(field.first)) {
+                if (!first) {
+                    sql += ", ";
+                }
+                sql += field.first + " = ?";
+                first = false;
+            }
+        }
+
+        if (first) {
+            std::cerr << "No valid fields provided for update." << std::endl;
+            return false;
+        }
+
+        sql += " WHERE element_guid = ?;";
+        db_manager->prepareStatement(sql);
+
+        // Second Pass: Bind Parameters
+        int param_index = 1;
+        for (const auto& field : mutable_fields) {
+            if (json_data.contains(field.first)) {
+                switch (field.second) {
+                case DataType::TEXT:
+                    db_manager->bindParameter<std::string>(param_index, json_data.at(field.first).get<std::string>());
+                    break;
+                case DataType::INTEGER:
+                    db_manager->bindParameter<int>(param_index, json_data.at(field.first).get<int>());
+                    break;
+                case DataType::REAL:
+                    db_manager->bindParameter<double>(param_index, json_data.at(field.first).get<double>());
+                    break;
+                }
+                ++param_index;
+            }
+        }
+
+        db_manager->bindParameter<std::string>(param_index, guid.value());
+
+        if (!db_manager->executePrepared()) {
+            std::cerr << "Error in updateRecordById" << std::endl;
+            return false;
+        }
+
+        if (!observers.empty()) {
+            notifyUpdated("Element", retrieveRecordByGuid(guid.value()));
+        }
+        return true;
+    }
+
+    //D in CRUD, elements are hidden rather than removed so ownership history is kept
+    bool deleteRecordById(int id) override
+    {
+        auto guid = guidOfId(id);
+        if (!guid.has_value()) {
+            std::cerr << "Error in deleteRecordById: " << id << " is not an element id" << std::endl;
+            return false;
+        }
+
+        std::string sql = "UPDATE Element SET element_visibility = ? WHERE element_guid = ?;";
+        db_manager->prepareStatement(sql);
+        db_manager->bindParameter<int>(1, 0);
+        db_manager->bindParameter<std::string>(2, guid.value());
+        if (!db_manager->executePrepared())
+        {
+            std::cerr << "Error in deleteRecordById." << std::endl;
+            return false;
+        }
+
+        if (!observers.empty()) {
+            notifyUpdated("Element", retrieveRecordByGuid(guid.value()));
+        }
+        return true;
+    }
+
+    bool existenceOfRecordByField(const std::string& field_name, const std::string& value) {
+        return GenericDAO::existenceOfRecordByField("Element", field_name, value);
+    }
+
+    // Hierarchy ------------------------------------------------------------------------------------------
+
+    //reparents an element with its whole subtree in a fixed number of statements regardless
+    //of subtree size. an element cannot be moved into its own subtree
+    bool moveElement(const std::string& guid, const std::optional<std::string>& new_parent_guid)
+    {
+        if (!validateDestination(guid, new_parent_guid, "moveElement")) {
+            return false;
+        }
+
+        if (!db_manager->beginTransaction()) {
+            return false;
+        }
+
+        db_manager->prepareStatement("UPDATE Element SET element_parent_guid = ? WHERE element_guid = ?;");
+        bindOptionalGuid(1, new_parent_guid);
+        db_manager->bindParameter<std::string>(2, guid);
+        bool success = db_manager->executePrepared() && db_manager->getChangedRowCount() == 1;
+
+        success = success && relinkSubtree(guid, true, new_parent_guid);
+
+        if (!success || !db_manager->commitTransaction()) {
+            std::cerr << "Error in moveElement" << std::endl;
+            db_manager->rollbackTransaction();
+            return false;
+        }
+
+        notifyParentChanged({ guid }, new_parent_guid);
+        return true;
+    }
+
+    //moves every child of an element, with their subtrees, under another parent in one transaction
+    bool relocateChildren(const std::string& guid, const std::optional<std::string>& new_parent_guid)
+    {
+        if (!validateDestination(guid, new_parent_guid, "relocateChildren")) {
+            return false;
+        }
+
+        if (!db_manager->beginTransaction()) {
+            return false;
+        }
+
+        std::vector<std::string> children = observers.empty() ? std::vector<std::string>() : retrieveGuids(
+            "SELECT element_guid FROM Element WHERE element_parent_guid = ?;", guid);
+        bool success = relocateChildrenInTransaction(guid, new_parent_guid);
+
+        if (!success || !db_manager->commitTransaction()) {
+            std::cerr << "Error in relocateChildren" << std::endl;
+            db_manager->rollbackTransaction();
+            return false;
+        }
+
+        notifyParentChanged(children, new_parent_guid);
+        return true;
+    }
+
+    //true deletion of an element, its children are first relocated according to the chosen
+    //contingency or removed along with it for CASCADE. callers are responsible for limiting
+    //this to admins with password confirmation, everyone else hides elements via deleteRecordById
+    bool deleteElement(const std::string& guid, DeletionContingency contingency)
+    {
+        if (guid == root_guid || guid == deprecated_guid) {
+            std::cerr << "Error in deleteElement: reserved element " << guid << " cannot be deleted" << std::endl;
+            return false;
+        }
+
+        nlohmann::json element = retrieveRecordByGuid(guid);
+        if (element.is_null()) {
+            std::cerr << "Error in deleteElement: " << guid << " does not exist" << std::endl;
+            return false;
+        }
+
+        std::optional<std::string> new_parent_guid;
+        switch (contingency) {
+        case DeletionContingency::ASSIGN_TO_PARENT:
+            if (element.contains("element_parent_guid")) {
+                new_parent_guid = element["element_parent_guid"].get<std::string>();
+            }
+            break;
+        case DeletionContingency::ASSIGN_TO_ROOT:
+            new_parent_guid = root_guid;
+            break;
+        case DeletionContingency::DEPRECATE:
+            new_parent_guid = deprecated_guid;
+            break;
+        case DeletionContingency::CASCADE:
+            break;
+        }
+
+        if (contingency != DeletionContingency::CASCADE && !validateDestination(guid, new_parent_guid, "deleteElement")) {
+            return false;
+        }
+
+        if (!db_manager->beginTransaction()) {
+            return false;
+        }
+
+        std::vector<std::string> children;
+        std::vector<std::string> removed = { guid };
+        if (!observers.empty()) {
+            children = retrieveGuids("SELECT element_guid FROM Element WHERE element_parent_guid = ?;", guid);
+            if (contingency == DeletionContingency::CASCADE) {
+                removed = retrieveGuids(
+                    "SELECT closure_descendant FROM ElementClosure WHERE closure_ancestor = ? ORDER BY closure_depth DESC;", guid);
+            }
+        }
+
+        bool success = contingency == DeletionContingency::CASCADE || relocateChildrenInTransaction(guid, new_parent_guid);
+
+        //after relocation the subtree is the element alone, with CASCADE it is everything below it too
+        if (stock_tracked) {
+            success = success && executeWithGuid(
+                "INSERT INTO StockLevels (level_node, level_key, level_quantity) "
+                "SELECT above.closure_ancestor, level_key, -level_quantity FROM ElementClosure AS above "
+                "JOIN StockLevels ON level_node = ?1 WHERE above.closure_descendant = ?1 AND above.closure_depth >= 1 "
+                "ON CONFLICT (level_node, level_key) DO UPDATE SET level_quantity = level_quantity + excluded.level_quantity;", guid);
+            success = success && executeWithGuid(
+                "DELETE FROM StockLevels WHERE level_node IN "
+                "(SELECT closure_descendant FROM ElementClosure WHERE closure_ancestor = ?1);", guid);
+            success = success && executeWithGuid(
+                "DELETE FROM ElementStock WHERE stock_element IN "
+                "(SELECT closure_descendant FROM ElementClosure WHERE closure_ancestor = ?1);", guid);
+        }
+        success = success && executeWithGuid(
+            "DELETE FROM Element WHERE element_guid IN "
+            "(SELECT closure_descendant FROM ElementClosure WHERE closure_ancestor = ?1);", guid);
+        success = success && executeWithGuid(
+            "DELETE FROM ElementClosure WHERE closure_descendant IN "
+            "(SELECT closure_descendant FROM ElementClosure WHERE closure_ancestor = ?1);", guid);
+
+        if (!success || !db_manager->commitTransaction()) {
+            std::cerr << "Error in deleteElement" << std::endl;
+            db_manager->rollbackTransaction();
+            return false;
+        }
+
+        if (contingency != DeletionContingency::CASCADE) {
+            notifyParentChanged(children, new_parent_guid);
+        }
+        for (const std::string& removed_guid : removed) {
+            notifyDeleted("Element", { {"element_guid", removed_guid} });
+        }
+        return true;
+    }
+
+    //root 000000 collects reassigned elements and 111111 deprecated ones, both created on first use
+    bool createReservedRoots(int owner_id)
+    {
+        for (const std::string& guid : { root_guid, deprecated_guid })
+        {
+            if (existenceOfRecordByField("element_guid", guid)) {
+                continue;
+            }
+
+            nlohmann::json element_data =
+            {
+                {"element_guid", guid},
+                {"element_name", guid == root_guid ? "ROOT" : "DEPRECATED"},
+                {"element_class", static_cast<int>(ElementClass::WAREHOUSE)},
+                {"element_owner", owner_id}
+            };
+            if (!insertRecord(element_data)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //every element below the given one, nearest first, each record carrying its closure_depth
+    nlohmann::json retrieveSubtree(const std::string& guid)
+    {
+        return retrieveList(
+            "SELECT " + element_columns + ", closure_depth FROM ElementClosure "
+            "JOIN Element ON element_guid = closure_descendant "
+            "WHERE closure_ancestor = ? AND closure_depth > 0 ORDER BY closure_depth;", guid);
+    }
+
+    //the chain from the root down to and including the given element
+    nlohmann::json retrieveAncestorPath(const std::string& guid)
+    {
+        return retrieveList(
+            "SELECT " + element_columns + ", closure_depth FROM ElementClosure "
+            "JOIN Element ON element_guid = closure_ancestor "
+            "WHERE closure_descendant = ? ORDER BY closure_depth DESC;", guid);
+    }
+
+    //true when guid is somewhere below container_guid
+    bool isInside(const std::string& guid, const std::string& container_guid)
+    {
+        db_manager->prepareStatement(
+            "SELECT EXISTS(SELECT 1 FROM ElementClosure WHERE closure_ancestor = ? AND closure_descendant = ? AND closure_depth > 0);");
+        db_manager->bindParameter<std::string>(1, container_guid);
+        db_manager->bindParameter<std::string>(2, guid);
+        return db_manager->fetchBooleanResult();
+    }
+
+    // Ownership ------------------------------------------------------------------------------------------
+
+    struct TransferReport
+    {
+        bool success = false;
+        int affected_rows = 0;
+        double locked_ms = 0.0;
+        double elapsed_ms = 0.0;
+    };
+
+    /// <summary>
+    /// hands an element and everything below it to new_owner in one UPDATE over the closure.
+    /// the acting user must be visible and not locked, and must own the element or be an admin,
+    /// which is checked once inside the same IMMEDIATE transaction so it cannot change between
+    /// check and write. below the element an admin transfers everything while anyone else only
+    /// transfers what they own themselves, elements of other users stay with them. descendants
+    /// already owned by new_owner are left untouched and not counted
+    /// </summary>
+    TransferReport transferOwnership(const std::string& guid, int new_owner, int acting_user)
+    {
+        TransferReport report;
+        auto start = std::chrono::steady_clock::now();
+
+        if (!existenceOfRecordByField("element_guid", guid)) {
+            std::cerr << "Error in transferOwnership: " << guid << " does not exist" << std::endl;
+            return report;
+        }
+
+        if (!db_manager->beginImmediateTransaction()) {
+            return report;
+        }
+        auto locked = std::chrono::steady_clock::now();
+
+        //permission of the acting user when active, whether the recipient is active and the current owner
+        db_manager->prepareStatement(
+            "SELECT (SELECT user_permission FROM Users WHERE user_id = ?2 AND user_visibility = 1 AND user_permission > 0), "
+            "EXISTS (SELECT 1 FROM Users WHERE user_id = ?3 AND user_visibility = 1 AND user_permission > 0), "
+            "(SELECT element_owner FROM Element WHERE element_guid = ?1);");
+        db_manager->bindParameter<std::string>(1, guid);
+        db_manager->bindParameter<int>(2, acting_user);
+        db_manager->bindParameter<int>(3, new_owner);
+        sqlite3_stmt* check_statement = db_manager->getPreparedStatement();
+
+        bool permitted = false;
+        bool admin = false;
+        if (sqlite3_step(check_statement) == SQLITE_ROW && sqlite3_column_type(check_statement, 0) != SQLITE_NULL) {
+            admin = sqlite3_column_int(check_statement, 0) == admin_permission;
+            permitted = sqlite3_column_int(check_statement, 1) != 0 && (admin || sqlite3_column_int(check_statement, 2) == acting_user);
+        }
+        sqlite3_finalize(check_statement);
+
+        std::vector<std::string> transferred;
+        bool success = permitted;
+        if (success) {
+            success = db_manager->prepareStatement(
+                "UPDATE Element SET element_owner = ?2 WHERE element_owner <> ?2 AND (?3 IS NULL OR element_owner = ?3) AND element_guid IN "
+                "(SELECT closure_descendant FROM ElementClosure WHERE closure_ancestor = ?1) RETURNING element_guid;");
+            db_manager->bindParameter<std::string>(1, guid);
+            db_manager->bindParameter<int>(2, new_owner);
+            if (admin) {
+                db_manager->bindNull(3);
+            }
+            else {
+                db_manager->bindParameter<int>(3, acting_user);
+            }
+            success = success && db_manager->executeReturning([&transferred](sqlite3_stmt* row) {
+                transferred.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(row, 0)));
+            });
+        }
+
+        if (!success || !db_manager->commitTransaction()) {
+            if (!permitted) {
+                std::cerr << "Error in transferOwnership: user " << acting_user << " may not transfer " << guid
+                    << " to user " << new_owner << std::endl;
+            }
+            else {
+                std::cerr << "Error in transferOwnership" << std::endl;
+            }
+            db_manager->rollbackTransaction();
+            return report;
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        report.success = true;
+        report.affected_rows = static_cast<int>(transferred.size());
+        report.locked_ms = std::chrono::duration<double, std::milli>(end - locked).count();
+        report.elapsed_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+        for (const std::string& transferred_guid : transferred) {
+            notifyUpdated("Element", { {"element_guid", transferred_guid}, {"element_owner", new_owner} });
+        }
+        return report;
+    }
+
+    // Stock Levels ---------------------------------------------------------------------------------------
+
+    //ElementStock holds what a BULK or MATERIAL element contains itself, StockLevels the total of
+    //each stock key at and below every element. every quantity change adds its delta to the levels
+    //of all ancestors through the closure, and moves and deletions shift a subtree's totals from
+    //the old ancestors to the new ones, so a level is always a single primary key lookup
+    void createStockTables()
+    {
+        db_manager->executeQuery(
+            "CREATE TABLE IF NOT EXISTS ElementStock ("
+            "stock_element          TEXT        NOT NULL, "
+            "stock_key              TEXT        NOT NULL, "
+            "stock_quantity         REAL        NOT NULL        CHECK(stock_quantity >= 0), "
+            "PRIMARY KEY (stock_element, stock_key), "
+            "FOREIGN KEY (stock_element) REFERENCES Element(element_guid) ON DELETE CASCADE"
+            ") WITHOUT ROWID;");
+        db_manager->executeQuery(
+            "CREATE TABLE IF NOT EXISTS StockLevels ("
+            "level_node             TEXT        NOT NULL, "
+            "level_key              TEXT        NOT NULL, "
+            "level_quantity         REAL        NOT NULL, "
+            "PRIMARY KEY (level_node, level_key)"
+            ") WITHOUT ROWID;");
+        stock_tracked = true;
+
+        db_manager->prepareStatement("SELECT NOT EXISTS(SELECT 1 FROM StockLevels) AND EXISTS(SELECT 1 FROM ElementStock);");
+        if (db_manager->fetchBooleanResult()) {
+            rebuildStockLevels();
+        }
+    }
+
+    //recomputes every level from ElementStock, for levels written before tracking was enabled
+    bool rebuildStockLevels()
+    {
+        if (!db_manager->beginTransaction()) {
+            return false;
+        }
+
+        if (!db_manager->tryExecuteQuery(
+            "DELETE FROM StockLevels; "
+            "INSERT INTO StockLevels (level_node, level_key, level_quantity) "
+            "SELECT closure_ancestor, stock_key, sum(stock_quantity) FROM ElementStock "
+            "JOIN ElementClosure ON closure_descendant = stock_element GROUP BY closure_ancestor, stock_key;")
+            || !db_manager->commitTransaction())
+        {
+            std::cerr << "Error in rebuildStockLevels" << std::endl;
+            db_manager->rollbackTransaction();
+            return false;
+        }
+        return true;
+    }
+
+    //sets what the element itself holds of the stock key
+    bool setQuantity(const std::string& guid, const std::string& stock_key, double quantity)
+    {
+        if (quantity < 0) {
+            std::cerr << "Error in setQuantity: quantity cannot be negative" << std::endl;
+            return false;
+        }
+        return changeQuantity(guid, stock_key, quantity, false, "setQuantity");
+    }
+
+    //adds to or takes from what the element itself holds, refused when it would go below zero
+    bool adjustQuantity(const std::string& guid, const std::string& stock_key, double delta)
+    {
+        return changeQuantity(guid, stock_key, delta, true, "adjustQuantity");
+    }
+
+    //quantity of the stock key held by the element itself
+    double retrieveQuantity(const std::string& guid, const std::string& stock_key)
+    {
+        return retrieveStockValue("SELECT stock_quantity FROM ElementStock WHERE stock_element = ? AND stock_key = ?;", guid, stock_key);
+    }
+
+    //quantity of the stock key at and below the element
+    double retrieveStockLevel(const std::string& guid, const std::string& stock_key)
+    {
+        return retrieveStockValue("SELECT level_quantity FROM StockLevels WHERE level_node = ? AND level_key = ?;", guid, stock_key);
+    }
+
+    //every stock key at and below the element with its quantity
+    nlohmann::json retrieveStockLevels(const std::string& guid)
+    {
+        nlohmann::json json_result = nlohmann::json::object();
+
+        db_manager->prepareStatement("SELECT level_key, level_quantity FROM StockLevels WHERE level_node = ? AND level_quantity <> 0 ORDER BY level_key;");
+        db_manager->bindParameter<std::string>(1, guid);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            json_result[reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 0))] = sqlite3_column_double(prepared_statement, 1);
+        }
+
+        sqlite3_finalize(prepared_statement);
+        return json_result;
+    }
+
+private:
+
+    //only BULK and MATERIAL elements hold stock of their own, the levels of the others are totals
+    static bool holdsStock(int element_class)
+    {
+        return element_class == static_cast<int>(ElementClass::BULK) || element_class == static_cast<int>(ElementClass::MATERIAL);
+    }
+
+    static std::optional<std::string> guidOfId(int id)
+    {
+        if (id < 0 || static_cast<uint32_t>(id) >= ElementGuid::space) {
+            return std::nullopt;
+        }
+        return ElementGuid::encode(static_cast<uint32_t>(id));
+    }
+
+    //the destination must exist and lie outside the subtree of the element being moved
+    bool validateDestination(const std::string& guid, const std::optional<std::string>& new_parent_guid, const char* caller)
+    {
+        if (!new_parent_guid.has_value()) {
+            return true;
+        }
+        if (new_parent_guid.value() == guid || isInside(new_parent_guid.value(), guid)) {
+            std::cerr << "Error in " << caller << ": " << guid << " cannot be moved into its own subtree" << std::endl;
+            return false;
+        }
+        if (!existenceOfRecordByField("element_guid", new_parent_guid.value())) {
+            std::cerr << "Error in " << caller << ": parent " << new_parent_guid.value() << " does not exist" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool relocateChildrenInTransaction(const std::string& guid, const std::optional<std::string>& new_parent_guid)
+    {
+        db_manager->prepareStatement("UPDATE Element SET element_parent_guid = ? WHERE element_parent_guid = ?;");
+        bindOptionalGuid(1, new_parent_guid);
+        db_manager->bindParameter<std::string>(2, guid);
+
+        return db_manager->executePrepared() && relinkSubtree(guid, false, new_parent_guid);
+    }
+
+    //rewrites the closure for a set of subtree members in four statements: collect the members
+    //with their depth below the new parent, drop every link reaching them from above the set
+    //and link each ancestor of the new parent to each member. the set is the whole subtree of
+    //guid when include_self, otherwise only what lies strictly below it
+    bool relinkSubtree(const std::string& guid, bool include_self, const std::optional<std::string>& new_parent_guid)
+    {
+        if (!db_manager->tryExecuteQuery(
+            "CREATE TEMP TABLE IF NOT EXISTS ElementRelocation (relocation_member TEXT PRIMARY KEY, relocation_depth INTEGER NOT NULL) WITHOUT ROWID; "
+            "DELETE FROM temp.ElementRelocation;"))
+        {
+            return false;
+        }
+
+        db_manager->prepareStatement(
+            "INSERT INTO temp.ElementRelocation (relocation_member, relocation_depth) "
+            "SELECT closure_descendant, closure_depth + ?2 FROM ElementClosure WHERE closure_ancestor = ?1 AND closure_depth >= 1 - ?2;");
+        db_manager->bindParameter<std::string>(1, guid);
+        db_manager->bindParameter<int>(2, include_self ? 1 : 0);
+        if (!db_manager->executePrepared()) {
+            return false;
+        }
+
+        //the set's stock leaves its old ancestors before their links to it are dropped
+        if (stock_tracked && !shiftRelocatedStock(guid, include_self ? 1 : 0, -1.0)) {
+            return false;
+        }
+
+        //the links from outside the set all start at one of the few elements above it, so the
+        //delete walks the closure primary key of those ancestors instead of every member
+        db_manager->prepareStatement(
+            "DELETE FROM ElementClosure WHERE closure_ancestor IN "
+            "(SELECT closure_ancestor FROM ElementClosure WHERE closure_descendant = ?1 AND closure_depth >= ?2) "
+            "AND closure_descendant IN (SELECT relocation_member FROM temp.ElementRelocation);");
+        db_manager->bindParameter<std::string>(1, guid);
+        db_manager->bindParameter<int>(2, include_self ? 1 : 0);
+        if (!db_manager->executePrepared()) {
+            return false;
+        }
+
+        if (new_parent_guid.has_value())
+        {
+            db_manager->prepareStatement(
+                "INSERT INTO ElementClosure (closure_ancestor, closure_descendant, closure_depth) "
+                "SELECT closure_ancestor, relocation_member, closure_depth + relocation_depth "
+                "FROM ElementClosure, temp.ElementRelocation WHERE closure_descendant = ?;");
+            db_manager->bindParameter<std::string>(1, new_parent_guid.value());
+            if (!db_manager->executePrepared()) {
+                return false;
+            }
+
+            if (stock_tracked && !shiftRelocatedStock(new_parent_guid.value(), 0, 1.0)) {
+                return false;
+            }
+        }
+
+        return db_manager->tryExecuteQuery("DELETE FROM temp.ElementRelocation;");
+    }
+
+    //adds sign times the stock held inside temp.ElementRelocation to the levels of anchor and
+    //everything above it from min_depth up
+    bool shiftRelocatedStock(const std::string& anchor_guid, int min_depth, double sign)
+    {
+        db_manager->prepareStatement(
+            "INSERT INTO StockLevels (level_node, level_key, level_quantity) "
+            "SELECT closure_ancestor, stock_key, ?3 * moved_quantity FROM ElementClosure, "
+            "(SELECT stock_key, sum(stock_quantity) AS moved_quantity FROM ElementStock "
+            "JOIN temp.ElementRelocation ON stock_element = relocation_member GROUP BY stock_key) "
+            "WHERE closure_descendant = ?1 AND closure_depth >= ?2 "
+            "ON CONFLICT (level_node, level_key) DO UPDATE SET level_quantity = level_quantity + excluded.level_quantity;");
+        db_manager->bindParameter<std::string>(1, anchor_guid);
+        db_manager->bindParameter<int>(2, min_depth);
+        db_manager->bindParameter<double>(3, sign);
+        return db_manager->executePrepared();
+    }
+
+    //writes the element's own quantity and the same delta to the level of every ancestor and
+    //itself in one transaction, the delta is worked out by sqlite from the stored quantity
+    bool changeQuantity(const std::string& guid, const std::string& stock_key, double value, bool relative, const char* caller)
+    {
+        if (!stock_tracked) {
+            std::cerr << "Error in " << caller << ": stock tables have not been created" << std::endl;
+            return false;
+        }
+
+        db_manager->prepareStatement("SELECT element_class FROM Element WHERE element_guid = ?;");
+        db_manager->bindParameter<std::string>(1, guid);
+        sqlite3_stmt* class_statement = db_manager->getPreparedStatement();
+        std::optional<int> element_class;
+        if (sqlite3_step(class_statement) == SQLITE_ROW) {
+            element_class = sqlite3_column_int(class_statement, 0);
+        }
+        sqlite3_finalize(class_statement);
+        if (!element_class.has_value()) {
+            std::cerr << "Error in " << caller << ": " << guid << " does not exist" << std::endl;
+            return false;
+        }
+        if (!holdsStock(element_class.value())) {
+            std::cerr << "Error in " << caller << ": " << guid << " is not a BULK or MATERIAL element" << std::endl;
+            return false;
+        }
+
+        if (!db_manager->beginTransaction()) {
+            return false;
+        }
+
+        const std::string stored = "coalesce((SELECT stock_quantity FROM ElementStock WHERE stock_element = ?1 AND stock_key = ?2), 0)";
+        const std::string delta = relative ? "?3" : "?3 - " + stored;
+
+        db_manager->prepareStatement(
+            "INSERT INTO StockLevels (level_node, level_key, level_quantity) "
+            "SELECT closure_ancestor, ?2, " + delta + " FROM ElementClosure WHERE closure_descendant = ?1 "
+            "ON CONFLICT (level_node, level_key) DO UPDATE SET level_quantity = level_quantity + excluded.level_quantity;");
+        db_manager->bindParameter<std::string>(1, guid);
+        db_manager->bindParameter<std::string>(2, stock_key);
+        db_manager->bindParameter<double>(3, value);
+        bool success = db_manager->executePrepared();
+
+        //the CHECK on stock_quantity refuses an adjustment below zero and rolls the levels back with it
+        if (relative) {
+            db_manager->prepareStatement("INSERT OR IGNORE INTO ElementStock (stock_element, stock_key, stock_quantity) VALUES (?1, ?2, 0);");
+            db_manager->bindParameter<std::string>(1, guid);
+            db_manager->bindParameter<std::string>(2, stock_key);
+            success = success && db_manager->executePrepared();
+
+            db_manager->prepareStatement("UPDATE ElementStock SET stock_quantity = stock_quantity + ?3 WHERE stock_element = ?1 AND stock_key = ?2;");
+        }
+        else {
+            db_manager->prepareStatement(
+                "INSERT INTO ElementStock (stock_element, stock_key, stock_quantity) VALUES (?1, ?2, ?3) "
+                "ON CONFLICT (stock_element, stock_key) DO UPDATE SET stock_quantity = excluded.stock_quantity;");
+        }
+        db_manager->bindParameter<std::string>(1, guid);
+        db_manager->bindParameter<std::string>(2, stock_key);
+        db_manager->bindParameter<double>(3, value);
+        success = success && db_manager->executePrepared();
+
+        if (!success || !db_manager->commitTransaction()) {
+            std::cerr << "Error in " << caller << std::endl;
+            db_manager->rollbackTransaction();
+            return false;
+        }
+
+        if (!observers.empty()) {
+            notifyUpdated("ElementStock", { {"stock_element", guid}, {"stock_key", stock_key}, {"stock_quantity", retrieveQuantity(guid, stock_key)} });
+        }
+        return true;
+    }
+
+    double retrieveStockValue(const std::string& sql, const std::string& guid, const std::string& stock_key)
+    {
+        db_manager->prepareStatement(sql);
+        db_manager->bindParameter<std::string>(1, guid);
+        db_manager->bindParameter<std::string>(2, stock_key);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        double quantity = 0.0;
+        if (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            quantity = sqlite3_column_double(prepared_statement, 0);
+        }
+
+        sqlite3_finalize(prepared_statement);
+        return quantity;
+    }
+
+    void notifyParentChanged(const std::vector<std::string>& guids, const std::optional<std::string>& new_parent_guid)
+    {
+        for (const std::string& guid : guids) {
+            nlohmann::json record = { {"element_guid", guid}, {"element_parent_guid", nullptr} };
+            if (new_parent_guid.has_value()) {
+                record["element_parent_guid"] = new_parent_guid.value();
+            }
+            notifyUpdated("Element", record);
+        }
+    }
+
+    std::vector<std::string> retrieveGuids(const std::string& sql, const std::string& guid)
+    {
+        std::vector<std::string> guids;
+
+        db_manager->prepareStatement(sql);
+        db_manager->bindParameter<std::string>(1, guid);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            guids.push_back(reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 0)));
+        }
+
+        sqlite3_finalize(prepared_statement);
+        return guids;
+    }
+
+    void bindOptionalGuid(int bind_index, const std::optional<std::string>& guid)
+    {
+        if (guid.has_value()) {
+            db_manager->bindParameter<std::string>(bind_index, guid.value());
+        }
+        else {
+            db_manager->bindNull(bind_index);
+        }
+    }
+
+    bool executeWithGuid(const std::string& sql, const std::string& guid)
+    {
+        db_manager->prepareStatement(sql);
+        db_manager->bindParameter<std::string>(1, guid);
+        return db_manager->executePrepared();
+    }
+
+    inline static const std::string element_columns =
+        "element_guid, element_name, element_description, element_class, element_parent_guid, "
+        "element_owner, element_thumbpath, element_visibility, element_timestamp";
+
+    void readElement(sqlite3_stmt* prepared_statement, nlohmann::json& json_result)
+    {
+        db_manager->getParameter<std::string>(0, json_result, "element_guid", prepared_statement);
+        db_manager->getParameter<std::string>(1, json_result, "element_name", prepared_statement);
+        db_manager->getParameter<std::string>(2, json_result, "element_description", prepared_statement);
+        db_manager->getParameter<int>(3, json_result, "element_class", prepared_statement);
+        db_manager->getParameter<std::string>(4, json_result, "element_parent_guid", prepared_statement);
+        db_manager->getParameter<int>(5, json_result, "element_owner", prepared_statement);
+        db_manager->getParameter<std::string>(6, json_result, "element_thumbpath", prepared_statement);
+        db_manager->getParameter<int>(7, json_result, "element_visibility", prepared_statement);
+        db_manager->getParameter<int>(8, json_result, "element_timestamp", prepared_statement);
+    }
+
+    template <typename T>
+    nlohmann::json retrieveSingle(const std::string& sql, const T& key)
+    {
+        nlohmann::json json_result;
+
+        db_manager->prepareStatement(sql);
+        db_manager->bindParameter<T>(1, key);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        if (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            readElement(prepared_statement, json_result);
+        }
+
+        sqlite3_finalize(prepared_statement);
+        return json_result;
+    }
+
+    nlohmann::json retrieveList(const std::string& sql, const std::string& guid)
+    {
+        nlohmann::json json_result = nlohmann::json::array();
+
+        db_manager->prepareStatement(sql);
+        db_manager->bindParameter<std::string>(1, guid);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            nlohmann::json element;
+            readElement(prepared_statement, element);
+            db_manager->getParameter<int>(9, element, "closure_depth", prepared_statement);
+            json_result.push_back(element);
+        }
+
+        sqlite3_finalize(prepared_statement);
+        return json_result;
+    }
+
+    ElementGuid* guid_generator = nullptr;
+    std::string last_inserted_guid;
+    bool stock_tracked = false;
+};
+
+#endif //ELEMENTDAO_HPP
@@ -0,0 +1,238 @@
+#ifndef ELEMENTGUID_HPP
+#define ELEMENTGUID_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include <string>
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <iostream>
+#include <memory>
+
+/// <summary>
+/// element_guid codec and generator. a guid is 6 Crockford base32 characters, 5 bits each,
+/// so it packs into a 30 bit integer. new guids come from a counter persisted in the
+/// ElementGuidCounter table: a block of counter values is reserved with one UPDATE and each
+/// value is passed through a fixed bijective mix of the 30 bit space, so generated guids never
+/// repeat among themselves and look scattered. guids supplied by hand share the space, a
+/// generated one is checked against Element and skipped when taken.
+/// like DatabaseManager a generator is meant for one thread
+/// </summary>
+class ElementGuid {
+public:
+
+    static constexpr size_t length = 6;
+    static constexpr uint32_t space = 1u << 30;
+    static constexpr uint32_t mask = space - 1;
+
+    //000000 and 111111 are the reserved root and deprecated elements
+    static constexpr uint32_t root_packed = 0;
+    static constexpr uint32_t deprecated_packed = 0x02108421;
+
+    ElementGuid(DatabaseManager& _db_manager, uint32_t _block_size = 256)
+        : db_manager(&_db_manager), block_size(_block_size == 0 ? 1 : _block_size) {}
+
+    void createCounterTable()
+    {
+        db_manager->executeQuery(
+            "CREATE TABLE IF NOT EXISTS ElementGuidCounter ("
+            "counter_id             INTEGER     PRIMARY KEY CHECK (counter_id = 0), "
+            "counter_next           INTEGER     NOT NULL"
+            ");");
+        db_manager->executeQuery("INSERT OR IGNORE INTO ElementGuidCounter (counter_id, counter_next) VALUES (0, 0);");
+    }
+
+    // Codec ----------------------------------------------------------------------------------------------
+
+    static std::string encode(uint32_t packed)
+    {
+        std::string guid(length, '0');
+        for (size_t i = length; i-- > 0;) {
+            guid[i] = alphabet[packed & 0x1F];
+            packed >>= 5;
+        }
+        return guid;
+    }
+
+    /// <summary>
+    /// decodes a guid typed by hand as well as a stored one: lower case is accepted and the
+    /// easily confused I, L and O are read as 1, 1 and 0
+    /// </summary>
+    static std::optional<uint32_t> decode(std::string_view guid)
+    {
+        if (guid.size() != length) {
+            return std::nullopt;
+        }
+
+        uint32_t packed = 0;
+        for (char character : guid) {
+            int8_t digit = decodeTable()[static_cast<unsigned char>(character)];
+            if (digit < 0) {
+                return std::nullopt;
+            }
+            packed = (packed << 5) | static_cast<uint32_t>(digit);
+        }
+        return packed;
+    }
+
+    //true only for the upper case spelling encode produces, the form stored in element_guid
+    static bool isCanonical(const std::string& guid)
+    {
+        auto packed = decode(guid);
+        return packed.has_value() && encode(packed.value()) == guid;
+    }
+
+    static std::optional<std::string> canonicalize(const std::string& guid)
+    {
+        auto packed = decode(guid);
+        if (!packed.has_value()) {
+            return std::nullopt;
+        }
+        return encode(packed.value());
+    }
+
+    //SQL expression decoding a canonical guid column to its packed value, for integer keys that
+    //triggers derive on every connection without a registered function
+    static std::string packedSql(const std::string& column)
+    {
+        std::string sql = "(";
+        for (size_t position = 0; position < length; ++position) {
+            if (position > 0) {
+                sql += " | ";
+            }
+            sql += "((instr('" + std::string(alphabet) + "', substr(" + column + ", " + std::to_string(position + 1) + ", 1)) - 1) << "
+                + std::to_string(5 * (length - 1 - position)) + ")";
+        }
+        return sql + ")";
+    }
+
+    /// <summary>
+    /// bijection of the 30 bit space built from xor-shifts and odd multiplications,
+    /// each step is invertible modulo 2^30 so distinct counters give distinct guids
+    /// </summary>
+    static constexpr uint32_t permute(uint32_t counter)
+    {
+        uint32_t value = counter & mask;
+        value ^= value >> 15;
+        value = (value * 0x2C1B3C6Du) & mask;
+        value ^= value >> 13;
+        value = (value * 0x297A2D39u) & mask;
+        value ^= value >> 15;
+        return value;
+    }
+
+    // Generation -----------------------------------------------------------------------------------------
+
+    /// <summary>
+    /// next unused guid, reserving a new block of counter values when the current one runs out.
+    /// values left in a block when the program exits are never handed out
+    /// </summary>
+    /// <returns>nullopt when the counter cannot be advanced or the guid space is exhausted</returns>
+    std::optional<uint32_t> nextPacked()
+    {
+        while (true)
+        {
+            if (block->next == block->end && !reserveBlock()) {
+                return std::nullopt;
+            }
+
+            uint32_t packed = permute(block->next++);
+            if (packed == root_packed || packed == deprecated_packed) {
+                continue;
+            }
+            if (!db_manager->prepareStatement("SELECT EXISTS(SELECT 1 FROM Element WHERE element_guid = ?);")) {
+                return std::nullopt;
+            }
+            db_manager->bindParameter<std::string>(1, encode(packed));
+            if (!db_manager->fetchBooleanResult()) {
+                return packed;
+            }
+        }
+    }
+
+    std::optional<std::string> next()
+    {
+        auto packed = nextPacked();
+        if (!packed.has_value()) {
+            return std::nullopt;
+        }
+        return encode(packed.value());
+    }
+
+private:
+
+    static constexpr char alphabet[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+    static const std::array<int8_t, 256>& decodeTable()
+    {
+        static const std::array<int8_t, 256> table = buildDecodeTable();
+        return table;
+    }
+
+    static std::array<int8_t, 256> buildDecodeTable()
+    {
+        std::array<int8_t, 256> table{};
+        for (size_t i = 0; i < table.size(); ++i) {
+            table[i] = -1;
+        }
+        for (int8_t digit = 0; digit < 32; ++digit) {
+            char character = alphabet[digit];
+            table[static_cast<unsigned char>(character)] = digit;
+            if (character >= 'A' && character <= 'Z') {
+                table[static_cast<unsigned char>(character - 'A' + 'a')] = digit;
+            }
+        }
+        table['I'] = table['i'] = table['L'] = table['l'] = 1;
+        table['O'] = table['o'] = 0;
+        return table;
+    }
+
+    //one UPDATE moves the persisted counter past the block, so two generators never share values.
+    //inside a transaction the UPDATE is undone with it, the block is then dropped as well so its
+    //values are not handed out a second time by whoever reserves them next
+    bool reserveBlock()
+    {
+        if (!db_manager->prepareStatement(
+            "UPDATE ElementGuidCounter SET counter_next = counter_next + ?1 "
+            "WHERE counter_id = 0 AND counter_next + ?1 <= ?2 RETURNING counter_next;"))
+        {
+            return false;
+        }
+        db_manager->bindParameter<long long>(1, block_size);
+        db_manager->bindParameter<long long>(2, space);
+        std::optional<uint32_t> reserved_end;
+        db_manager->executeReturning([&reserved_end](sqlite3_stmt* row) {
+            reserved_end = static_cast<uint32_t>(sqlite3_column_int64(row, 0));
+        });
+
+        if (!reserved_end.has_value()) {
+            std::cerr << "Error in ElementGuid: cannot reserve guids, counter missing or guid space exhausted" << std::endl;
+            return false;
+        }
+        block->end = reserved_end.value();
+        block->next = block->end - block_size;
+
+        db_manager->runAfterRollback([reserved_block = std::weak_ptr<Block>(block), end = block->end]() {
+            std::shared_ptr<Block> current = reserved_block.lock();
+            if (current && current->end == end) {
+                current->next = current->end = 0;
+            }
+        });
+        return true;
+    }
+
+    //shared with the rollback callback, which may outlive the generator
+    struct Block
+    {
+        uint32_t next = 0;
+        uint32_t end = 0;
+    };
+
+    DatabaseManager* db_manager;
+    uint32_t block_size;
+    std::shared_ptr<Block> block = std::make_shared<Block>();
+};
+
+#endif //ELEMENTGUID_HPP
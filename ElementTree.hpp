@@ -0,0 +1,336 @@
+#ifndef ELEMENTTREE_HPP
+#define ELEMENTTREE_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include "GenericDAO.hpp"
+#include "ElementGuid.hpp"
+#include "nlohmann\\json.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+/// <summary>
+/// in memory snapshot of the Element location tree held in flat arrays indexed by node:
+/// parent, first child, next and previous sibling, element class, an interned name and the
+/// guid packed to its 30 bit integer.
+/// it is loaded once from the Element table and then follows ElementDAO writes as a
+/// RecordObserver, so paths and subtrees are answered without touching sqlite
+/// </summary>
+class ElementTree : public RecordObserver {
+public:
+
+    static constexpr int32_t none = -1;
+
+    /// <summary>
+    /// replaces the snapshot with the current contents of the Element table
+    /// </summary>
+    bool load(DatabaseManager& db_manager)
+    {
+        clear();
+
+        if (!db_manager.prepareStatement("SELECT element_guid, element_name, element_class, element_parent_guid FROM Element;")) {
+            return false;
+        }
+        sqlite3_stmt* prepared_statement = db_manager.getPreparedStatement();
+
+        //parents can appear after their children, so links are made once every node exists
+        std::vector<std::pair<int32_t, std::string>> pending_links;
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW)
+        {
+            auto guid = ElementGuid::decode(reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 0)));
+            if (!guid.has_value()) {
+                continue;
+            }
+            const char* parent_guid = reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 3));
+            int32_t node = createNode(
+                guid.value(),
+                reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 1)),
+                sqlite3_column_int(prepared_statement, 2));
+            if (parent_guid) {
+                pending_links.emplace_back(node, parent_guid);
+            }
+        }
+        sqlite3_finalize(prepared_statement);
+
+        for (const auto& link : pending_links) {
+            attach(link.first, find(link.second));
+        }
+
+        return true;
+    }
+
+    void clear()
+    {
+        parents.clear();
+        first_children.clear();
+        next_siblings.clear();
+        previous_siblings.clear();
+        classes.clear();
+        name_ids.clear();
+        guids.clear();
+        free_nodes.clear();
+        guid_index.clear();
+        names.clear();
+        name_index.clear();
+    }
+
+    // Lookups --------------------------------------------------------------------------------------------
+
+    int32_t find(const std::string& guid) const
+    {
+        auto packed = ElementGuid::decode(guid);
+        return packed.has_value() ? findPacked(packed.value()) : none;
+    }
+
+    int32_t findPacked(uint32_t packed_guid) const
+    {
+        auto node = guid_index.find(packed_guid);
+        return node == guid_index.end() ? none : node->second;
+    }
+
+    size_t size() const
+    {
+        return guid_index.size();
+    }
+
+    int32_t parentOf(int32_t node) const { return parents[node]; }
+    int32_t firstChildOf(int32_t node) const { return first_children[node]; }
+    int32_t nextSiblingOf(int32_t node) const { return next_siblings[node]; }
+    uint8_t classOf(int32_t node) const { return classes[node]; }
+    const std::string& nameOf(int32_t node) const { return names[name_ids[node]]; }
+    uint32_t packedGuidOf(int32_t node) const { return guids[node]; }
+    std::string guidOf(int32_t node) const { return ElementGuid::encode(guids[node]); }
+
+    /// <summary>
+    /// names from the top level element down to the node joined by the separator
+    /// </summary>
+    std::string renderPath(int32_t node, const std::string& separator = " / ") const
+    {
+        int32_t chain[64];
+        size_t length = 0;
+        std::vector<int32_t> deep_chain;
+
+        for (int32_t current = node; current != none; current = parents[current]) {
+            if (length < 64) {
+                chain[length++] = current;
+            }
+            else {
+                deep_chain.push_back(current);
+            }
+        }
+
+        std::string path;
+        for (size_t i = deep_chain.size(); i-- > 0;) {
+            path += nameOf(deep_chain[i]);
+            path += separator;
+        }
+        for (size_t i = length; i-- > 0;) {
+            path += nameOf(chain[i]);
+            if (i > 0) {
+                path += separator;
+            }
+        }
+        return path;
+    }
+
+    /// <summary>
+    /// calls visit(node) for the node and everything below it in preorder, walking the
+    /// child and sibling links without recursion or an explicit stack
+    /// </summary>
+    template <typename Visitor>
+    void forEachInSubtree(int32_t node, Visitor visit) const
+    {
+        if (node == none) {
+            return;
+        }
+
+        visit(node);
+        int32_t current = node;
+        while (true)
+        {
+            if (first_children[current] != none) {
+                current = first_children[current];
+            }
+            else {
+                while (current != node && next_siblings[current] == none) {
+                    current = parents[current];
+                }
+                if (current == node) {
+                    return;
+                }
+                current = next_siblings[current];
+            }
+            visit(current);
+        }
+    }
+
+    // Incremental Updates --------------------------------------------------------------------------------
+
+    void onRecordInserted(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name != "Element") {
+            return;
+        }
+        auto guid = ElementGuid::decode(record["element_guid"].get<std::string>());
+        if (!guid.has_value() || findPacked(guid.value()) != none) {
+            return;
+        }
+
+        int32_t node = createNode(guid.value(), record["element_name"].get<std::string>(), record["element_class"].get<int>());
+        if (record.contains("element_parent_guid") && record["element_parent_guid"].is_string()) {
+            attach(node, find(record["element_parent_guid"].get<std::string>()));
+        }
+    }
+
+    void onRecordUpdated(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name != "Element") {
+            return;
+        }
+
+        int32_t node = find(record["element_guid"].get<std::string>());
+        if (node == none) {
+            return;
+        }
+
+        if (record.contains("element_name")) {
+            name_ids[node] = intern(record["element_name"].get<std::string>());
+        }
+        if (record.contains("element_class")) {
+            classes[node] = static_cast<uint8_t>(record["element_class"].get<int>());
+        }
+
+        //moves always carry the parent key, null for top level
+        if (record.contains("element_parent_guid")) {
+            int32_t new_parent = none;
+            if (record["element_parent_guid"].is_string()) {
+                new_parent = find(record["element_parent_guid"].get<std::string>());
+            }
+            if (new_parent != parents[node]) {
+                detach(node);
+                attach(node, new_parent);
+            }
+        }
+    }
+
+    //deleted elements have had their children relocated or deleted first
+    void onRecordDeleted(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name != "Element") {
+            return;
+        }
+
+        int32_t node = find(record["element_guid"].get<std::string>());
+        if (node == none) {
+            return;
+        }
+
+        //any children still linked become top level rather than dangling
+        while (first_children[node] != none) {
+            int32_t child = first_children[node];
+            detach(child);
+            attach(child, none);
+        }
+
+        detach(node);
+        guid_index.erase(guids[node]);
+        free_nodes.push_back(node);
+    }
+
+private:
+
+    int32_t createNode(uint32_t packed_guid, const std::string& name, int element_class)
+    {
+        int32_t node;
+        if (!free_nodes.empty()) {
+            node = free_nodes.back();
+            free_nodes.pop_back();
+        }
+        else {
+            node = static_cast<int32_t>(parents.size());
+            parents.push_back(none);
+            first_children.push_back(none);
+            next_siblings.push_back(none);
+            previous_siblings.push_back(none);
+            classes.push_back(0);
+            name_ids.push_back(0);
+            guids.push_back(0);
+        }
+
+        parents[node] = none;
+        first_children[node] = none;
+        next_siblings[node] = none;
+        previous_siblings[node] = none;
+        classes[node] = static_cast<uint8_t>(element_class);
+        name_ids[node] = intern(name);
+        guids[node] = packed_guid;
+        guid_index[packed_guid] = node;
+
+        return node;
+    }
+
+    //links the node in as the first child of the parent, or leaves it top level for none
+    void attach(int32_t node, int32_t parent)
+    {
+        parents[node] = parent;
+        previous_siblings[node] = none;
+        next_siblings[node] = none;
+        if (parent == none) {
+            return;
+        }
+
+        next_siblings[node] = first_children[parent];
+        if (first_children[parent] != none) {
+            previous_siblings[first_children[parent]] = node;
+        }
+        first_children[parent] = node;
+    }
+
+    void detach(int32_t node)
+    {
+        int32_t parent = parents[node];
+        if (previous_siblings[node] != none) {
+            next_siblings[previous_siblings[node]] = next_siblings[node];
+        }
+        else if (parent != none) {
+            first_children[parent] = next_siblings[node];
+        }
+        if (next_siblings[node] != none) {
+            previous_siblings[next_siblings[node]] = previous_siblings[node];
+        }
+
+        parents[node] = none;
+        previous_siblings[node] = none;
+        next_siblings[node] = none;
+    }
+
+    //identical names such as "Top shelf" are stored once
+    uint32_t intern(const std::string& name)
+    {
+        auto existing = name_index.find(name);
+        if (existing != name_index.end()) {
+            return existing->second;
+        }
+        uint32_t id = static_cast<uint32_t>(names.size());
+        names.push_back(name);
+        name_index.emplace(name, id);
+        return id;
+    }
+
+    std::vector<int32_t> parents;
+    std::vector<int32_t> first_children;
+    std::vector<int32_t> next_siblings;
+    std::vector<int32_t> previous_siblings;
+    std::vector<uint8_t> classes;
+    std::vector<uint32_t> name_ids;
+    std::vector<uint32_t> guids;
+    std::vector<int32_t> free_nodes;
+    std::unordered_map<uint32_t, int32_t> guid_index;
+
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> name_index;
+};
+
+#endif //ELEMENTTREE_HPP
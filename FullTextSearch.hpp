@@ -0,0 +1,225 @@
+#ifndef FULLTEXTSEARCH_HPP
+#define FULLTEXTSEARCH_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include "ElementGuid.hpp"
+#include <string>
+#include <vector>
+#include <cctype>
+
+/// <summary>
+/// FTS5 indexes over the free text columns of Users and Element, kept in step by triggers so
+/// every write path including bulk imports and cascading deletes is covered. UsersSearch is an
+/// external content table over Users keyed by user_id. Element has no integer key, its implicit
+/// rowid may be renumbered by VACUUM, so ElementSearch keeps its own copy of the text keyed by
+/// the packed element_guid. searches rank with BM25 and treat every word typed as a prefix
+/// </summary>
+class FullTextSearch {
+public:
+
+    struct UserHit
+    {
+        int user_id;
+        double score;
+    };
+
+    struct ElementHit
+    {
+        std::string element_guid;
+        double score;
+    };
+
+    FullTextSearch(DatabaseManager& _db_manager) : db_manager(&_db_manager) {}
+
+    //indexes created here for the first time are filled from the rows already present
+    void createSearchTables()
+    {
+        bool users_new = !searchTableExists("UsersSearch");
+
+        //an index from before ElementSearch kept its own text follows Element's rowid and is replaced
+        db_manager->prepareStatement("SELECT EXISTS(SELECT 1 FROM sqlite_master WHERE name = 'ElementSearch' AND sql LIKE '%content = ''Element''%');");
+        if (db_manager->fetchBooleanResult()) {
+            db_manager->executeQuery(
+                "DROP TRIGGER IF EXISTS ElementSearch_insert; DROP TRIGGER IF EXISTS ElementSearch_delete; "
+                "DROP TRIGGER IF EXISTS ElementSearch_update; DROP TABLE ElementSearch;");
+        }
+        bool elements_new = !searchTableExists("ElementSearch");
+
+        //prefix indexes of 2 and 3 characters keep short type-ahead prefixes cheap
+        db_manager->executeQuery(
+            "CREATE VIRTUAL TABLE IF NOT EXISTS UsersSearch USING fts5("
+            "user_legalname, user_description, "
+            "content = 'Users', content_rowid = 'user_id', "
+            "tokenize = 'unicode61 remove_diacritics 2', prefix = '2 3');");
+        db_manager->executeQuery(
+            "CREATE VIRTUAL TABLE IF NOT EXISTS ElementSearch USING fts5("
+            "element_name, element_description, element_guid UNINDEXED, "
+            "tokenize = 'unicode61 remove_diacritics 2', prefix = '2 3');");
+
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS UsersSearch_insert AFTER INSERT ON Users BEGIN "
+            "INSERT INTO UsersSearch (rowid, user_legalname, user_description) VALUES (new.user_id, new.user_legalname, new.user_description); "
+            "END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS UsersSearch_delete AFTER DELETE ON Users BEGIN "
+            "INSERT INTO UsersSearch (UsersSearch, rowid, user_legalname, user_description) VALUES ('delete', old.user_id, old.user_legalname, old.user_description); "
+            "END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS UsersSearch_update AFTER UPDATE OF user_legalname, user_description ON Users BEGIN "
+            "INSERT INTO UsersSearch (UsersSearch, rowid, user_legalname, user_description) VALUES ('delete', old.user_id, old.user_legalname, old.user_description); "
+            "INSERT INTO UsersSearch (rowid, user_legalname, user_description) VALUES (new.user_id, new.user_legalname, new.user_description); "
+            "END;");
+
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS ElementSearch_insert AFTER INSERT ON Element BEGIN "
+            "INSERT INTO ElementSearch (rowid, element_name, element_description, element_guid) "
+            "VALUES (" + ElementGuid::packedSql("new.element_guid") + ", new.element_name, new.element_description, new.element_guid); "
+            "END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS ElementSearch_delete AFTER DELETE ON Element BEGIN "
+            "DELETE FROM ElementSearch WHERE rowid = " + ElementGuid::packedSql("old.element_guid") + "; "
+            "END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS ElementSearch_update AFTER UPDATE OF element_name, element_description ON Element BEGIN "
+            "UPDATE ElementSearch SET element_name = new.element_name, element_description = new.element_description "
+            "WHERE rowid = " + ElementGuid::packedSql("new.element_guid") + "; "
+            "END;");
+
+        if (users_new) {
+            db_manager->executeQuery("INSERT INTO UsersSearch (UsersSearch) VALUES ('rebuild');");
+        }
+        if (elements_new) {
+            db_manager->executeQuery(fillElementSearch);
+        }
+    }
+
+    /// <summary>
+    /// rebuilds both indexes from the source tables, for data written while the triggers
+    /// did not exist or after the database file was edited by another tool
+    /// </summary>
+    bool rebuild()
+    {
+        return db_manager->tryExecuteQuery("INSERT INTO UsersSearch (UsersSearch) VALUES ('rebuild');")
+            && db_manager->tryExecuteQuery("DELETE FROM ElementSearch; " + fillElementSearch)
+            && db_manager->tryExecuteQuery("INSERT INTO UsersSearch (UsersSearch) VALUES ('optimize');")
+            && db_manager->tryExecuteQuery("INSERT INTO ElementSearch (ElementSearch) VALUES ('optimize');");
+    }
+
+    // Search ---------------------------------------------------------------------------------------------
+
+    /// <summary>
+    /// visible users whose legal name or description contain every word of the text as a
+    /// word prefix, best match first. a hit in the legal name weighs twice one in the description
+    /// </summary>
+    std::vector<UserHit> searchUsers(const std::string& text, int limit = 20)
+    {
+        std::vector<UserHit> hits;
+        std::string match = toMatchExpression(text);
+        if (match.empty()) {
+            return hits;
+        }
+
+        if (!db_manager->prepareStatement(
+            "SELECT UsersSearch.rowid, bm25(UsersSearch, 2.0, 1.0) AS score FROM UsersSearch "
+            "JOIN Users ON user_id = UsersSearch.rowid "
+            "WHERE UsersSearch MATCH ? AND user_visibility = 1 ORDER BY score LIMIT ?;"))
+        {
+            return hits;
+        }
+        db_manager->bindParameter<std::string>(1, match);
+        db_manager->bindParameter<int>(2, limit);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        //bm25 is negative with the best match lowest, scores are reported as positive relevance
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            hits.push_back({ sqlite3_column_int(prepared_statement, 0), -sqlite3_column_double(prepared_statement, 1) });
+        }
+        sqlite3_finalize(prepared_statement);
+        return hits;
+    }
+
+    //same as searchUsers over element names and descriptions, a name hit weighs three times a description hit
+    std::vector<ElementHit> searchElements(const std::string& text, int limit = 20)
+    {
+        std::vector<ElementHit> hits;
+        std::string match = toMatchExpression(text);
+        if (match.empty()) {
+            return hits;
+        }
+
+        if (!db_manager->prepareStatement(
+            "SELECT Element.element_guid, bm25(ElementSearch, 3.0, 1.0) AS score FROM ElementSearch "
+            "JOIN Element ON Element.element_guid = ElementSearch.element_guid "
+            "WHERE ElementSearch MATCH ? AND element_visibility = 1 ORDER BY score LIMIT ?;"))
+        {
+            return hits;
+        }
+        db_manager->bindParameter<std::string>(1, match);
+        db_manager->bindParameter<int>(2, limit);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            hits.push_back({ reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 0)), -sqlite3_column_double(prepared_statement, 1) });
+        }
+        sqlite3_finalize(prepared_statement);
+        return hits;
+    }
+
+    /// <summary>
+    /// turns typed text into an FTS5 query: every word becomes a quoted prefix term, so
+    /// characters with a meaning in the query syntax are searched for literally
+    /// </summary>
+    static std::string toMatchExpression(const std::string& text)
+    {
+        std::string match;
+        std::string word;
+
+        auto finishWord = [&]() {
+            if (word.empty()) {
+                return;
+            }
+            if (!match.empty()) {
+                match += ' ';
+            }
+            match += '"';
+            for (char character : word) {
+                if (character == '"') {
+                    match += '"';
+                }
+                match += character;
+            }
+            match += "\"*";
+            word.clear();
+        };
+
+        for (char character : text) {
+            if (std::isspace(static_cast<unsigned char>(character))) {
+                finishWord();
+            }
+            else {
+                word += character;
+            }
+        }
+        finishWord();
+
+        return match;
+    }
+
+private:
+
+    inline static const std::string fillElementSearch =
+        "INSERT INTO ElementSearch (rowid, element_name, element_description, element_guid) "
+        "SELECT " + ElementGuid::packedSql("element_guid") + ", element_name, element_description, element_guid FROM Element;";
+
+    bool searchTableExists(const std::string& table_name)
+    {
+        db_manager->prepareStatement("SELECT EXISTS(SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?);");
+        db_manager->bindParameter<std::string>(1, table_name);
+        return db_manager->fetchBooleanResult();
+    }
+
+    DatabaseManager* db_manager;
+};
+
+#endif //FULLTEXTSEARCH_HPP
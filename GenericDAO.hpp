@@ -6,7 +6,24 @@
 #include <string>
 #include "nlohmann\\json.hpp"
 #include "DatabaseManager.hpp"
+#include "JsonLinesWriter.hpp"
+#include "JsonInsertSax.hpp"
 #include <optional>
+#include <vector>
+#include <algorithm>
+
+//receives the writes a DAO has committed, so in memory structures built from a table
+//can follow it incrementally instead of reloading. records carry the key of the row and
+//the fields that were written
+class RecordObserver
+{
+public:
+    virtual ~RecordObserver(){}
+
+    virtual void onRecordInserted(const std::string& /*table_name*/, const nlohmann::json& /*record*/) {}
+    virtual void onRecordUpdated(const std::string& /*table_name*/, const nlohmann::json& /*record*/) {}
+    virtual void onRecordDeleted(const std::string& /*table_name*/, const nlohmann::json& /*record*/) {}
+};
 
 //generic dao can then be utilized by higher level logic classes with dependency injection
 //and all derived classes are guaranteed by the interface to have the appropriate functions
@@ -14,6 +31,96 @@
 //or general queries to verify a login by comparing a login password to a stored hash
 class GenericDAO
 {
+public:
+
+    /// <summary>
+    /// writes every row of a table as one JSON object per line, walking the table with a
+    /// single cursor and serializing each column straight into the output buffer so memory
+    /// stays constant regardless of table size
+    /// </summary>
+    /// <param name="table_name">table to export</param>
+    /// <param name="file_descriptor">open descriptor the lines are written to</param>
+    /// <returns>number of exported rows, -1 on failure</returns>
+    long long exportTable(const std::string& table_name, int file_descriptor)
+    {
+        sqlite3_stmt* cursor = nullptr;
+        std::string sql = "SELECT * FROM " + table_name + ";";
+        if (sqlite3_prepare_v2(db_manager->database_connection, sql.c_str(), -1, &cursor, nullptr) != SQLITE_OK) {
+            std::cerr << "Failed to prepare export of " << table_name << ": " << sqlite3_errmsg(db_manager->database_connection) << std::endl;
+            return -1;
+        }
+
+        //column names are fixed for the lifetime of the cursor
+        const int column_count = sqlite3_column_count(cursor);
+        std::vector<std::string> column_names;
+        for (int column = 0; column < column_count; ++column) {
+            column_names.push_back(sqlite3_column_name(cursor, column));
+        }
+
+        JsonLinesWriter writer(file_descriptor);
+        long long row_count = 0;
+        int step_result;
+
+        while ((step_result = sqlite3_step(cursor)) == SQLITE_ROW && !writer.failed())
+        {
+            writer.beginObject();
+            for (int column = 0; column < column_count; ++column)
+            {
+                writer.key(column_names[column].data(), column_names[column].size());
+                switch (sqlite3_column_type(cursor, column)) {
+                case SQLITE_INTEGER:
+                    writer.valueInteger(sqlite3_column_int64(cursor, column));
+                    break;
+                case SQLITE_FLOAT:
+                    writer.valueDouble(sqlite3_column_double(cursor, column));
+                    break;
+                case SQLITE_TEXT:
+                    writer.valueString(reinterpret_cast<const char*>(sqlite3_column_text(cursor, column)), sqlite3_column_bytes(cursor, column));
+                    break;
+                case SQLITE_BLOB:
+                    writer.valueBlob(static_cast<const unsigned char*>(sqlite3_column_blob(cursor, column)), sqlite3_column_bytes(cursor, column));
+                    break;
+                default:
+                    writer.valueNull();
+                }
+            }
+            writer.endObject();
+            ++row_count;
+        }
+
+        sqlite3_finalize(cursor);
+
+        if (!writer.flush() || (step_result != SQLITE_DONE && step_result != SQLITE_ROW)) {
+            std::cerr << "Error in exportTable: export of " << table_name << " incomplete" << std::endl;
+            return -1;
+        }
+
+        return row_count;
+    }
+
+    /// <summary>
+    /// inserts a JSON object or array of objects into a table, binding values into the
+    /// prepared INSERT while the input is parsed instead of going through a json DOM
+    /// </summary>
+    /// <param name="table_name">target table, its schema decides column order and types</param>
+    /// <param name="input">stream holding the JSON document</param>
+    /// <returns>counts of inserted and rejected records with the reason for each reject</returns>
+    JsonInsertSax::IngestReport insertRecordsFromJson(const std::string& table_name, std::istream& input)
+    {
+        JsonInsertSax ingestion(*db_manager, table_name);
+        return ingestion.ingest(input);
+    }
+
+    void addObserver(RecordObserver* observer)
+    {
+        observers.push_back(observer);
+    }
+
+    void removeObserver(RecordObserver* observer)
+    {
+        observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+    }
+
 protected:
 
     enum class DataType
@@ -28,6 +135,7 @@ protected:
         if (!db_manager) {
             throw std::invalid_argument("DatabaseManager cannot be null");
         }
+        observers = db_manager->record_observers;
     }
 
     virtual ~GenericDAO(){}
@@ -60,7 +168,47 @@ protected:
         return db_manager->fetchBooleanResult();
     }
 
+    //observers hear of a write once the outermost transaction holding it has committed, a DAO
+    //call running as one step of a larger transaction only released a savepoint. the observer
+    //list is copied, a DAO made for a single call is gone by then
+    void notifyInserted(const std::string& table_name, const nlohmann::json& record)
+    {
+        if (observers.empty()) {
+            return;
+        }
+        db_manager->runAfterCommit([observers = observers, table_name, record]() {
+            for (RecordObserver* observer : observers) {
+                observer->onRecordInserted(table_name, record);
+            }
+        });
+    }
+
+    void notifyUpdated(const std::string& table_name, const nlohmann::json& record)
+    {
+        if (observers.empty()) {
+            return;
+        }
+        db_manager->runAfterCommit([observers = observers, table_name, record]() {
+            for (RecordObserver* observer : observers) {
+                observer->onRecordUpdated(table_name, record);
+            }
+        });
+    }
+
+    void notifyDeleted(const std::string& table_name, const nlohmann::json& record)
+    {
+        if (observers.empty()) {
+            return;
+        }
+        db_manager->runAfterCommit([observers = observers, table_name, record]() {
+            for (RecordObserver* observer : observers) {
+                observer->onRecordDeleted(table_name, record);
+            }
+        });
+    }
+
     DatabaseManager* db_manager;
+    std::vector<RecordObserver*> observers;
  
 };
 
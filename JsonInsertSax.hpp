@@ -0,0 +1,406 @@
+#ifndef JSONINSERTSAX_HPP
+#define JSONINSERTSAX_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include "nlohmann\\json.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <istream>
+#include <chrono>
+
+/// <summary>
+/// SAX handler that inserts JSON records into a table without building a json DOM.
+/// the table schema is read once to map each column name to a bind index of a
+/// prepared INSERT, scalar values are bound the moment the parser reports them and
+/// the statement is executed when the record's object closes. the input is either
+/// a single object or an array of objects, one row per object
+/// </summary>
+class JsonInsertSax : public nlohmann::json_sax<nlohmann::json> {
+public:
+
+    struct IngestReport
+    {
+        size_t records_inserted = 0;
+        size_t records_rejected = 0;
+        std::vector<std::string> errors;
+    };
+
+    JsonInsertSax(DatabaseManager& _db_manager, const std::string& _table_name) : db_manager(&_db_manager), table_name(_table_name) {}
+
+    /// <summary>
+    /// parses the whole input inside one transaction. a record with a value of the wrong
+    /// type, a nested value or a constraint violation is rejected on its own, malformed
+    /// JSON rolls back the whole input
+    /// </summary>
+    IngestReport ingest(std::istream& input)
+    {
+        report = IngestReport();
+        depth = 0;
+        record_depth = 0;
+        skip_depth = 0;
+        record_number = 0;
+        pending_column = -1;
+        skip_next_value = false;
+        array_at_top = false;
+
+        if (!loadColumns() || !prepareInsert()) {
+            report.errors.push_back("cannot prepare insert into " + table_name);
+            return report;
+        }
+
+        if (!db_manager->beginTransaction()) {
+            db_manager->finalizePrepared();
+            report.errors.push_back("cannot begin transaction");
+            return report;
+        }
+
+        bool parsed = nlohmann::json::sax_parse(input, this);
+        db_manager->finalizePrepared();
+
+        if (!parsed) {
+            db_manager->rollbackTransaction();
+            report.records_rejected += report.records_inserted;
+            report.records_inserted = 0;
+            return report;
+        }
+
+        if (!db_manager->commitTransaction()) {
+            db_manager->rollbackTransaction();
+            report.errors.push_back("transaction failed to commit");
+            report.records_rejected += report.records_inserted;
+            report.records_inserted = 0;
+        }
+
+        return report;
+    }
+
+    // SAX Events ------------------------------------------------------------------------------------------
+
+    bool null() override
+    {
+        if (acceptsValue()) {
+            db_manager->bindNull(pending_column + 1);
+        }
+        return true;
+    }
+
+    bool boolean(bool value) override
+    {
+        if (acceptsValue() && checkNumeric()) {
+            db_manager->bindParameter<int>(pending_column + 1, value ? 1 : 0);
+        }
+        return true;
+    }
+
+    bool number_integer(number_integer_t value) override
+    {
+        if (acceptsValue() && checkNumeric()) {
+            db_manager->bindParameter<long long>(pending_column + 1, static_cast<long long>(value));
+        }
+        return true;
+    }
+
+    bool number_unsigned(number_unsigned_t value) override
+    {
+        if (acceptsValue() && checkNumeric()) {
+            db_manager->bindParameter<long long>(pending_column + 1, static_cast<long long>(value));
+        }
+        return true;
+    }
+
+    bool number_float(number_float_t value, const string_t&) override
+    {
+        if (acceptsValue() && checkNumeric()) {
+            if (columns[pending_column].affinity == ColumnAffinity::INTEGER) {
+                rejectRecord("column " + columns[pending_column].name + " expects an integer");
+                return true;
+            }
+            db_manager->bindParameter<double>(pending_column + 1, value);
+        }
+        return true;
+    }
+
+    bool string(string_t& value) override
+    {
+        if (acceptsValue()) {
+            ColumnAffinity affinity = columns[pending_column].affinity;
+            if (affinity == ColumnAffinity::INTEGER || affinity == ColumnAffinity::REAL) {
+                rejectRecord("column " + columns[pending_column].name + " expects a number");
+                return true;
+            }
+            db_manager->bindParameter<std::string>(pending_column + 1, value);
+        }
+        return true;
+    }
+
+    bool binary(binary_t&) override
+    {
+        if (acceptsValue()) {
+            rejectRecord("binary values are not supported");
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) override
+    {
+        ++depth;
+
+        //top level object or an object directly inside the top level array starts a record
+        if (record_depth == 0 && depth <= 2 && (depth == 1 || array_at_top)) {
+            record_depth = depth;
+            record_rejected = false;
+            bindEpochDefault();
+            return true;
+        }
+
+        return startNested();
+    }
+
+    bool key(string_t& name) override
+    {
+        if (skip_depth > 0 || depth != record_depth) {
+            return true;
+        }
+
+        auto column = column_indices.find(name);
+        pending_column = column == column_indices.end() ? -1 : column->second;
+        skip_next_value = pending_column < 0;
+        return true;
+    }
+
+    bool end_object() override
+    {
+        if (skip_depth > 0) {
+            endNested();
+            return true;
+        }
+
+        if (depth == record_depth) {
+            finishRecord();
+            record_depth = 0;
+        }
+        --depth;
+        return true;
+    }
+
+    bool start_array(std::size_t) override
+    {
+        ++depth;
+        if (depth == 1) {
+            array_at_top = true;
+            return true;
+        }
+        return startNested();
+    }
+
+    bool end_array() override
+    {
+        if (skip_depth > 0) {
+            endNested();
+            return true;
+        }
+        --depth;
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& error) override
+    {
+        report.errors.push_back("malformed JSON at byte " + std::to_string(position) + ": " + error.what());
+        return false;
+    }
+
+private:
+
+    enum class ColumnAffinity
+    {
+        INTEGER,
+        REAL,
+        TEXT,
+        NUMERIC,
+        BLOB
+    };
+
+    struct Column
+    {
+        std::string name;
+        ColumnAffinity affinity;
+        std::string default_value;
+        //a DATETIME column defaulting to the current time, stored as epoch seconds like every DAO writes it
+        bool epoch_default = false;
+    };
+
+    //column names, affinities and defaults from the table schema, following sqlite's affinity rules
+    bool loadColumns()
+    {
+        columns.clear();
+        column_indices.clear();
+
+        if (!db_manager->prepareStatement("SELECT name, upper(type), dflt_value FROM pragma_table_info(?);")) {
+            return false;
+        }
+        db_manager->bindParameter<std::string>(1, table_name);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW)
+        {
+            Column column;
+            column.name = reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 0));
+            const char* declared = reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 1));
+            std::string type = declared ? declared : "";
+            if (sqlite3_column_type(prepared_statement, 2) != SQLITE_NULL) {
+                column.default_value = reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 2));
+            }
+
+            if (type.find("INT") != std::string::npos) {
+                column.affinity = ColumnAffinity::INTEGER;
+            }
+            else if (type.find("CHAR") != std::string::npos || type.find("CLOB") != std::string::npos || type.find("TEXT") != std::string::npos) {
+                column.affinity = ColumnAffinity::TEXT;
+            }
+            else if (type.empty() || type.find("BLOB") != std::string::npos) {
+                column.affinity = ColumnAffinity::BLOB;
+            }
+            else if (type.find("REAL") != std::string::npos || type.find("FLOA") != std::string::npos || type.find("DOUB") != std::string::npos) {
+                column.affinity = ColumnAffinity::REAL;
+            }
+            else {
+                column.affinity = ColumnAffinity::NUMERIC;
+            }
+
+            column.epoch_default = (type.find("DATE") != std::string::npos || type.find("TIME") != std::string::npos) &&
+                column.default_value.rfind("CURRENT_", 0) == 0;
+
+            column_indices[column.name] = static_cast<int>(columns.size());
+            columns.push_back(column);
+        }
+
+        sqlite3_finalize(prepared_statement);
+        return !columns.empty();
+    }
+
+    //every column is bound, columns with a default fall back to it when left unbound or null.
+    //current time defaults share one extra parameter holding the epoch seconds of the record
+    bool prepareInsert()
+    {
+        std::string column_list;
+        std::string value_list;
+        epoch_parameter = 0;
+
+        for (size_t index = 0; index < columns.size(); ++index) {
+            if (index > 0) {
+                column_list += ", ";
+                value_list += ", ";
+            }
+            std::string parameter = "?" + std::to_string(index + 1);
+            column_list += columns[index].name;
+            if (columns[index].epoch_default) {
+                epoch_parameter = static_cast<int>(columns.size()) + 1;
+                value_list += "coalesce(" + parameter + ", ?" + std::to_string(epoch_parameter) + ")";
+            }
+            else {
+                value_list += columns[index].default_value.empty() ? parameter : "coalesce(" + parameter + ", " + columns[index].default_value + ")";
+            }
+        }
+
+        return db_manager->prepareStatement("INSERT INTO " + table_name + " (" + column_list + ") VALUES (" + value_list + ");");
+    }
+
+    //bindings are cleared after every record, the time is bound again as each one starts
+    void bindEpochDefault()
+    {
+        if (epoch_parameter > 0) {
+            db_manager->bindParameter<long long>(epoch_parameter, static_cast<long long>(
+                std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+        }
+    }
+
+    //true when the current value belongs to a known column of a live record
+    bool acceptsValue()
+    {
+        if (skip_depth > 0 || depth != record_depth || record_depth == 0) {
+            return false;
+        }
+        if (skip_next_value) {
+            skip_next_value = false;
+            return false;
+        }
+        return !record_rejected && pending_column >= 0;
+    }
+
+    bool checkNumeric()
+    {
+        if (columns[pending_column].affinity == ColumnAffinity::TEXT) {
+            rejectRecord("column " + columns[pending_column].name + " expects text");
+            return false;
+        }
+        return true;
+    }
+
+    //containers nested in a record cannot be bound to a column and are skipped whole
+    bool startNested()
+    {
+        if (skip_depth == 0 && record_depth != 0 && !skip_next_value && pending_column >= 0) {
+            rejectRecord("column " + columns[pending_column].name + " cannot hold a nested value");
+        }
+        skip_next_value = false;
+        ++skip_depth;
+        return true;
+    }
+
+    void endNested()
+    {
+        --skip_depth;
+        --depth;
+    }
+
+    void rejectRecord(const std::string& reason)
+    {
+        if (!record_rejected) {
+            record_rejected = true;
+            record_error = reason;
+        }
+    }
+
+    void finishRecord()
+    {
+        pending_column = -1;
+        skip_next_value = false;
+        ++record_number;
+
+        if (record_rejected) {
+            db_manager->clearPrepared();
+            ++report.records_rejected;
+            report.errors.push_back("record " + std::to_string(record_number) + ": " + record_error);
+            return;
+        }
+
+        if (db_manager->executeAndReset()) {
+            ++report.records_inserted;
+        }
+        else {
+            ++report.records_rejected;
+            report.errors.push_back("record " + std::to_string(record_number) + ": " + db_manager->getLastError());
+        }
+    }
+
+    DatabaseManager* db_manager;
+    std::string table_name;
+    std::vector<Column> columns;
+    std::unordered_map<std::string, int> column_indices;
+
+    IngestReport report;
+    size_t depth = 0;
+    size_t record_depth = 0;
+    size_t skip_depth = 0;
+    size_t record_number = 0;
+    int pending_column = -1;
+    int epoch_parameter = 0;
+    bool skip_next_value = false;
+    bool array_at_top = false;
+    bool record_rejected = false;
+    std::string record_error;
+};
+
+#endif //JSONINSERTSAX_HPP
@@ -0,0 +1,184 @@
+#ifndef JSONLINESWRITER_HPP
+#define JSONLINESWRITER_HPP
+
+#include <string>
+#include <vector>
+#include <charconv>
+#include <cmath>
+#include <cerrno>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// event style JSON Lines writer, values are serialized straight into a large
+/// output buffer as they are produced instead of being collected into a json DOM,
+/// and the buffer is handed to the file descriptor only when it fills up
+/// </summary>
+class JsonLinesWriter {
+public:
+
+    /// <param name="_file_descriptor">open descriptor, not closed by the writer</param>
+    /// <param name="buffer_size">bytes gathered before each write call, default 1 MiB</param>
+    JsonLinesWriter(int _file_descriptor, size_t buffer_size = 1 << 20) : file_descriptor(_file_descriptor), write_error(false)
+    {
+        buffer.reserve(buffer_size);
+    }
+
+    ~JsonLinesWriter()
+    {
+        flush();
+    }
+
+    JsonLinesWriter(const JsonLinesWriter&) = delete;
+    JsonLinesWriter& operator=(const JsonLinesWriter&) = delete;
+
+    void beginObject()
+    {
+        append('{');
+        first_member = true;
+    }
+
+    //closes the object and terminates the line
+    void endObject()
+    {
+        append('}');
+        append('\n');
+    }
+
+    void key(const char* name, size_t length)
+    {
+        if (!first_member) {
+            append(',');
+        }
+        first_member = false;
+        writeString(name, length);
+        append(':');
+    }
+
+    void valueNull()
+    {
+        appendRaw("null", 4);
+    }
+
+    void valueInteger(long long value)
+    {
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        appendRaw(digits, result.ptr - digits);
+    }
+
+    //non finite doubles have no JSON representation and are written as null
+    void valueDouble(double value)
+    {
+        if (!std::isfinite(value)) {
+            valueNull();
+            return;
+        }
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        appendRaw(digits, result.ptr - digits);
+    }
+
+    void valueString(const char* text, size_t length)
+    {
+        writeString(text, length);
+    }
+
+    //binary data is written as a lower case hex string
+    void valueBlob(const unsigned char* data, size_t length)
+    {
+        static const char hex_digits[] = "0123456789abcdef";
+        append('"');
+        for (size_t i = 0; i < length; ++i) {
+            append(hex_digits[data[i] >> 4]);
+            append(hex_digits[data[i] & 0x0F]);
+        }
+        append('"');
+    }
+
+    /// <summary>
+    /// hands the buffered bytes to the descriptor, retrying partial writes
+    /// </summary>
+    /// <returns>false once any write has failed</returns>
+    bool flush()
+    {
+        size_t written = 0;
+        while (!write_error && written < buffer.size())
+        {
+#ifdef _WIN32
+            int result = _write(file_descriptor, buffer.data() + written, static_cast<unsigned int>(buffer.size() - written));
+#else
+            ssize_t result = ::write(file_descriptor, buffer.data() + written, buffer.size() - written);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+#endif
+            if (result <= 0) {
+                write_error = true;
+                break;
+            }
+            written += static_cast<size_t>(result);
+        }
+        buffer.clear();
+        return !write_error;
+    }
+
+    bool failed() const
+    {
+        return write_error;
+    }
+
+private:
+
+    void writeString(const char* text, size_t length)
+    {
+        static const char hex_digits[] = "0123456789abcdef";
+        append('"');
+        for (size_t i = 0; i < length; ++i)
+        {
+            unsigned char character = static_cast<unsigned char>(text[i]);
+            switch (character) {
+            case '"':  appendRaw("\\\"", 2); break;
+            case '\\': appendRaw("\\\\", 2); break;
+            case '\n': appendRaw("\\n", 2); break;
+            case '\r': appendRaw("\\r", 2); break;
+            case '\t': appendRaw("\\t", 2); break;
+            default:
+                if (character < 0x20) {
+                    char escaped[6] = { '\\', 'u', '0', '0', hex_digits[character >> 4], hex_digits[character & 0x0F] };
+                    appendRaw(escaped, 6);
+                }
+                else {
+                    append(static_cast<char>(character));
+                }
+            }
+        }
+        append('"');
+    }
+
+    void append(char character)
+    {
+        if (buffer.size() == buffer.capacity()) {
+            flush();
+        }
+        buffer.push_back(character);
+    }
+
+    void appendRaw(const char* data, size_t length)
+    {
+        if (buffer.size() + length > buffer.capacity()) {
+            flush();
+        }
+        buffer.insert(buffer.end(), data, data + length);
+    }
+
+    int file_descriptor;
+    bool write_error;
+    bool first_member = true;
+    std::vector<char> buffer;
+};
+
+#endif //JSONLINESWRITER_HPP
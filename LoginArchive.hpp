@@ -0,0 +1,354 @@
+#ifndef LOGINARCHIVE_HPP
+#define LOGINARCHIVE_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include "nlohmann\\json.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// <summary>
+/// cold storage for the append only Logins table, rows older than a retention
+/// horizon are moved out of the hot table into immutable segments inside an
+/// attached archive database. each segment stores its rows column by column with
+/// delta and varint encoded ids, users and timestamps so the archive stays small,
+/// and carries its id and timestamp bounds so lookups only decode overlapping segments
+/// </summary>
+class LoginArchive {
+public:
+
+    /// <summary>
+    /// decoded contents of one segment, one entry per archived login in login_id order
+    /// </summary>
+    struct LoginSegment {
+        std::vector<int64_t> login_ids;
+        std::vector<int64_t> login_users;
+        std::vector<uint8_t> login_successes;
+        std::vector<int64_t> login_timestamps;
+    };
+
+    /// <summary>
+    /// attaches the archive database and creates the segment table if needed
+    /// </summary>
+    /// <param name="_db_manager">manager owning the hot Logins table</param>
+    /// <param name="archive_path">file of the archive database</param>
+    LoginArchive(DatabaseManager& _db_manager, const std::string& archive_path) : db_manager(&_db_manager)
+    {
+        db_manager->prepareStatement("ATTACH DATABASE ? AS login_archive;");
+        db_manager->bindParameter<std::string>(1, archive_path);
+        if (!db_manager->executePrepared()) {
+            throw std::runtime_error("Failed to attach login archive: " + archive_path);
+        }
+
+        db_manager->createTableIfNotExists
+        (
+            "login_archive.LoginSegments",
+            "segment_id                 INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+            "segment_first_id           INTEGER     NOT NULL, "
+            "segment_last_id            INTEGER     NOT NULL, "
+            "segment_first_timestamp    INTEGER     NOT NULL, "
+            "segment_last_timestamp     INTEGER     NOT NULL, "
+            "segment_row_count          INTEGER     NOT NULL, "
+            "segment_data               BLOB        NOT NULL"
+        );
+        db_manager->executeQuery("CREATE INDEX IF NOT EXISTS login_archive.LoginSegments_ids ON LoginSegments (segment_first_id, segment_last_id);");
+        db_manager->executeQuery("CREATE INDEX IF NOT EXISTS login_archive.LoginSegments_timestamps ON LoginSegments (segment_last_timestamp, segment_first_timestamp);");
+    }
+
+    /// <summary>
+    /// moves every hot login older than the horizon into new segments, all inside one
+    /// transaction so a row is never visible in both or neither table
+    /// </summary>
+    /// <param name="horizon_timestamp">logins with an earlier timestamp are archived</param>
+    /// <param name="segment_rows">maximum rows per segment</param>
+    /// <returns>number of archived rows, -1 on failure</returns>
+    int archiveOlderThan(int horizon_timestamp, int segment_rows = 65536)
+    {
+        if (!db_manager->beginTransaction()) {
+            return -1;
+        }
+
+        int archived_rows = 0;
+        int64_t last_id = 0;
+
+        while (true)
+        {
+            LoginSegment segment;
+
+            db_manager->prepareStatement(
+                "SELECT login_id, login_user, login_success, login_timestamp FROM main.Logins "
+                "WHERE login_id > ? AND login_timestamp < ? ORDER BY login_id LIMIT ?;");
+            db_manager->bindParameter<int>(1, static_cast<int>(last_id));
+            db_manager->bindParameter<int>(2, horizon_timestamp);
+            db_manager->bindParameter<int>(3, segment_rows);
+            sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+            while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+                segment.login_ids.push_back(sqlite3_column_int64(prepared_statement, 0));
+                segment.login_users.push_back(sqlite3_column_int64(prepared_statement, 1));
+                segment.login_successes.push_back(sqlite3_column_int(prepared_statement, 2) != 0);
+                segment.login_timestamps.push_back(sqlite3_column_int64(prepared_statement, 3));
+            }
+            sqlite3_finalize(prepared_statement);
+
+            if (segment.login_ids.empty()) {
+                break;
+            }
+
+            if (!writeSegment(segment)) {
+                db_manager->rollbackTransaction();
+                return -1;
+            }
+
+            last_id = segment.login_ids.back();
+            archived_rows += static_cast<int>(segment.login_ids.size());
+        }
+
+        //the archived rows are exactly the old rows up to the last archived id
+        db_manager->prepareStatement("DELETE FROM main.Logins WHERE login_id <= ? AND login_timestamp < ?;");
+        db_manager->bindParameter<int>(1, static_cast<int>(last_id));
+        db_manager->bindParameter<int>(2, horizon_timestamp);
+        if (!db_manager->executePrepared() || !db_manager->commitTransaction()) {
+            std::cerr << "Error in archiveOlderThan" << std::endl;
+            db_manager->rollbackTransaction();
+            return -1;
+        }
+
+        return archived_rows;
+    }
+
+    /// <summary>
+    /// looks up an archived login by id, only the segment covering the id is decoded
+    /// </summary>
+    /// <returns>the record in the same shape as LoginDAO, empty if not archived</returns>
+    nlohmann::json retrieveRecordById(int id)
+    {
+        nlohmann::json json_result;
+
+        for (const LoginSegment& segment : readSegments(
+            "SELECT segment_data FROM login_archive.LoginSegments WHERE segment_first_id <= ? AND segment_last_id >= ?;", id, id))
+        {
+            for (size_t row = 0; row < segment.login_ids.size(); ++row) {
+                if (segment.login_ids[row] == id) {
+                    return toJson(segment, row);
+                }
+            }
+        }
+
+        return json_result;
+    }
+
+    /// <summary>
+    /// archived logins of a user within [from_timestamp, to_timestamp)
+    /// </summary>
+    nlohmann::json retrieveHistory(int user_id, int from_timestamp, int to_timestamp)
+    {
+        nlohmann::json json_result = nlohmann::json::array();
+
+        for (const LoginSegment& segment : readSegments(
+            "SELECT segment_data FROM login_archive.LoginSegments WHERE segment_last_timestamp >= ? AND segment_first_timestamp < ? "
+            "ORDER BY segment_first_id;", from_timestamp, to_timestamp))
+        {
+            for (size_t row = 0; row < segment.login_ids.size(); ++row) {
+                if (matches(segment, row, user_id, from_timestamp, to_timestamp)) {
+                    json_result.push_back(toJson(segment, row));
+                }
+            }
+        }
+
+        return json_result;
+    }
+
+    /// <summary>
+    /// counts archived successes and failures of a user within [from_timestamp, to_timestamp)
+    /// </summary>
+    void countLogins(int user_id, int from_timestamp, int to_timestamp, int& success_count, int& failure_count)
+    {
+        for (const LoginSegment& segment : readSegments(
+            "SELECT segment_data FROM login_archive.LoginSegments WHERE segment_last_timestamp >= ? AND segment_first_timestamp < ?;",
+            from_timestamp, to_timestamp))
+        {
+            for (size_t row = 0; row < segment.login_ids.size(); ++row) {
+                if (matches(segment, row, user_id, from_timestamp, to_timestamp)) {
+                    ++(segment.login_successes[row] ? success_count : failure_count);
+                }
+            }
+        }
+    }
+
+    // Segment Codec ---------------------------------------------------------------------------------------
+
+    /// <summary>
+    /// row count followed by each column, integer columns as zigzag varint deltas from
+    /// the previous row and the success column packed eight rows per byte
+    /// </summary>
+    static std::vector<unsigned char> encodeSegment(const LoginSegment& segment)
+    {
+        std::vector<unsigned char> encoded;
+        const size_t row_count = segment.login_ids.size();
+
+        writeVarint(encoded, row_count);
+        writeDeltaColumn(encoded, segment.login_ids);
+        writeDeltaColumn(encoded, segment.login_users);
+        writeDeltaColumn(encoded, segment.login_timestamps);
+
+        for (size_t row = 0; row < row_count; row += 8) {
+            unsigned char packed = 0;
+            for (size_t bit = 0; bit < 8 && row + bit < row_count; ++bit) {
+                packed |= (segment.login_successes[row + bit] ? 1 : 0) << bit;
+            }
+            encoded.push_back(packed);
+        }
+
+        return encoded;
+    }
+
+    static bool decodeSegment(const unsigned char* data, size_t size, LoginSegment& segment)
+    {
+        size_t position = 0;
+        uint64_t row_count = 0;
+
+        //every row takes at least one byte in each of the three varint columns, a count
+        //beyond that is corrupt and must not size the columns
+        if (!readVarint(data, size, position, row_count) ||
+            row_count > (size - position) / 3 ||
+            !readDeltaColumn(data, size, position, row_count, segment.login_ids) ||
+            !readDeltaColumn(data, size, position, row_count, segment.login_users) ||
+            !readDeltaColumn(data, size, position, row_count, segment.login_timestamps) ||
+            size - position < (row_count + 7) / 8)
+        {
+            return false;
+        }
+
+        segment.login_successes.resize(row_count);
+        for (size_t row = 0; row < row_count; ++row) {
+            segment.login_successes[row] = (data[position + row / 8] >> (row % 8)) & 1;
+        }
+
+        return true;
+    }
+
+private:
+
+    bool writeSegment(const LoginSegment& segment)
+    {
+        int64_t first_timestamp = segment.login_timestamps.front();
+        int64_t last_timestamp = segment.login_timestamps.front();
+        for (int64_t timestamp : segment.login_timestamps) {
+            first_timestamp = std::min(first_timestamp, timestamp);
+            last_timestamp = std::max(last_timestamp, timestamp);
+        }
+
+        db_manager->prepareStatement(
+            "INSERT INTO login_archive.LoginSegments (segment_first_id, segment_last_id, segment_first_timestamp, "
+            "segment_last_timestamp, segment_row_count, segment_data) VALUES (?, ?, ?, ?, ?, ?);");
+        db_manager->bindParameter<int>(1, static_cast<int>(segment.login_ids.front()));
+        db_manager->bindParameter<int>(2, static_cast<int>(segment.login_ids.back()));
+        db_manager->bindParameter<int>(3, static_cast<int>(first_timestamp));
+        db_manager->bindParameter<int>(4, static_cast<int>(last_timestamp));
+        db_manager->bindParameter<int>(5, static_cast<int>(segment.login_ids.size()));
+        db_manager->bindParameter<std::vector<unsigned char>>(6, encodeSegment(segment));
+
+        if (!db_manager->executePrepared()) {
+            std::cerr << "Error in writeSegment" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<LoginSegment> readSegments(const std::string& sql, int first_bound, int second_bound)
+    {
+        std::vector<LoginSegment> segments;
+
+        if (!db_manager->prepareStatement(sql)) {
+            return segments;
+        }
+        db_manager->bindParameter<int>(1, first_bound);
+        db_manager->bindParameter<int>(2, second_bound);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            LoginSegment segment;
+            const unsigned char* data = static_cast<const unsigned char*>(sqlite3_column_blob(prepared_statement, 0));
+            size_t size = static_cast<size_t>(sqlite3_column_bytes(prepared_statement, 0));
+            if (data && decodeSegment(data, size, segment)) {
+                segments.push_back(std::move(segment));
+            }
+            else {
+                std::cerr << "Error in readSegments: corrupt login segment" << std::endl;
+            }
+        }
+
+        sqlite3_finalize(prepared_statement);
+        return segments;
+    }
+
+    static bool matches(const LoginSegment& segment, size_t row, int user_id, int from_timestamp, int to_timestamp)
+    {
+        return segment.login_users[row] == user_id &&
+            segment.login_timestamps[row] >= from_timestamp &&
+            segment.login_timestamps[row] < to_timestamp;
+    }
+
+    static nlohmann::json toJson(const LoginSegment& segment, size_t row)
+    {
+        return {
+            {"login_id", segment.login_ids[row]},
+            {"login_user", std::to_string(segment.login_users[row])},
+            {"login_success", segment.login_successes[row]},
+            {"login_timestamp", segment.login_timestamps[row]}
+        };
+    }
+
+    static void writeVarint(std::vector<unsigned char>& encoded, uint64_t value)
+    {
+        while (value >= 0x80) {
+            encoded.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        encoded.push_back(static_cast<unsigned char>(value));
+    }
+
+    static bool readVarint(const unsigned char* data, size_t size, size_t& position, uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && position < size; shift += 7) {
+            unsigned char byte = data[position++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void writeDeltaColumn(std::vector<unsigned char>& encoded, const std::vector<int64_t>& column)
+    {
+        int64_t previous = 0;
+        for (int64_t value : column) {
+            int64_t delta = value - previous;
+            writeVarint(encoded, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+            previous = value;
+        }
+    }
+
+    static bool readDeltaColumn(const unsigned char* data, size_t size, size_t& position, uint64_t row_count, std::vector<int64_t>& column)
+    {
+        column.resize(row_count);
+        int64_t previous = 0;
+        for (uint64_t row = 0; row < row_count; ++row) {
+            uint64_t zigzag = 0;
+            if (!readVarint(data, size, position, zigzag)) {
+                return false;
+            }
+            previous += static_cast<int64_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+            column[row] = previous;
+        }
+        return true;
+    }
+
+    DatabaseManager* db_manager;
+};
+
+#endif //LOGINARCHIVE_HPP
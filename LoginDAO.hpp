@@ -2,12 +2,74 @@
 #define LOGINDAO_HPP
 
 #include "GenericDAO.hpp"
+#include "LoginArchive.hpp"
+#include <chrono>
+#include <algorithm>
 
 class LoginDAO : public GenericDAO
 {
 public:
 
-    //update individual column
+    enum class RollupGranularity
+    {
+        MINUTE,
+        HOUR,
+        DAY
+    };
+
+    LoginDAO(DatabaseManager &db_manager) : GenericDAO(&db_manager) {}
+
+    //rollup tables hold per user success/failure counts bucketed by minute, hour and day,
+    //they are maintained by insert triggers on Logins so every recorded event updates
+    //all three buckets atomically with the raw row. a table created on a database that
+    //already holds logins is filled from them in the same transaction as its trigger
+    bool createRollupTables()
+    {
+        if (!db_manager->beginTransaction()) {
+            return false;
+        }
+
+        const std::string rollup_schema =
+            "rollup_user        INTEGER     NOT NULL, "
+            "rollup_bucket      INTEGER     NOT NULL, "
+            "rollup_success     INTEGER     NOT NULL        DEFAULT 0, "
+            "rollup_failure     INTEGER     NOT NULL        DEFAULT 0, "
+            "PRIMARY KEY (rollup_user, rollup_bucket)";
+
+        for (RollupGranularity granularity : {RollupGranularity::MINUTE, RollupGranularity::HOUR, RollupGranularity::DAY})
+        {
+            const std::string table_name = rollupTableName(granularity);
+            const std::string bucket_width = std::to_string(rollupBucketWidth(granularity));
+            const bool backfill = !rollupTableExists(table_name);
+
+            db_manager->createTableIfNotExists(table_name, rollup_schema);
+            db_manager->executeQuery(
+                "CREATE TRIGGER IF NOT EXISTS " + table_name + "_rollup AFTER INSERT ON Logins BEGIN "
+                "INSERT INTO " + table_name + " (rollup_user, rollup_bucket, rollup_success, rollup_failure) "
+                "VALUES (NEW.login_user, NEW.login_timestamp - NEW.login_timestamp % " + bucket_width + ", "
+                "NEW.login_success != 0, NEW.login_success = 0) "
+                "ON CONFLICT (rollup_user, rollup_bucket) DO UPDATE SET "
+                "rollup_success = rollup_success + excluded.rollup_success, "
+                "rollup_failure = rollup_failure + excluded.rollup_failure; "
+                "END;");
+
+            if (backfill && !db_manager->tryExecuteQuery(
+                "INSERT INTO " + table_name + " (rollup_user, rollup_bucket, rollup_success, rollup_failure) "
+                "SELECT login_user, login_timestamp - login_timestamp % " + bucket_width + ", "
+                "SUM(login_success != 0), SUM(login_success = 0) FROM Logins "
+                "GROUP BY login_user, login_timestamp - login_timestamp % " + bucket_width + ";"))
+            {
+                std::cerr << "Error in createRollupTables: backfill of " << table_name << " failed" << std::endl;
+                db_manager->rollbackTransaction();
+                return false;
+            }
+        }
+
+        //raw edges of a range query are answered from Logins directly
+        db_manager->executeQuery("CREATE INDEX IF NOT EXISTS Logins_user_timestamp ON Logins (login_user, login_timestamp);");
+
+        return db_manager->commitTransaction();
+    }
 
     //C
     // Insert a new record into the database
@@ -22,7 +84,7 @@ public:
         //required bindings already validated
         db_manager->bindParameter<std::string>(1, json_data["login_user"]);
         db_manager->bindParameter<int>(2, json_data["login_success"]);
-        db_manager->bindParameter<int>(3, std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+        db_manager->bindOptional<int>(3, json_data, "login_timestamp", std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
 
         if (!db_manager->executePrepared())
         {
@@ -46,12 +108,20 @@ public:
         if (sqlite3_step(prepared_statement) == SQLITE_ROW) {
             // Assuming column indices are in order as per your table schema
 
+            //same keys as an archived record
+            db_manager->getParameter<int>(0, json_result, "login_id", prepared_statement);
             db_manager->getParameter<std::string>(1, json_result, "login_user", prepared_statement);
             db_manager->getParameter<int>(2, json_result, "login_success", prepared_statement);
             db_manager->getParameter<int>(3, json_result, "login_timestamp", prepared_statement);
+        }
+        sqlite3_finalize(prepared_statement);
 
-            return json_result;
+        //rows past the retention horizon live in the archive
+        if (json_result.is_null() && archive) {
+            return archive->retrieveRecordById(id);
         }
+
+        return json_result;
     }
 
     //U
@@ -72,8 +142,176 @@ public:
     {
         GenericDAO::existenceOfRecordByField("Logins", field_name, value);
     }
+
+    //archived logins stay reachable through this DAO once an archive is attached
+    void setArchive(LoginArchive* _archive)
+    {
+        archive = _archive;
+    }
+
+    //logins of a user within [from_timestamp, to_timestamp) in timestamp order,
+    //spanning both the hot table and the archive
+    nlohmann::json retrieveLoginHistory(int user_id, int from_timestamp, int to_timestamp)
+    {
+        nlohmann::json json_result = archive ? archive->retrieveHistory(user_id, from_timestamp, to_timestamp) : nlohmann::json::array();
+
+        std::string sql = "SELECT login_id, login_user, login_success, login_timestamp FROM Logins "
+            "WHERE login_user = ? AND login_timestamp >= ? AND login_timestamp < ? ORDER BY login_timestamp;";
+        if (!db_manager->prepareStatement(sql)) {
+            return json_result;
+        }
+        db_manager->bindParameter<int>(1, user_id);
+        db_manager->bindParameter<int>(2, from_timestamp);
+        db_manager->bindParameter<int>(3, to_timestamp);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            nlohmann::json login;
+            db_manager->getParameter<int>(0, login, "login_id", prepared_statement);
+            db_manager->getParameter<std::string>(1, login, "login_user", prepared_statement);
+            db_manager->getParameter<int>(2, login, "login_success", prepared_statement);
+            db_manager->getParameter<int>(3, login, "login_timestamp", prepared_statement);
+            json_result.push_back(login);
+        }
+        sqlite3_finalize(prepared_statement);
+
+        //hot rows may predate archived ones when history is backfilled
+        std::stable_sort(json_result.begin(), json_result.end(), [](const nlohmann::json& left, const nlohmann::json& right) {
+            return left["login_timestamp"].get<int>() < right["login_timestamp"].get<int>();
+        });
+
+        return json_result;
+    }
+
+    //counts successful and failed logins of a user within [from_timestamp, to_timestamp),
+    //whole days, hours and minutes are summed from the coarsest rollup that fits and only
+    //the sub-minute edges of the range touch the raw Logins table
+    nlohmann::json countLoginsInRange(int user_id, int from_timestamp, int to_timestamp)
+    {
+        nlohmann::json json_result = { {"login_success", 0}, {"login_failure", 0} };
+        accumulateRange(0, user_id, from_timestamp, to_timestamp, json_result);
+        return json_result;
+    }
+
+    //per bucket counts for dashboards, one entry per non empty bucket in [from_timestamp, to_timestamp)
+    nlohmann::json retrieveRollupSeries(int user_id, RollupGranularity granularity, int from_timestamp, int to_timestamp)
+    {
+        nlohmann::json json_result = nlohmann::json::array();
+
+        std::string sql = "SELECT rollup_bucket, rollup_success, rollup_failure FROM " + rollupTableName(granularity) +
+            " WHERE rollup_user = ? AND rollup_bucket >= ? AND rollup_bucket < ? ORDER BY rollup_bucket;";
+        if (!db_manager->prepareStatement(sql)) {
+            return json_result;
+        }
+        db_manager->bindParameter<int>(1, user_id);
+        db_manager->bindParameter<int>(2, from_timestamp);
+        db_manager->bindParameter<int>(3, to_timestamp);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            nlohmann::json bucket;
+            db_manager->getParameter<int>(0, bucket, "rollup_bucket", prepared_statement);
+            db_manager->getParameter<int>(1, bucket, "rollup_success", prepared_statement);
+            db_manager->getParameter<int>(2, bucket, "rollup_failure", prepared_statement);
+            json_result.push_back(bucket);
+        }
+
+        sqlite3_finalize(prepared_statement);
+        return json_result;
+    }
+
 private:
 
+    bool rollupTableExists(const std::string& table_name)
+    {
+        db_manager->prepareStatement("SELECT EXISTS(SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?);");
+        db_manager->bindParameter<std::string>(1, table_name);
+        return db_manager->fetchBooleanResult();
+    }
+
+    static std::string rollupTableName(RollupGranularity granularity)
+    {
+        switch (granularity) {
+        case RollupGranularity::MINUTE: return "LoginsPerMinute";
+        case RollupGranularity::HOUR:   return "LoginsPerHour";
+        case RollupGranularity::DAY:    return "LoginsPerDay";
+        }
+        return "";
+    }
+
+    static int rollupBucketWidth(RollupGranularity granularity)
+    {
+        switch (granularity) {
+        case RollupGranularity::MINUTE: return 60;
+        case RollupGranularity::HOUR:   return 60 * 60;
+        case RollupGranularity::DAY:    return 60 * 60 * 24;
+        }
+        return 1;
+    }
+
+    //level 0 is days, 1 hours, 2 minutes and 3 the raw table, each level takes the whole
+    //buckets inside the range and hands the leftover edges down to the next finer level
+    void accumulateRange(int level, int user_id, long long from_timestamp, long long to_timestamp, nlohmann::json& json_result)
+    {
+        static const RollupGranularity levels[] = { RollupGranularity::DAY, RollupGranularity::HOUR, RollupGranularity::MINUTE };
+
+        if (from_timestamp >= to_timestamp) {
+            return;
+        }
+
+        if (level == 3) {
+            accumulateQuery(
+                "SELECT COALESCE(SUM(login_success != 0), 0), COALESCE(SUM(login_success = 0), 0) FROM Logins "
+                "WHERE login_user = ? AND login_timestamp >= ? AND login_timestamp < ?;",
+                user_id, from_timestamp, to_timestamp, json_result);
+
+            if (archive) {
+                int success_count = 0;
+                int failure_count = 0;
+                archive->countLogins(user_id, static_cast<int>(from_timestamp), static_cast<int>(to_timestamp), success_count, failure_count);
+                json_result["login_success"] = json_result["login_success"].get<int>() + success_count;
+                json_result["login_failure"] = json_result["login_failure"].get<int>() + failure_count;
+            }
+            return;
+        }
+
+        const long long width = rollupBucketWidth(levels[level]);
+        const long long first_bucket = (from_timestamp + width - 1) / width * width;
+        const long long last_bucket = to_timestamp / width * width;
+
+        if (first_bucket >= last_bucket) {
+            accumulateRange(level + 1, user_id, from_timestamp, to_timestamp, json_result);
+            return;
+        }
+
+        accumulateQuery(
+            "SELECT COALESCE(SUM(rollup_success), 0), COALESCE(SUM(rollup_failure), 0) FROM " + rollupTableName(levels[level]) +
+            " WHERE rollup_user = ? AND rollup_bucket >= ? AND rollup_bucket < ?;",
+            user_id, first_bucket, last_bucket, json_result);
+
+        accumulateRange(level + 1, user_id, from_timestamp, first_bucket, json_result);
+        accumulateRange(level + 1, user_id, last_bucket, to_timestamp, json_result);
+    }
+
+    void accumulateQuery(const std::string& sql, int user_id, long long from_timestamp, long long to_timestamp, nlohmann::json& json_result)
+    {
+        if (!db_manager->prepareStatement(sql)) {
+            return;
+        }
+        db_manager->bindParameter<int>(1, user_id);
+        db_manager->bindParameter<int>(2, static_cast<int>(from_timestamp));
+        db_manager->bindParameter<int>(3, static_cast<int>(to_timestamp));
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+
+        if (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            json_result["login_success"] = json_result["login_success"].get<int>() + sqlite3_column_int(prepared_statement, 0);
+            json_result["login_failure"] = json_result["login_failure"].get<int>() + sqlite3_column_int(prepared_statement, 1);
+        }
+
+        sqlite3_finalize(prepared_statement);
+    }
+
+    LoginArchive* archive = nullptr;
 };
 
 #endif //LOGINDAO_HPP
\ No newline at end of file
@@ -0,0 +1,532 @@
+#ifndef MOVEMENTLEDGER_HPP
+#define MOVEMENTLEDGER_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include "nlohmann\\json.hpp"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <optional>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+
+/// <summary>
+/// append only audit trail of placements, moves, quantity changes, ownership transfers and
+/// removals of elements. events are written to Movements by triggers on Element and
+/// ElementStock, inside the transaction of the write that caused them, so every connection
+/// and DAO instance is recorded and an event is never lost or recorded for a write that rolled
+/// back. every snapshot_interval events the resulting state is written to MovementSnapshots, so
+/// the state at any time is the latest snapshot before it plus a short replay instead of the
+/// full history. the in memory state is a cache of the table, brought up to date on each query
+/// </summary>
+class MovementLedger {
+public:
+
+    enum class MovementKind
+    {
+        PLACE,
+        MOVE,
+        QUANTITY,
+        OWNERSHIP,
+        REMOVE
+    };
+
+    //parent and quantities are the values after the event, previous_parent is kept for the audit trail
+    struct Movement
+    {
+        long long movement_id = 0;
+        int timestamp = 0;
+        MovementKind kind = MovementKind::PLACE;
+        std::string element_guid;
+        std::optional<std::string> previous_parent;
+        std::optional<std::string> parent;
+        int owner = 0;
+        std::string stock_key;
+        double quantity = 0.0;
+        int user = 0;
+    };
+
+    struct ElementState
+    {
+        std::optional<std::string> parent;
+        int owner = 0;
+        std::map<std::string, double> quantities;
+    };
+
+    /// <summary>
+    /// where every element was, who owned it and what it held, as rebuilt from the ledger
+    /// </summary>
+    class InventoryState {
+    public:
+
+        void apply(const Movement& movement)
+        {
+            if (movement.kind == MovementKind::REMOVE) {
+                elements.erase(movement.element_guid);
+                return;
+            }
+
+            ElementState& element = elements[movement.element_guid];
+            switch (movement.kind) {
+            case MovementKind::PLACE:
+                element.parent = movement.parent;
+                element.owner = movement.owner;
+                break;
+            case MovementKind::MOVE:
+                element.parent = movement.parent;
+                break;
+            case MovementKind::QUANTITY:
+                if (movement.quantity == 0.0) {
+                    element.quantities.erase(movement.stock_key);
+                }
+                else {
+                    element.quantities[movement.stock_key] = movement.quantity;
+                }
+                break;
+            case MovementKind::OWNERSHIP:
+                element.owner = movement.owner;
+                break;
+            default:
+                break;
+            }
+        }
+
+        const ElementState* find(const std::string& guid) const
+        {
+            auto element = elements.find(guid);
+            return element == elements.end() ? nullptr : &element->second;
+        }
+
+        //elements directly inside the location
+        std::vector<std::string> contentsOf(const std::string& location_guid) const
+        {
+            std::vector<std::string> contents;
+            for (const auto& element : elements) {
+                if (element.second.parent == location_guid) {
+                    contents.push_back(element.first);
+                }
+            }
+            std::sort(contents.begin(), contents.end());
+            return contents;
+        }
+
+        size_t size() const
+        {
+            return elements.size();
+        }
+
+        //compact CBOR encoding used for snapshots
+        std::vector<uint8_t> serialize() const
+        {
+            nlohmann::json state = nlohmann::json::object();
+            for (const auto& element : elements) {
+                nlohmann::json entry = { {"p", nullptr}, {"o", element.second.owner} };
+                if (element.second.parent.has_value()) {
+                    entry["p"] = element.second.parent.value();
+                }
+                if (!element.second.quantities.empty()) {
+                    entry["q"] = element.second.quantities;
+                }
+                state[element.first] = entry;
+            }
+            return nlohmann::json::to_cbor(state);
+        }
+
+        static std::optional<InventoryState> deserialize(const uint8_t* data, size_t length)
+        {
+            nlohmann::json state = nlohmann::json::from_cbor(data, data + length, true, false);
+            if (!state.is_object()) {
+                return std::nullopt;
+            }
+
+            InventoryState inventory;
+            for (auto entry = state.begin(); entry != state.end(); ++entry) {
+                ElementState& element = inventory.elements[entry.key()];
+                if (entry.value()["p"].is_string()) {
+                    element.parent = entry.value()["p"].get<std::string>();
+                }
+                element.owner = entry.value()["o"].get<int>();
+                if (entry.value().contains("q")) {
+                    element.quantities = entry.value()["q"].get<std::map<std::string, double>>();
+                }
+            }
+            return inventory;
+        }
+
+    private:
+        std::unordered_map<std::string, ElementState> elements;
+    };
+
+    MovementLedger(DatabaseManager& _db_manager, size_t _snapshot_interval = 1000)
+        : db_manager(&_db_manager), snapshot_interval(_snapshot_interval == 0 ? 1 : _snapshot_interval) {}
+
+    //the ledger is append only, sqlite itself refuses to change or remove a movement. the
+    //recording triggers are created here, after ElementDAO has created Element and ElementStock
+    void createLedgerTables()
+    {
+        db_manager->executeQuery(
+            "CREATE TABLE IF NOT EXISTS Movements ("
+            "movement_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+            "movement_timestamp     INTEGER     NOT NULL, "
+            "movement_kind          INTEGER     NOT NULL, "
+            "movement_element       TEXT        NOT NULL, "
+            "movement_from          TEXT, "
+            "movement_to            TEXT, "
+            "movement_owner         INTEGER, "
+            "movement_key           TEXT, "
+            "movement_quantity      REAL, "
+            "movement_user          INTEGER"
+            ");");
+        db_manager->executeQuery(
+            "CREATE INDEX IF NOT EXISTS Movements_element ON Movements (movement_element, movement_id);");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS Movements_no_update BEFORE UPDATE ON Movements "
+            "BEGIN SELECT RAISE(ABORT, 'Movements is append only'); END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS Movements_no_delete BEFORE DELETE ON Movements "
+            "BEGIN SELECT RAISE(ABORT, 'Movements is append only'); END;");
+
+        db_manager->executeQuery(
+            "CREATE TABLE IF NOT EXISTS MovementSnapshots ("
+            "snapshot_movement      INTEGER     PRIMARY KEY, "
+            "snapshot_timestamp     INTEGER     NOT NULL, "
+            "snapshot_state         BLOB        NOT NULL"
+            ");");
+        db_manager->executeQuery(
+            "CREATE INDEX IF NOT EXISTS MovementSnapshots_timestamp ON MovementSnapshots (snapshot_timestamp);");
+
+        //what the triggers stamp events with, a NULL timestamp is the current time
+        db_manager->executeQuery(
+            "CREATE TABLE IF NOT EXISTS MovementContext ("
+            "context_id             INTEGER     PRIMARY KEY     CHECK(context_id = 0), "
+            "context_user           INTEGER     NOT NULL        DEFAULT 0, "
+            "context_timestamp      INTEGER"
+            ");");
+        db_manager->executeQuery("INSERT OR IGNORE INTO MovementContext (context_id) VALUES (0);");
+
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS Movements_place AFTER INSERT ON Element BEGIN " +
+            recordMovement(MovementKind::PLACE, "new.element_guid", "NULL", "new.element_parent_guid", "new.element_owner", "NULL", "NULL") +
+            " END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS Movements_move AFTER UPDATE OF element_parent_guid ON Element "
+            "WHEN old.element_parent_guid IS NOT new.element_parent_guid BEGIN " +
+            recordMovement(MovementKind::MOVE, "new.element_guid", "old.element_parent_guid", "new.element_parent_guid", "NULL", "NULL", "NULL") +
+            " END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS Movements_ownership AFTER UPDATE OF element_owner ON Element "
+            "WHEN old.element_owner IS NOT new.element_owner BEGIN " +
+            recordMovement(MovementKind::OWNERSHIP, "new.element_guid", "NULL", "NULL", "new.element_owner", "NULL", "NULL") +
+            " END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS Movements_remove AFTER DELETE ON Element BEGIN " +
+            recordMovement(MovementKind::REMOVE, "old.element_guid", "old.element_parent_guid", "NULL", "NULL", "NULL", "NULL") +
+            " END;");
+
+        //the empty row adjustQuantity inserts before adding to it is not an event of its own
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS Movements_stock_insert AFTER INSERT ON ElementStock "
+            "WHEN new.stock_quantity <> 0 BEGIN " +
+            recordMovement(MovementKind::QUANTITY, "new.stock_element", "NULL", "NULL", "NULL", "new.stock_key", "new.stock_quantity") +
+            " END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS Movements_stock_update AFTER UPDATE OF stock_quantity ON ElementStock "
+            "WHEN old.stock_quantity IS NOT new.stock_quantity BEGIN " +
+            recordMovement(MovementKind::QUANTITY, "new.stock_element", "NULL", "NULL", "NULL", "new.stock_key", "new.stock_quantity") +
+            " END;");
+        db_manager->executeQuery(
+            "CREATE TRIGGER IF NOT EXISTS Movements_stock_delete AFTER DELETE ON ElementStock BEGIN " +
+            recordMovement(MovementKind::QUANTITY, "old.stock_element", "NULL", "NULL", "NULL", "old.stock_key", "0") +
+            " END;");
+    }
+
+    /// <summary>
+    /// rebuilds the cached state from the latest snapshot and the movements after it
+    /// </summary>
+    bool load()
+    {
+        current = InventoryState();
+        last_applied = 0;
+        last_timestamp = 0;
+        since_snapshot = 0;
+
+        db_manager->prepareStatement(
+            "SELECT snapshot_movement, snapshot_timestamp, snapshot_state FROM MovementSnapshots ORDER BY snapshot_movement DESC LIMIT 1;");
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+        if (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            auto snapshot = InventoryState::deserialize(
+                static_cast<const uint8_t*>(sqlite3_column_blob(prepared_statement, 2)),
+                static_cast<size_t>(sqlite3_column_bytes(prepared_statement, 2)));
+            if (!snapshot.has_value()) {
+                sqlite3_finalize(prepared_statement);
+                std::cerr << "Error in MovementLedger::load: latest snapshot is corrupt" << std::endl;
+                return false;
+            }
+            current = std::move(snapshot.value());
+            last_applied = sqlite3_column_int64(prepared_statement, 0);
+            last_timestamp = sqlite3_column_int(prepared_statement, 1);
+        }
+        sqlite3_finalize(prepared_statement);
+
+        return refresh();
+    }
+
+    /// <summary>
+    /// applies the movements recorded since the cache was last brought up to date, a
+    /// snapshot is written every snapshot_interval of them
+    /// </summary>
+    bool refresh()
+    {
+        while (true)
+        {
+            const size_t wanted = snapshot_interval - since_snapshot;
+            std::vector<Movement> batch;
+
+            if (!db_manager->prepareStatement("SELECT " + movement_columns + " FROM Movements WHERE movement_id > ? ORDER BY movement_id LIMIT ?;")) {
+                return false;
+            }
+            db_manager->bindParameter<long long>(1, last_applied);
+            db_manager->bindParameter<long long>(2, static_cast<long long>(wanted));
+            sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+            while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+                batch.push_back(readMovement(prepared_statement));
+            }
+            sqlite3_finalize(prepared_statement);
+
+            for (const Movement& movement : batch) {
+                current.apply(movement);
+                last_applied = movement.movement_id;
+                last_timestamp = movement.timestamp;
+            }
+            since_snapshot += batch.size();
+
+            if (since_snapshot >= snapshot_interval && !takeSnapshot()) {
+                return false;
+            }
+            if (batch.size() < wanted) {
+                return true;
+            }
+        }
+    }
+
+    //time stamped on the events the triggers record, std::nullopt for the current time. kept in
+    //the database with the acting user, so it applies to writes from every connection
+    bool setTimestamp(std::optional<int> timestamp)
+    {
+        db_manager->prepareStatement("UPDATE MovementContext SET context_timestamp = ?;");
+        if (timestamp.has_value()) {
+            db_manager->bindParameter<int>(1, timestamp.value());
+        }
+        else {
+            db_manager->bindNull(1);
+        }
+        return db_manager->executePrepared();
+    }
+
+    //user credited with the events the triggers record, 0 for the system
+    bool setActingUser(int user_id)
+    {
+        db_manager->prepareStatement("UPDATE MovementContext SET context_user = ?;");
+        db_manager->bindParameter<int>(1, user_id);
+        return db_manager->executePrepared();
+    }
+
+    /// <summary>
+    /// appends one event that no table write records, such as an imported history. timestamps
+    /// never run backwards in the ledger, an earlier one is recorded at the time of the previous
+    /// event so id order is also time order
+    /// </summary>
+    bool append(const Movement& movement)
+    {
+        db_manager->prepareStatement(
+            "INSERT INTO Movements (movement_timestamp, movement_kind, movement_element, movement_from, movement_to, "
+            "movement_owner, movement_key, movement_quantity, movement_user) VALUES (max(?, " + latest_timestamp + "), ?, ?, ?, ?, ?, ?, ?, ?);");
+        db_manager->bindParameter<int>(1, movement.timestamp);
+        db_manager->bindParameter<int>(2, static_cast<int>(movement.kind));
+        db_manager->bindParameter<std::string>(3, movement.element_guid);
+        bindOptionalText(4, movement.previous_parent);
+        bindOptionalText(5, movement.parent);
+        db_manager->bindParameter<int>(6, movement.owner);
+        bindOptionalText(7, movement.stock_key.empty() ? std::nullopt : std::optional<std::string>(movement.stock_key));
+        db_manager->bindParameter<double>(8, movement.quantity);
+        db_manager->bindParameter<int>(9, movement.user);
+
+        if (!db_manager->executePrepared()) {
+            std::cerr << "Error in MovementLedger::append" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    //writes the cached state as of the last applied movement
+    bool takeSnapshot()
+    {
+        db_manager->prepareStatement(
+            "INSERT OR REPLACE INTO MovementSnapshots (snapshot_movement, snapshot_timestamp, snapshot_state) VALUES (?, ?, ?);");
+        db_manager->bindParameter<long long>(1, last_applied);
+        db_manager->bindParameter<int>(2, last_timestamp);
+        db_manager->bindParameter<std::vector<unsigned char>>(3, current.serialize());
+
+        if (!db_manager->executePrepared()) {
+            std::cerr << "Error in MovementLedger::takeSnapshot" << std::endl;
+            return false;
+        }
+        since_snapshot = 0;
+        return true;
+    }
+
+    // Queries --------------------------------------------------------------------------------------------
+
+    const InventoryState& currentState()
+    {
+        refresh();
+        return current;
+    }
+
+    /// <summary>
+    /// state after every movement recorded at or before the timestamp, replayed from the
+    /// latest snapshot taken no later than it
+    /// </summary>
+    std::optional<InventoryState> stateAt(int timestamp)
+    {
+        if (!refresh()) {
+            return std::nullopt;
+        }
+
+        InventoryState state;
+        long long replay_from = 0;
+
+        db_manager->prepareStatement(
+            "SELECT snapshot_movement, snapshot_state FROM MovementSnapshots "
+            "WHERE snapshot_timestamp <= ? ORDER BY snapshot_movement DESC LIMIT 1;");
+        db_manager->bindParameter<int>(1, timestamp);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+        if (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            replay_from = sqlite3_column_int64(prepared_statement, 0);
+            auto snapshot = InventoryState::deserialize(
+                static_cast<const uint8_t*>(sqlite3_column_blob(prepared_statement, 1)),
+                static_cast<size_t>(sqlite3_column_bytes(prepared_statement, 1)));
+            if (!snapshot.has_value()) {
+                sqlite3_finalize(prepared_statement);
+                std::cerr << "Error in MovementLedger: snapshot at movement " << replay_from << " is corrupt" << std::endl;
+                return std::nullopt;
+            }
+            state = std::move(snapshot.value());
+        }
+        sqlite3_finalize(prepared_statement);
+
+        bool replayed = forEachMovement(
+            "SELECT " + movement_columns + " FROM Movements WHERE movement_id > ? AND movement_timestamp <= ? ORDER BY movement_id;",
+            replay_from, timestamp, [&](const Movement& movement) { state.apply(movement); });
+        if (!replayed) {
+            return std::nullopt;
+        }
+        return state;
+    }
+
+    //elements directly inside the location at the given time
+    std::vector<std::string> contentsAt(const std::string& location_guid, int timestamp)
+    {
+        std::optional<InventoryState> state = stateAt(timestamp);
+        return state.has_value() ? state->contentsOf(location_guid) : std::vector<std::string>();
+    }
+
+    //every event of one element, oldest first
+    std::vector<Movement> retrieveHistory(const std::string& element_guid)
+    {
+        std::vector<Movement> history;
+        db_manager->prepareStatement("SELECT " + movement_columns + " FROM Movements WHERE movement_element = ? ORDER BY movement_id;");
+        db_manager->bindParameter<std::string>(1, element_guid);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            history.push_back(readMovement(prepared_statement));
+        }
+        sqlite3_finalize(prepared_statement);
+        return history;
+    }
+
+private:
+
+    //the last event's time, so triggers and append keep timestamps from running backwards
+    inline static const std::string latest_timestamp =
+        "coalesce((SELECT movement_timestamp FROM Movements ORDER BY movement_id DESC LIMIT 1), 0)";
+
+    //INSERT of one event from a trigger, the arguments are SQL expressions over new and old
+    static std::string recordMovement(MovementKind kind, const std::string& element, const std::string& from, const std::string& to,
+        const std::string& owner, const std::string& stock_key, const std::string& quantity)
+    {
+        return "INSERT INTO Movements (movement_timestamp, movement_kind, movement_element, movement_from, movement_to, "
+            "movement_owner, movement_key, movement_quantity, movement_user) VALUES ("
+            "max(coalesce((SELECT context_timestamp FROM MovementContext), CAST(strftime('%s', 'now') AS INTEGER)), " + latest_timestamp + "), " +
+            std::to_string(static_cast<int>(kind)) + ", " + element + ", " + from + ", " + to + ", " + owner + ", " + stock_key + ", " + quantity + ", "
+            "coalesce((SELECT context_user FROM MovementContext), 0));";
+    }
+
+    void bindOptionalText(int bind_index, const std::optional<std::string>& value)
+    {
+        if (value.has_value()) {
+            db_manager->bindParameter<std::string>(bind_index, value.value());
+        }
+        else {
+            db_manager->bindNull(bind_index);
+        }
+    }
+
+    static std::optional<std::string> columnText(sqlite3_stmt* row, int column)
+    {
+        const unsigned char* value = sqlite3_column_text(row, column);
+        if (value == nullptr) {
+            return std::nullopt;
+        }
+        return std::string(reinterpret_cast<const char*>(value));
+    }
+
+    static Movement readMovement(sqlite3_stmt* row)
+    {
+        Movement movement;
+        movement.movement_id = sqlite3_column_int64(row, 0);
+        movement.timestamp = sqlite3_column_int(row, 1);
+        movement.kind = static_cast<MovementKind>(sqlite3_column_int(row, 2));
+        movement.element_guid = columnText(row, 3).value_or("");
+        movement.previous_parent = columnText(row, 4);
+        movement.parent = columnText(row, 5);
+        movement.owner = sqlite3_column_int(row, 6);
+        movement.stock_key = columnText(row, 7).value_or("");
+        movement.quantity = sqlite3_column_double(row, 8);
+        movement.user = sqlite3_column_int(row, 9);
+        return movement;
+    }
+
+    template <typename Visitor>
+    bool forEachMovement(const std::string& sql, long long after_id, int timestamp, Visitor visit)
+    {
+        if (!db_manager->prepareStatement(sql)) {
+            return false;
+        }
+        db_manager->bindParameter<long long>(1, after_id);
+        db_manager->bindParameter<int>(2, timestamp);
+        sqlite3_stmt* prepared_statement = db_manager->getPreparedStatement();
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            visit(readMovement(prepared_statement));
+        }
+        sqlite3_finalize(prepared_statement);
+        return true;
+    }
+
+    inline static const std::string movement_columns =
+        "movement_id, movement_timestamp, movement_kind, movement_element, movement_from, movement_to, "
+        "movement_owner, movement_key, movement_quantity, movement_user";
+
+    DatabaseManager* db_manager;
+    size_t snapshot_interval;
+
+    InventoryState current;
+    long long last_applied = 0;
+    int last_timestamp = 0;
+    size_t since_snapshot = 0;
+};
+
+#endif //MOVEMENTLEDGER_HPP
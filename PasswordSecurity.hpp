@@ -26,8 +26,10 @@ public:
             "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
             "abcdefghijklmnopqrstuvwxyz";
 
+        //seeding from random_device is far more expensive than drawing, so each thread seeds once
+        thread_local std::mt19937 generator(std::random_device{}());
+
         std::string salt;
-        std::mt19937 generator(std::random_device{}());
         std::uniform_int_distribution<size_t> distribution(0, strlen(alphanum) - 1);
 
         for (size_t i = 0; i < length; ++i){salt += alphanum[distribution(generator)];}
@@ -0,0 +1,1517 @@
+#ifndef RUNTIME_HPP
+#define RUNTIME_HPP
+
+#include "UserDAO.hpp"
+#include "GenericDAO.hpp"
+#include "DatabaseManager.hpp"
+#include "ThreadPool.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <queue>
+#include <array>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <optional>
+#include <functional>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <sddl.h>
+#pragma comment(lib, "advapi32.lib")
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/// <summary>
+/// hierarchical timer wheel of four levels of 64 one-tick slots, covering 64^4 ticks. a timer
+/// lands in the lowest level whose span reaches its deadline and drops a level each time the
+/// level below it wraps, so scheduling is O(1) and advancing touches only the slots that come due
+/// </summary>
+class TimerWheel {
+public:
+
+    explicit TimerWheel(int64_t start_tick = 0) : current_tick(start_tick) {}
+
+    //a deadline already passed fires on the next advance
+    void schedule(const std::string& key, int64_t deadline)
+    {
+        place({ key, deadline < current_tick + 1 ? current_tick + 1 : deadline });
+    }
+
+    /// <summary>
+    /// moves the wheel forward to tick and returns the keys of every timer that came due
+    /// </summary>
+    std::vector<std::string> advance(int64_t tick)
+    {
+        std::vector<std::string> due;
+        while (current_tick < tick)
+        {
+            ++current_tick;
+
+            //higher levels cascade down first when every level below them has wrapped
+            for (size_t level = levels - 1; level > 0; --level) {
+                if ((current_tick & ((int64_t(1) << (slot_bits * level)) - 1)) == 0) {
+                    std::vector<Timer> cascading = std::move(slots[level][slotOf(current_tick, level)]);
+                    slots[level][slotOf(current_tick, level)].clear();
+                    for (Timer& timer : cascading) {
+                        place(std::move(timer));
+                    }
+                }
+            }
+
+            std::vector<Timer>& expiring = slots[0][slotOf(current_tick, 0)];
+            for (Timer& timer : expiring) {
+                due.push_back(std::move(timer.key));
+            }
+            expiring.clear();
+        }
+        return due;
+    }
+
+    int64_t tick() const
+    {
+        return current_tick;
+    }
+
+private:
+
+    static constexpr size_t levels = 4;
+    static constexpr int slot_bits = 6;
+    static constexpr size_t slot_count = size_t(1) << slot_bits;
+
+    struct Timer
+    {
+        std::string key;
+        int64_t deadline;
+    };
+
+    static size_t slotOf(int64_t tick, size_t level)
+    {
+        return static_cast<size_t>((tick >> (slot_bits * level)) & (slot_count - 1));
+    }
+
+    void place(Timer timer)
+    {
+        if (timer.deadline <= current_tick) {
+            timer.deadline = current_tick + 1;
+        }
+
+        //timers beyond the top level's reach wait in its furthest slot and are placed again later
+        const int64_t delta = timer.deadline - current_tick;
+        size_t level = 0;
+        while (level < levels - 1 && delta >= (int64_t(1) << (slot_bits * (level + 1)))) {
+            ++level;
+        }
+        int64_t slot_tick = timer.deadline;
+        if (level == levels - 1 && delta >= (int64_t(1) << (slot_bits * levels))) {
+            slot_tick = current_tick + (int64_t(1) << (slot_bits * levels)) - 1;
+        }
+        slots[level][slotOf(slot_tick, level)].push_back(std::move(timer));
+    }
+
+    int64_t current_tick;
+    std::array<std::array<std::vector<Timer>, slot_count>, levels> slots;
+};
+
+/// <summary>
+/// what a session may do, one bit per capability. commands declare the bits they need as a
+/// constexpr mask and each session caches the mask of its role, so authorizing a command is
+/// one AND against the session with no database read
+/// </summary>
+struct Capabilities
+{
+    static constexpr uint32_t NONE = 0;
+    static constexpr uint32_t VIEW_ELEMENTS = 1u << 0;
+    static constexpr uint32_t EDIT_OWN_ELEMENTS = 1u << 1;
+    static constexpr uint32_t TRANSFER_OWN_ELEMENTS = 1u << 2;
+    static constexpr uint32_t VIEW_USERS = 1u << 3;
+    static constexpr uint32_t EDIT_ALL_ELEMENTS = 1u << 4;
+    static constexpr uint32_t MANAGE_CATEGORIES = 1u << 5;
+    static constexpr uint32_t VIEW_LOGINS = 1u << 6;
+    static constexpr uint32_t TRANSFER_ANY_ELEMENT = 1u << 7;
+    static constexpr uint32_t DELETE_ELEMENTS = 1u << 8;
+    static constexpr uint32_t MANAGE_USERS = 1u << 9;
+    static constexpr uint32_t IMPORT_USERS = 1u << 10;
+
+    //roles from Schemas.md: super(visor) edits data along with admin, admin holds everything
+    static constexpr uint32_t BASE_ROLE = VIEW_ELEMENTS | EDIT_OWN_ELEMENTS | TRANSFER_OWN_ELEMENTS | VIEW_USERS;
+    static constexpr uint32_t SUPER_ROLE = BASE_ROLE | EDIT_ALL_ELEMENTS | MANAGE_CATEGORIES | VIEW_LOGINS;
+    static constexpr uint32_t ADMIN_ROLE = SUPER_ROLE | TRANSFER_ANY_ELEMENT | DELETE_ELEMENTS | MANAGE_USERS | IMPORT_USERS;
+
+    static constexpr uint32_t ofPermission(UserDAO::UserPermission permission)
+    {
+        switch (permission) {
+        case UserDAO::UserPermission::BASE:
+            return BASE_ROLE;
+        case UserDAO::UserPermission::SUPER:
+            return SUPER_ROLE;
+        case UserDAO::UserPermission::ADMIN:
+            return ADMIN_ROLE;
+        default:
+            return NONE;
+        }
+    }
+
+    static constexpr bool grants(uint32_t held, uint32_t required)
+    {
+        return (held & required) == required;
+    }
+};
+
+static_assert(Capabilities::grants(Capabilities::SUPER_ROLE, Capabilities::BASE_ROLE)
+    && Capabilities::grants(Capabilities::ADMIN_ROLE, Capabilities::SUPER_ROLE), "every role includes the role below it");
+
+/// <summary>
+/// read only view of a whole file mapped into memory, empty when the file cannot be opened
+/// </summary>
+class MappedFile {
+public:
+
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_handle == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+            return;
+        }
+        mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_handle == nullptr) {
+            return;
+        }
+        data = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+        length = data ? static_cast<size_t>(file_size.QuadPart) : 0;
+#else
+        file_descriptor = open(path.c_str(), O_RDONLY);
+        if (file_descriptor < 0) {
+            return;
+        }
+        struct stat file_status;
+        if (fstat(file_descriptor, &file_status) != 0 || file_status.st_size == 0) {
+            return;
+        }
+        void* mapped = mmap(nullptr, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        if (mapped != MAP_FAILED) {
+            data = static_cast<const uint8_t*>(mapped);
+            length = static_cast<size_t>(file_status.st_size);
+        }
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (data != nullptr) {
+            UnmapViewOfFile(data);
+        }
+        if (mapping_handle != nullptr) {
+            CloseHandle(mapping_handle);
+        }
+        if (file_handle != INVALID_HANDLE_VALUE) {
+            CloseHandle(file_handle);
+        }
+#else
+        if (data != nullptr) {
+            munmap(const_cast<uint8_t*>(data), length);
+        }
+        if (file_descriptor >= 0) {
+            close(file_descriptor);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* begin() const
+    {
+        return data;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file_handle = INVALID_HANDLE_VALUE;
+    HANDLE mapping_handle = nullptr;
+#else
+    int file_descriptor = -1;
+#endif
+};
+
+/// <summary>
+/// logged in users keyed by an opaque random token. sessions live in a fixed number of shards,
+/// each a hash map behind its own shared_mutex, so the per command lookup takes one shared lock
+/// on one shard and threads checking different sessions rarely meet. idle sessions are expired
+/// through a TimerWheel rather than by scanning every session: a lookup only records the time,
+/// and a timer that fires on a session used since is moved to its new idle deadline.
+/// live sessions can be written to a snapshot file and restored after a restart. as a
+/// RecordObserver of UserDAO it applies permission changes to open sessions once they have committed
+/// </summary>
+class SessionManager : public RecordObserver {
+public:
+
+    struct SessionInfo
+    {
+        int user_id;
+        UserDAO::UserPermission permission;
+        uint32_t capabilities;
+    };
+
+    SessionManager(std::chrono::seconds _idle_timeout = std::chrono::minutes(30), size_t shard_count = 16)
+        : idle_timeout(_idle_timeout.count()),
+        clock([] { return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count()); })
+    {
+        if (idle_timeout <= 0) {
+            throw std::invalid_argument("SessionManager: idle timeout must be positive");
+        }
+        shards.reserve(shard_count == 0 ? 1 : shard_count);
+        for (size_t i = 0; i < shards.capacity(); ++i) {
+            shards.push_back(std::make_unique<Shard>());
+        }
+        expiry_wheel = TimerWheel(clock());
+    }
+
+    ~SessionManager()
+    {
+        stopMaintenance();
+    }
+
+    SessionManager(const SessionManager&) = delete;
+    SessionManager& operator=(const SessionManager&) = delete;
+
+    //time source in seconds, set before any session is created
+    void setClock(std::function<int64_t()> _clock)
+    {
+        clock = std::move(_clock);
+        std::lock_guard<std::mutex> lock(wheel_mutex);
+        expiry_wheel = TimerWheel(clock());
+    }
+
+    /// <summary>
+    /// opens a session after a successful login
+    /// </summary>
+    /// <returns>the token, empty for a locked account</returns>
+    std::string createSession(int user_id, UserDAO::UserPermission permission)
+    {
+        if (permission == UserDAO::UserPermission::LOCK) {
+            std::cerr << "Error in createSession: user " << user_id << " is locked" << std::endl;
+            return "";
+        }
+
+        const int64_t now = clock();
+        std::string token;
+        bool inserted = false;
+        while (!inserted) {
+            token = generateToken();
+            Shard& shard = shardOf(token);
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            auto emplaced = shard.sessions.try_emplace(token);
+            if (emplaced.second) {
+                emplaced.first->second.user_id = user_id;
+                emplaced.first->second.permission = permission;
+                emplaced.first->second.capabilities = Capabilities::ofPermission(permission);
+                emplaced.first->second.last_active.store(now, std::memory_order_relaxed);
+                inserted = true;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(wheel_mutex);
+        expiry_wheel.schedule(token, now + idle_timeout);
+        return token;
+    }
+
+    /// <summary>
+    /// the user behind a live token, refreshing its idle deadline. safe to call from any thread
+    /// </summary>
+    std::optional<SessionInfo> validate(const std::string& token)
+    {
+        const int64_t now = clock();
+        Shard& shard = shardOf(token);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+        auto session = shard.sessions.find(token);
+        if (session == shard.sessions.end()
+            || session->second.last_active.load(std::memory_order_relaxed) + idle_timeout <= now) {
+            return std::nullopt;
+        }
+        session->second.last_active.store(now, std::memory_order_relaxed);
+        return SessionInfo{ session->second.user_id, session->second.permission, session->second.capabilities };
+    }
+
+    /// <summary>
+    /// true when the token belongs to a live session holding every capability in required
+    /// </summary>
+    bool authorize(const std::string& token, uint32_t required)
+    {
+        std::optional<SessionInfo> session = validate(token);
+        return session.has_value() && Capabilities::grants(session->capabilities, required);
+    }
+
+    //applies a changed role to every open session of the user, a locked user is logged out
+    size_t updateUserPermission(int user_id, UserDAO::UserPermission permission)
+    {
+        if (permission == UserDAO::UserPermission::LOCK) {
+            return endUserSessions(user_id);
+        }
+
+        size_t updated = 0;
+        for (auto& shard : shards) {
+            std::unique_lock<std::shared_mutex> lock(shard->mutex);
+            for (auto& session : shard->sessions) {
+                if (session.second.user_id == user_id) {
+                    session.second.permission = permission;
+                    session.second.capabilities = Capabilities::ofPermission(permission);
+                    ++updated;
+                }
+            }
+        }
+        return updated;
+    }
+
+    //logout, the pending timer is dropped when it fires
+    bool endSession(const std::string& token)
+    {
+        Shard& shard = shardOf(token);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        return shard.sessions.erase(token) > 0;
+    }
+
+    //every session of one user, such as after a lock or a password change
+    size_t endUserSessions(int user_id)
+    {
+        size_t ended = 0;
+        for (auto& shard : shards) {
+            std::unique_lock<std::shared_mutex> lock(shard->mutex);
+            for (auto session = shard->sessions.begin(); session != shard->sessions.end();) {
+                if (session->second.user_id == user_id) {
+                    session = shard->sessions.erase(session);
+                    ++ended;
+                }
+                else {
+                    ++session;
+                }
+            }
+        }
+        return ended;
+    }
+
+    /// <summary>
+    /// removes sessions idle for longer than the timeout, looking only at those whose timers came due
+    /// </summary>
+    /// <returns>number of sessions expired</returns>
+    size_t collectExpired()
+    {
+        const int64_t now = clock();
+        std::lock_guard<std::mutex> wheel_lock(wheel_mutex);
+
+        size_t expired = 0;
+        for (const std::string& token : expiry_wheel.advance(now)) {
+            Shard& shard = shardOf(token);
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            auto session = shard.sessions.find(token);
+            if (session == shard.sessions.end()) {
+                continue;
+            }
+
+            const int64_t deadline = session->second.last_active.load(std::memory_order_relaxed) + idle_timeout;
+            if (deadline <= now) {
+                shard.sessions.erase(session);
+                ++expired;
+            }
+            else {
+                expiry_wheel.schedule(token, deadline);
+            }
+        }
+        return expired;
+    }
+
+    size_t size() const
+    {
+        size_t count = 0;
+        for (const auto& shard : shards) {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            count += shard->sessions.size();
+        }
+        return count;
+    }
+
+    // Permission Changes ---------------------------------------------------------------------------------
+
+    //updates carry the whole user row, hiding a user ends their sessions like a lock does
+    void onRecordUpdated(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name != "Users" || !record.contains("user_id")) {
+            return;
+        }
+
+        const int user_id = record["user_id"].get<int>();
+        if (record.contains("user_visibility") && record["user_visibility"].get<int>() == 0) {
+            endUserSessions(user_id);
+        }
+        else if (record.contains("user_permission")) {
+            const int permission = record["user_permission"].get<int>();
+            updateUserPermission(user_id, permission >= 0 && permission <= static_cast<int>(UserDAO::UserPermission::ADMIN)
+                ? static_cast<UserDAO::UserPermission>(permission) : UserDAO::UserPermission::LOCK);
+        }
+    }
+
+    void onRecordDeleted(const std::string& table_name, const nlohmann::json& record) override
+    {
+        if (table_name == "Users" && record.contains("user_id")) {
+            endUserSessions(record["user_id"].get<int>());
+        }
+    }
+
+    // Maintenance ----------------------------------------------------------------------------------------
+
+    //snapshot written by the maintenance thread every interval and once more when it stops
+    void setSnapshotFile(const std::string& path, std::chrono::seconds interval = std::chrono::seconds(60))
+    {
+        snapshot_path = path;
+        snapshot_interval = interval;
+    }
+
+    //background thread collecting expired sessions every interval until stopMaintenance
+    void startMaintenance(std::chrono::milliseconds interval = std::chrono::seconds(1))
+    {
+        stopMaintenance();
+        maintenance_stopping = false;
+        maintenance_thread = std::thread([this, interval] {
+            auto next_snapshot = std::chrono::steady_clock::now() + snapshot_interval;
+            std::unique_lock<std::mutex> lock(maintenance_mutex);
+            while (!maintenance_condition.wait_for(lock, interval, [this] { return maintenance_stopping; })) {
+                lock.unlock();
+                collectExpired();
+                if (!snapshot_path.empty() && std::chrono::steady_clock::now() >= next_snapshot) {
+                    saveSnapshot(snapshot_path);
+                    next_snapshot = std::chrono::steady_clock::now() + snapshot_interval;
+                }
+                lock.lock();
+            }
+        });
+    }
+
+    void stopMaintenance()
+    {
+        if (!maintenance_thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(maintenance_mutex);
+            maintenance_stopping = true;
+        }
+        maintenance_condition.notify_all();
+        maintenance_thread.join();
+
+        if (!snapshot_path.empty()) {
+            saveSnapshot(snapshot_path);
+        }
+    }
+
+    // Snapshots ------------------------------------------------------------------------------------------
+
+    /// <summary>
+    /// writes every live session to path through a temporary file renamed over it, so a crash
+    /// mid write leaves the previous snapshot intact. the file is a 32 byte header of magic,
+    /// version, record count, wall clock write time and a CRC-32, then one 32 byte record per
+    /// session of raw token, user id, permission and seconds idle
+    /// </summary>
+    bool saveSnapshot(const std::string& path)
+    {
+        const int64_t now = clock();
+        std::vector<uint8_t> file(snapshot_header_size, 0);
+        uint32_t count = 0;
+
+        for (const auto& shard : shards) {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            for (const auto& session : shard->sessions) {
+                const int64_t idle = now - session.second.last_active.load(std::memory_order_relaxed);
+                if (idle >= idle_timeout || session.first.size() != 2 * snapshot_token_size) {
+                    continue;
+                }
+
+                uint8_t record[snapshot_record_size] = {};
+                if (!decodeToken(session.first, record)) {
+                    continue;
+                }
+                const int32_t user_id = session.second.user_id;
+                std::memcpy(record + 16, &user_id, sizeof(user_id));
+                record[20] = static_cast<uint8_t>(session.second.permission);
+                std::memcpy(record + 24, &idle, sizeof(idle));
+                file.insert(file.end(), record, record + snapshot_record_size);
+                ++count;
+            }
+        }
+
+        const uint32_t version = snapshot_version;
+        const int64_t written_at = wallClock();
+        std::memcpy(file.data(), snapshot_magic, 4);
+        std::memcpy(file.data() + 4, &version, sizeof(version));
+        std::memcpy(file.data() + 8, &count, sizeof(count));
+        std::memcpy(file.data() + 16, &written_at, sizeof(written_at));
+        const uint32_t checksum = snapshotChecksum(file.data(), file.size());
+        std::memcpy(file.data() + 24, &checksum, sizeof(checksum));
+
+        //live tokens are credentials, the file is readable by its owner only from the moment it exists
+        const std::string temporary_path = path + ".tmp";
+        std::error_code error;
+        std::filesystem::remove(temporary_path, error);
+        if (!writeOwnerOnly(temporary_path, file.data(), file.size())) {
+            std::cerr << "Error in saveSnapshot: cannot write " << temporary_path << std::endl;
+            std::filesystem::remove(temporary_path, error);
+            return false;
+        }
+
+        std::filesystem::rename(temporary_path, path, error);
+        if (error) {
+            std::cerr << "Error in saveSnapshot: " << error.message() << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// restores the sessions of a snapshot, counting the time the process was down as idle time.
+    /// a file with the wrong magic, version, length or checksum is refused as a whole. users may
+    /// have been demoted, locked, hidden or deleted while the process was down, so each session
+    /// takes its user's current permission from Users and is dropped when that user is no longer active
+    /// </summary>
+    /// <returns>number of sessions restored, nullopt when the file is missing or invalid</returns>
+    std::optional<size_t> loadSnapshot(const std::string& path, DatabaseManager& db_manager)
+    {
+        MappedFile file(path);
+        if (file.begin() == nullptr) {
+            return std::nullopt;
+        }
+
+        const uint8_t* data = file.begin();
+        uint32_t version = 0;
+        uint32_t count = 0;
+        int64_t written_at = 0;
+        uint32_t checksum = 0;
+        if (file.size() < snapshot_header_size || std::memcmp(data, snapshot_magic, 4) != 0) {
+            std::cerr << "Error in loadSnapshot: " << path << " is not a session snapshot" << std::endl;
+            return std::nullopt;
+        }
+        std::memcpy(&version, data + 4, sizeof(version));
+        std::memcpy(&count, data + 8, sizeof(count));
+        std::memcpy(&written_at, data + 16, sizeof(written_at));
+        std::memcpy(&checksum, data + 24, sizeof(checksum));
+
+        if (version != snapshot_version) {
+            std::cerr << "Error in loadSnapshot: unsupported version " << version << std::endl;
+            return std::nullopt;
+        }
+        if (file.size() != snapshot_header_size + static_cast<size_t>(count) * snapshot_record_size
+            || snapshotChecksum(data, file.size()) != checksum) {
+            std::cerr << "Error in loadSnapshot: " << path << " is truncated or corrupt" << std::endl;
+            return std::nullopt;
+        }
+
+        std::unordered_map<int, int> active_users;
+        if (!db_manager.prepareStatement("SELECT user_id, user_permission FROM Users WHERE user_visibility = 1 AND user_permission > 0;")) {
+            std::cerr << "Error in loadSnapshot: cannot read Users" << std::endl;
+            return std::nullopt;
+        }
+        sqlite3_stmt* prepared_statement = db_manager.getPreparedStatement();
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+            active_users.emplace(sqlite3_column_int(prepared_statement, 0), sqlite3_column_int(prepared_statement, 1));
+        }
+        sqlite3_finalize(prepared_statement);
+
+        const int64_t now = clock();
+        const int64_t downtime = std::max<int64_t>(0, wallClock() - written_at);
+        size_t restored = 0;
+
+        std::lock_guard<std::mutex> wheel_lock(wheel_mutex);
+        for (uint32_t index = 0; index < count; ++index) {
+            const uint8_t* record = data + snapshot_header_size + static_cast<size_t>(index) * snapshot_record_size;
+            int32_t user_id;
+            int64_t idle;
+            std::memcpy(&user_id, record + 16, sizeof(user_id));
+            std::memcpy(&idle, record + 24, sizeof(idle));
+            idle += downtime;
+            auto user = active_users.find(user_id);
+            if (idle >= idle_timeout || user == active_users.end() || user->second > static_cast<int>(UserDAO::UserPermission::ADMIN)) {
+                continue;
+            }
+
+            const std::string token = encodeToken(record);
+            Shard& shard = shardOf(token);
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            auto emplaced = shard.sessions.try_emplace(token);
+            if (!emplaced.second) {
+                continue;
+            }
+            emplaced.first->second.user_id = user_id;
+            emplaced.first->second.permission = static_cast<UserDAO::UserPermission>(user->second);
+            emplaced.first->second.capabilities = Capabilities::ofPermission(emplaced.first->second.permission);
+            emplaced.first->second.last_active.store(now - idle, std::memory_order_relaxed);
+            expiry_wheel.schedule(token, now - idle + idle_timeout);
+            ++restored;
+        }
+        return restored;
+    }
+
+private:
+
+    struct Session
+    {
+        int user_id = 0;
+        UserDAO::UserPermission permission = UserDAO::UserPermission::BASE;
+        uint32_t capabilities = Capabilities::NONE;
+        std::atomic<int64_t> last_active{ 0 };
+    };
+
+    struct Shard
+    {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, Session> sessions;
+    };
+
+    //128 bits from the operating system's generator as 32 hex characters
+    static std::string generateToken()
+    {
+        static const char* hex = "0123456789abcdef";
+        thread_local std::random_device device;
+
+        std::string token;
+        token.reserve(32);
+        for (int word = 0; word < 4; ++word) {
+            uint32_t bits = device();
+            for (int nibble = 0; nibble < 8; ++nibble) {
+                token += hex[bits & 0xF];
+                bits >>= 4;
+            }
+        }
+        return token;
+    }
+
+    static constexpr const char* snapshot_magic = "SESS";
+    static constexpr uint32_t snapshot_version = 1;
+    static constexpr size_t snapshot_header_size = 32;
+    static constexpr size_t snapshot_record_size = 32;
+    static constexpr size_t snapshot_token_size = 16;
+
+    //created with owner only access, never widened afterwards, fails when path already exists
+    static bool writeOwnerOnly(const std::string& path, const uint8_t* bytes, size_t length)
+    {
+#ifdef _WIN32
+        PSECURITY_DESCRIPTOR descriptor = nullptr;
+        if (!ConvertStringSecurityDescriptorToSecurityDescriptorA("D:P(A;;FA;;;OW)", SDDL_REVISION_1, &descriptor, nullptr)) {
+            return false;
+        }
+        SECURITY_ATTRIBUTES attributes{ sizeof(SECURITY_ATTRIBUTES), descriptor, FALSE };
+        HANDLE file_handle = CreateFileA(path.c_str(), GENERIC_WRITE, 0, &attributes, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LocalFree(descriptor);
+        if (file_handle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        bool written = true;
+        while (written && length > 0) {
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(length, 1u << 30));
+            DWORD wrote = 0;
+            written = WriteFile(file_handle, bytes, chunk, &wrote, nullptr) && wrote > 0;
+            bytes += wrote;
+            length -= wrote;
+        }
+        return CloseHandle(file_handle) && written;
+#else
+        const int file_descriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+        if (file_descriptor < 0) {
+            return false;
+        }
+        bool written = true;
+        while (written && length > 0) {
+            const ssize_t wrote = write(file_descriptor, bytes, length);
+            written = wrote > 0;
+            if (written) {
+                bytes += wrote;
+                length -= static_cast<size_t>(wrote);
+            }
+        }
+        return close(file_descriptor) == 0 && written;
+#endif
+    }
+
+    static int64_t wallClock()
+    {
+        return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    //hex pairs to the 16 raw bytes at the start of a record
+    static bool decodeToken(const std::string& token, uint8_t* bytes)
+    {
+        auto nibble = [](char character) -> int {
+            if (character >= '0' && character <= '9') return character - '0';
+            if (character >= 'a' && character <= 'f') return character - 'a' + 10;
+            return -1;
+        };
+        for (size_t index = 0; index < snapshot_token_size; ++index) {
+            int high = nibble(token[2 * index]);
+            int low = nibble(token[2 * index + 1]);
+            if (high < 0 || low < 0) {
+                return false;
+            }
+            bytes[index] = static_cast<uint8_t>(high << 4 | low);
+        }
+        return true;
+    }
+
+    static std::string encodeToken(const uint8_t* bytes)
+    {
+        static const char* hex = "0123456789abcdef";
+        std::string token;
+        token.reserve(2 * snapshot_token_size);
+        for (size_t index = 0; index < snapshot_token_size; ++index) {
+            token += hex[bytes[index] >> 4];
+            token += hex[bytes[index] & 0xF];
+        }
+        return token;
+    }
+
+    //CRC-32 of the header without its checksum field followed by every record
+    static uint32_t snapshotChecksum(const uint8_t* data, size_t length)
+    {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> entries{};
+            for (uint32_t index = 0; index < 256; ++index) {
+                uint32_t value = index;
+                for (int bit = 0; bit < 8; ++bit) {
+                    value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+                }
+                entries[index] = value;
+            }
+            return entries;
+        }();
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t index = 0; index < length; ++index) {
+            if (index >= 24 && index < snapshot_header_size) {
+                continue;
+            }
+            crc = table[(crc ^ data[index]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    //tokens are already uniformly random, the shard is picked with the standard hash only so
+    //that arbitrary strings handed to validate are spread as well
+    Shard& shardOf(const std::string& token) const
+    {
+        return *shards[std::hash<std::string>{}(token) % shards.size()];
+    }
+
+    int64_t idle_timeout;
+    std::function<int64_t()> clock;
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    std::mutex wheel_mutex;
+    TimerWheel expiry_wheel;
+
+    std::string snapshot_path;
+    std::chrono::seconds snapshot_interval{ 60 };
+
+    std::thread maintenance_thread;
+    std::mutex maintenance_mutex;
+    std::condition_variable maintenance_condition;
+    bool maintenance_stopping = false;
+};
+
+/// <summary>
+/// threads that each own one connection to the database and take tasks from a shared queue.
+/// DatabaseManager keeps a single prepared statement per connection, so a connection is never
+/// shared between threads. one connection makes a writer queue that serializes every write,
+/// several make a reader pool. the writer switches the database to WAL so readers are not
+/// blocked by a write in progress. observers are registered on every connection, so each DAO
+/// a task builds on it reports its writes to them
+/// </summary>
+class DatabaseExecutor {
+public:
+
+    DatabaseExecutor(const std::string& database_path, size_t connection_count, bool writer, std::vector<RecordObserver*> observers = {})
+    {
+        if (connection_count == 0) {
+            throw std::invalid_argument("DatabaseExecutor: at least one connection is required");
+        }
+        for (size_t i = 0; i < connection_count; ++i) {
+            threads.emplace_back([this, database_path, writer, observers] {
+                DatabaseManager connection(database_path);
+                for (RecordObserver* observer : observers) {
+                    connection.addRecordObserver(observer);
+                }
+                connection.tryExecuteQuery("PRAGMA busy_timeout = 5000;");
+                if (writer) {
+                    connection.tryExecuteQuery("PRAGMA journal_mode = WAL;");
+                }
+                connectionLoop(connection);
+            });
+        }
+    }
+
+    //finishes every queued task before closing the connections
+    ~DatabaseExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        queue_condition.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    DatabaseExecutor(const DatabaseExecutor&) = delete;
+    DatabaseExecutor& operator=(const DatabaseExecutor&) = delete;
+
+    void post(std::function<void(DatabaseManager&)> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            tasks.push(std::move(task));
+        }
+        queue_condition.notify_one();
+    }
+
+    template <typename F>
+    std::future<std::invoke_result_t<F, DatabaseManager&>> submit(F&& task)
+    {
+        using Result = std::invoke_result_t<F, DatabaseManager&>;
+
+        auto promise = std::make_shared<std::promise<Result>>();
+        std::future<Result> result = promise->get_future();
+        post([promise, task = std::forward<F>(task)](DatabaseManager& connection) mutable {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    task(connection);
+                    promise->set_value();
+                }
+                else {
+                    promise->set_value(task(connection));
+                }
+            }
+            catch (...) {
+                promise->set_exception(std::current_exception());
+            }
+        });
+        return result;
+    }
+
+    size_t size() const
+    {
+        return threads.size();
+    }
+
+private:
+
+    void connectionLoop(DatabaseManager& connection)
+    {
+        while (true)
+        {
+            std::function<void(DatabaseManager&)> task;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task(connection);
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::queue<std::function<void(DatabaseManager&)>> tasks;
+    std::mutex queue_mutex;
+    std::condition_variable queue_condition;
+    bool stopping = false;
+};
+
+//words of one line as views into the line, a fixed array so tokenizing never allocates
+struct TokenList
+{
+    static constexpr size_t capacity = 16;
+
+    std::array<std::string_view, capacity> words{};
+    size_t count = 0;
+    bool overflow = false;
+
+    std::string_view operator[](size_t index) const
+    {
+        return words[index];
+    }
+
+    //bounds checked like std::vector::at, for handlers reading their arguments
+    std::string_view at(size_t index) const
+    {
+        if (index >= count) {
+            throw std::out_of_range("TokenList: no word " + std::to_string(index));
+        }
+        return words[index];
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+};
+
+/// <summary>
+/// splits a line into words without allocating. words are separated by whitespace, double
+/// quotes group words and "" inside quotes is a quote. the words are views into the line,
+/// which is rewritten in place where "" collapses to one quote
+/// </summary>
+inline TokenList tokenizeInPlace(char* text, size_t length)
+{
+    TokenList tokens;
+    size_t read = 0;
+    while (read < length)
+    {
+        char character = text[read];
+        if (character == ' ' || character == '\t' || character == '\r' || character == '\n') {
+            ++read;
+            continue;
+        }
+
+        size_t start = read;
+        size_t write = read;
+        bool quoted = false;
+        while (read < length)
+        {
+            character = text[read];
+            if (quoted) {
+                if (character == '"' && read + 1 < length && text[read + 1] == '"') {
+                    text[write++] = '"';
+                    read += 2;
+                }
+                else if (character == '"') {
+                    quoted = false;
+                    ++read;
+                }
+                else {
+                    text[write++] = text[read++];
+                }
+            }
+            else if (character == '"') {
+                quoted = true;
+                ++read;
+            }
+            else if (character == ' ' || character == '\t' || character == '\r' || character == '\n') {
+                break;
+            }
+            else {
+                text[write++] = text[read++];
+            }
+        }
+
+        if (tokens.count == TokenList::capacity) {
+            tokens.overflow = true;
+            break;
+        }
+        tokens.words[tokens.count++] = std::string_view(text + start, write - start);
+    }
+    return tokens;
+}
+
+inline TokenList tokenizeInPlace(std::string& line)
+{
+    return tokenizeInPlace(line.data(), line.size());
+}
+
+/// <summary>
+/// runs commands as a pipeline of tasks instead of inline. a command line is tokenized in place
+/// and authorized against its session on the dispatch stage, then its handler runs where its
+/// workload belongs: reads on the reader pool, writes on the single writer queue and cpu bound
+/// work such as hashing and reports on the compute pool. every stage counts what went through
+/// it, how long tasks waited in its queue and how long they ran. the session manager observes
+/// every connection, so a handler demoting, hiding or locking a user through its own UserDAO
+/// changes that user's open sessions at once
+/// </summary>
+class ApplicationController {
+public:
+
+    enum class Workload
+    {
+        READ,
+        WRITE,
+        COMPUTE
+    };
+
+    enum class Stage
+    {
+        DISPATCH,
+        READ,
+        WRITE,
+        COMPUTE
+    };
+
+    struct CommandContext
+    {
+        const SessionManager::SessionInfo& session;
+        //views into the request's own line, valid while the handler runs
+        const TokenList& arguments;
+        //the stage's own connection, null on the compute stage
+        DatabaseManager* database;
+    };
+
+    struct CommandResult
+    {
+        bool success = false;
+        nlohmann::json output;
+        std::string error;
+        //time spent in the handler, zero when the command was refused before it ran
+        double elapsed_us = 0.0;
+    };
+
+    using CommandHandler = std::function<CommandResult(CommandContext&)>;
+
+    //checks the words of a line before its handler runs, returning the error or nothing
+    using ArgumentCheck = std::function<std::optional<std::string>(const TokenList&)>;
+
+    //position of a command word's route as returned by registerCommand, nothing for an unknown word
+    using CommandLookup = std::function<std::optional<size_t>(std::string_view)>;
+
+    struct StageMetrics
+    {
+        Stage stage;
+        size_t submitted = 0;
+        size_t completed = 0;
+        size_t failed = 0;
+        size_t queued = 0;
+        size_t max_queued = 0;
+        double average_wait_us = 0.0;
+        double average_run_us = 0.0;
+    };
+
+    ApplicationController(SessionManager& _sessions, const std::string& database_path,
+        size_t reader_count = 4, size_t compute_count = std::thread::hardware_concurrency())
+        : sessions(&_sessions), writer(database_path, 1, true, { &_sessions }), readers(database_path, reader_count, false, { &_sessions }),
+        compute(compute_count) {}
+
+    //stages hand requests to each other and suspended coroutines hop between the executors, so
+    //every stage and every awaitable is drained before any executor stops
+    ~ApplicationController()
+    {
+        while (true) {
+            bool idle = pending_awaits.load() == 0;
+            for (const StageCounters& counters : stage_counters) {
+                idle = idle && counters.completed.load() == counters.submitted.load();
+            }
+            if (idle) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    ApplicationController(const ApplicationController&) = delete;
+    ApplicationController& operator=(const ApplicationController&) = delete;
+
+    /// <summary>
+    /// registered before commands are executed, the routes are read without locking afterwards.
+    /// registering a name again replaces its route
+    /// </summary>
+    /// <returns>the position of the route, for a CommandLookup</returns>
+    size_t registerCommand(const std::string& name, uint32_t required_capabilities, Workload workload, CommandHandler handler,
+        ArgumentCheck check = nullptr)
+    {
+        auto named = std::lower_bound(by_name.begin(), by_name.end(), std::string_view(name),
+            [this](size_t index, std::string_view word) { return routes[index].name < word; });
+        if (named != by_name.end() && routes[*named].name == name) {
+            routes[*named] = { name, required_capabilities, workload, std::move(handler), std::move(check) };
+            return *named;
+        }
+        routes.push_back({ name, required_capabilities, workload, std::move(handler), std::move(check) });
+        by_name.insert(named, routes.size() - 1);
+        return routes.size() - 1;
+    }
+
+    //resolves command words through lookup before the registered names, see CommandTableView::install
+    void setCommandLookup(CommandLookup lookup)
+    {
+        command_lookup = std::move(lookup);
+    }
+
+    /// <summary>
+    /// queues one command line on behalf of the session holding token
+    /// </summary>
+    /// <returns>future completed once the command has run or been refused</returns>
+    std::future<CommandResult> execute(const std::string& token, std::string line)
+    {
+        auto request = std::make_shared<Request>();
+        request->token = token;
+        request->line = std::move(line);
+        std::future<CommandResult> result = request->promise.get_future();
+
+        runStage(Stage::DISPATCH, [this](std::function<void(DatabaseManager*)> body) {
+            compute.post([body = std::move(body)] { body(nullptr); });
+        }, [this, request](DatabaseManager*) { dispatch(request); });
+
+        return result;
+    }
+
+    /// <summary>
+    /// queues consecutive write commands as one transaction on the writer. each command runs
+    /// inside its own savepoint, so a failing command is undone alone and the rest commit
+    /// together. the group goes straight to the writer queue, groups queued one after another
+    /// from the same thread run in that order. the write stage counts the group as one task
+    /// </summary>
+    /// <returns>one future per line, completed once the transaction has committed or failed</returns>
+    std::vector<std::future<CommandResult>> executeTransaction(const std::string& token, const std::vector<std::string>& lines)
+    {
+        std::vector<std::shared_ptr<Request>> requests;
+        std::vector<std::future<CommandResult>> results;
+        for (const std::string& line : lines) {
+            auto request = std::make_shared<Request>();
+            request->token = token;
+            request->line = line;
+            results.push_back(request->promise.get_future());
+            requests.push_back(std::move(request));
+        }
+
+        runStage(Stage::WRITE, [this](std::function<void(DatabaseManager*)> stage_body) {
+            writer.post([stage_body = std::move(stage_body)](DatabaseManager& connection) { stage_body(&connection); });
+        }, [this, requests](DatabaseManager* connection) { runTransaction(requests, *connection); });
+
+        return results;
+    }
+
+    //where a registered command runs, empty for an unknown name
+    std::optional<Workload> workloadOf(std::string_view name) const
+    {
+        const Route* route = findRoute(name);
+        if (route == nullptr) {
+            return std::nullopt;
+        }
+        return route->workload;
+    }
+
+    //executors shared with coroutine based business logic, see AsyncDAO
+    DatabaseExecutor& readerPool()
+    {
+        return readers;
+    }
+
+    DatabaseExecutor& writerQueue()
+    {
+        return writer;
+    }
+
+    ThreadPool& computePool()
+    {
+        return compute;
+    }
+
+    //awaitables suspended on the executors above, counted until the coroutine they resume suspends again or ends
+    std::atomic<size_t>& pendingAwaits()
+    {
+        return pending_awaits;
+    }
+
+    std::vector<StageMetrics> metrics() const
+    {
+        std::vector<StageMetrics> snapshot;
+        for (size_t index = 0; index < stage_count; ++index) {
+            const StageCounters& counters = stage_counters[index];
+            StageMetrics stage;
+            stage.stage = static_cast<Stage>(index);
+            stage.submitted = counters.submitted.load();
+            stage.completed = counters.completed.load();
+            stage.failed = counters.failed.load();
+            size_t started = counters.started.load();
+            stage.queued = stage.submitted > started ? stage.submitted - started : 0;
+            stage.max_queued = counters.max_queued.load();
+            if (started > 0) {
+                stage.average_wait_us = counters.wait_ns.load() / 1000.0 / started;
+            }
+            if (stage.completed > 0) {
+                stage.average_run_us = counters.run_ns.load() / 1000.0 / stage.completed;
+            }
+            snapshot.push_back(stage);
+        }
+        return snapshot;
+    }
+
+    static const char* stageName(Stage stage)
+    {
+        switch (stage) {
+        case Stage::DISPATCH: return "dispatch";
+        case Stage::READ: return "read";
+        case Stage::WRITE: return "write";
+        case Stage::COMPUTE: return "compute";
+        }
+        return "";
+    }
+
+private:
+
+    static constexpr size_t stage_count = 4;
+
+    struct Route
+    {
+        std::string name;
+        uint32_t required_capabilities;
+        Workload workload;
+        CommandHandler handler;
+        ArgumentCheck check;
+    };
+
+    struct Request
+    {
+        std::string token;
+        std::string line;
+        TokenList words;
+        SessionManager::SessionInfo session{};
+        const Route* route = nullptr;
+        std::promise<CommandResult> promise;
+    };
+
+    struct StageCounters
+    {
+        std::atomic<size_t> submitted{ 0 };
+        std::atomic<size_t> started{ 0 };
+        std::atomic<size_t> completed{ 0 };
+        std::atomic<size_t> failed{ 0 };
+        std::atomic<size_t> max_queued{ 0 };
+        std::atomic<uint64_t> wait_ns{ 0 };
+        std::atomic<uint64_t> run_ns{ 0 };
+    };
+
+    static CommandResult failure(const std::string& error)
+    {
+        CommandResult result;
+        result.error = error;
+        return result;
+    }
+
+    //hands body to the stage's executor, timing the wait in its queue and the run
+    template <typename Post>
+    void runStage(Stage stage, Post post, std::function<void(DatabaseManager*)> body)
+    {
+        StageCounters& counters = stage_counters[static_cast<size_t>(stage)];
+        size_t queued = counters.submitted.fetch_add(1) + 1 - counters.started.load();
+        size_t max_queued = counters.max_queued.load();
+        while (queued > max_queued && !counters.max_queued.compare_exchange_weak(max_queued, queued)) {}
+
+        auto enqueued = std::chrono::steady_clock::now();
+        post([&counters, enqueued, body = std::move(body)](DatabaseManager* connection) {
+            auto started = std::chrono::steady_clock::now();
+            counters.started.fetch_add(1);
+            counters.wait_ns.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(started - enqueued).count()));
+            body(connection);
+            counters.run_ns.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count()));
+            counters.completed.fetch_add(1);
+        });
+    }
+
+    //the command lookup first when one is set, then a binary search of the registered names
+    const Route* findRoute(std::string_view name) const
+    {
+        if (command_lookup) {
+            std::optional<size_t> index = command_lookup(name);
+            if (index.has_value() && index.value() < routes.size()) {
+                return &routes[index.value()];
+            }
+        }
+        auto named = std::lower_bound(by_name.begin(), by_name.end(), name,
+            [this](size_t index, std::string_view word) { return routes[index].name < word; });
+        return named != by_name.end() && routes[*named].name == name ? &routes[*named] : nullptr;
+    }
+
+    //tokenizes the request's line in place, looks up the route, authorizes the session and checks
+    //the arguments, refusing on stage when any step fails
+    bool resolve(const std::shared_ptr<Request>& request, Stage stage)
+    {
+        request->words = tokenizeInPlace(request->line);
+        if (request->words.size() == 0) {
+            refuse(request, stage, "empty command");
+            return false;
+        }
+        if (request->words.overflow) {
+            refuse(request, stage, "too many words " + std::string(request->words[0]));
+            return false;
+        }
+
+        const Route* route = findRoute(request->words[0]);
+        if (route == nullptr) {
+            refuse(request, stage, "unknown command " + std::string(request->words[0]));
+            return false;
+        }
+
+        std::optional<SessionManager::SessionInfo> session = sessions->validate(request->token);
+        if (!session.has_value()) {
+            refuse(request, stage, "session expired or unknown");
+            return false;
+        }
+        if (!Capabilities::grants(session->capabilities, route->required_capabilities)) {
+            refuse(request, stage, "not permitted to run " + route->name);
+            return false;
+        }
+        if (route->check) {
+            std::optional<std::string> error = route->check(request->words);
+            if (error.has_value()) {
+                refuse(request, stage, error.value());
+                return false;
+            }
+        }
+        request->session = session.value();
+        request->route = route;
+        return true;
+    }
+
+    void dispatch(const std::shared_ptr<Request>& request)
+    {
+        if (!resolve(request, Stage::DISPATCH)) {
+            return;
+        }
+
+        auto body = [this, request](DatabaseManager* connection) { run(request, connection); };
+        switch (request->route->workload) {
+        case Workload::READ:
+            runStage(Stage::READ, [this](std::function<void(DatabaseManager*)> stage_body) {
+                readers.post([stage_body = std::move(stage_body)](DatabaseManager& connection) { stage_body(&connection); });
+            }, body);
+            break;
+        case Workload::WRITE:
+            runStage(Stage::WRITE, [this](std::function<void(DatabaseManager*)> stage_body) {
+                writer.post([stage_body = std::move(stage_body)](DatabaseManager& connection) { stage_body(&connection); });
+            }, body);
+            break;
+        case Workload::COMPUTE:
+            runStage(Stage::COMPUTE, [this](std::function<void(DatabaseManager*)> stage_body) {
+                compute.post([stage_body = std::move(stage_body)] { stage_body(nullptr); });
+            }, body);
+            break;
+        }
+    }
+
+    CommandResult invoke(const std::shared_ptr<Request>& request, DatabaseManager* connection)
+    {
+        const Stage stage = static_cast<Stage>(static_cast<size_t>(request->route->workload) + 1);
+        CommandContext context{ request->session, request->words, connection };
+        CommandResult result;
+        auto started = std::chrono::steady_clock::now();
+        try {
+            result = request->route->handler(context);
+        }
+        catch (const std::exception& error) {
+            result = failure(error.what());
+        }
+        result.elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+
+        if (!result.success) {
+            stage_counters[static_cast<size_t>(stage)].failed.fetch_add(1);
+        }
+        return result;
+    }
+
+    void run(const std::shared_ptr<Request>& request, DatabaseManager* connection)
+    {
+        request->promise.set_value(invoke(request, connection));
+    }
+
+    //refused commands are answered at once, the others only after the outcome of the commit is known
+    void runTransaction(const std::vector<std::shared_ptr<Request>>& requests, DatabaseManager& connection)
+    {
+        if (!connection.beginImmediateTransaction()) {
+            for (const std::shared_ptr<Request>& request : requests) {
+                refuse(request, Stage::WRITE, "could not begin transaction");
+            }
+            return;
+        }
+
+        std::vector<std::pair<std::shared_ptr<Request>, CommandResult>> ran;
+        for (const std::shared_ptr<Request>& request : requests) {
+            if (!resolve(request, Stage::WRITE)) {
+                continue;
+            }
+            if (request->route->workload != Workload::WRITE) {
+                refuse(request, Stage::WRITE, request->route->name + " is not a write command");
+                continue;
+            }
+            if (!connection.beginTransaction()) {
+                refuse(request, Stage::WRITE, "could not open savepoint");
+                continue;
+            }
+
+            CommandResult result = invoke(request, &connection);
+            if (!result.success) {
+                connection.rollbackTransaction();
+            }
+            else if (!connection.commitTransaction()) {
+                connection.rollbackTransaction();
+                stage_counters[static_cast<size_t>(Stage::WRITE)].failed.fetch_add(1);
+                result = failure("could not release savepoint");
+            }
+            ran.emplace_back(request, std::move(result));
+        }
+
+        if (!connection.commitTransaction()) {
+            connection.rollbackTransaction();
+            for (auto& [request, result] : ran) {
+                if (result.success) {
+                    stage_counters[static_cast<size_t>(Stage::WRITE)].failed.fetch_add(1);
+                    result = failure("transaction rolled back");
+                }
+            }
+        }
+        for (auto& [request, result] : ran) {
+            request->promise.set_value(std::move(result));
+        }
+    }
+
+    void refuse(const std::shared_ptr<Request>& request, Stage stage, const std::string& error)
+    {
+        stage_counters[static_cast<size_t>(stage)].failed.fetch_add(1);
+        request->promise.set_value(failure(error));
+    }
+
+    SessionManager* sessions;
+    std::vector<Route> routes;
+    //positions in routes ordered by name
+    std::vector<size_t> by_name;
+    CommandLookup command_lookup;
+    std::array<StageCounters, stage_count> stage_counters;
+    std::atomic<size_t> pending_awaits{ 0 };
+
+    //declared last so their threads stop before anything above is destroyed
+    DatabaseExecutor writer;
+    DatabaseExecutor readers;
+    ThreadPool compute;
+};
+
+#endif //RUNTIME_HPP
@@ -0,0 +1,179 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <type_traits>
+
+/// <summary>
+/// fixed set of worker threads for cpu bound work such as salting and hashing that should not
+/// run on the database thread. every worker owns a deque: tasks submitted from a worker go to
+/// the back of its own deque and are taken back LIFO while they are still in cache, tasks from
+/// outside are dealt round robin, and a worker that runs dry steals from the front of the others
+/// so one long running burst does not leave the rest of the pool idle
+/// </summary>
+class ThreadPool {
+public:
+
+    explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency())
+    {
+        if (thread_count == 0) {
+            thread_count = 1;
+        }
+
+        for (size_t i = 0; i < thread_count; ++i) {
+            queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    //finishes every queued task before joining
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        sleep_condition.notify_all();
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// <summary>
+    /// queues a callable for execution on a worker
+    /// </summary>
+    /// <returns>future holding the result or the exception thrown by the task</returns>
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& task)
+    {
+        using Result = std::invoke_result_t<F>;
+
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        post([packaged] { (*packaged)(); });
+        return result;
+    }
+
+    //fire and forget, the task is responsible for reporting its own outcome
+    void post(std::function<void()> task)
+    {
+        //counted before it is visible so a worker never sees a task it cannot account for
+        pending.fetch_add(1, std::memory_order_acq_rel);
+
+        size_t target = (current_pool == this)
+            ? current_worker
+            : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+
+        //under the lock the wake up is ordered after a worker's check of pending, and the
+        //destructor cannot tear the condition down while it is being signalled
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        sleep_condition.notify_one();
+    }
+
+    size_t size() const
+    {
+        return workers.size();
+    }
+
+    //tasks submitted and not yet started
+    size_t pendingTasks() const
+    {
+        return pending.load(std::memory_order_acquire);
+    }
+
+    //tasks a worker took from another worker's deque
+    size_t stolenTasks() const
+    {
+        return stolen.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool popLocal(size_t index, std::function<void()>& task)
+    {
+        WorkerQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t index, std::function<void()>& task)
+    {
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkerQueue& victim = *queues[(index + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                stolen.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index)
+    {
+        current_pool = this;
+        current_worker = index;
+
+        while (true)
+        {
+            std::function<void()> task;
+            if (popLocal(index, task) || steal(index, task)) {
+                pending.fetch_sub(1, std::memory_order_acq_rel);
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleep_condition.wait(lock, [this] { return stopping || pending.load(std::memory_order_acquire) > 0; });
+            if (stopping && pending.load(std::memory_order_acquire) == 0) {
+                return;
+            }
+        }
+    }
+
+    inline static thread_local ThreadPool* current_pool = nullptr;
+    inline static thread_local size_t current_worker = 0;
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<size_t> next_queue{ 0 };
+    std::atomic<size_t> pending{ 0 };
+    std::atomic<size_t> stolen{ 0 };
+
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_condition;
+    bool stopping = false;
+};
+
+#endif //THREADPOOL_HPP
@@ -0,0 +1,553 @@
+#ifndef THUMBNAILSERVICE_HPP
+#define THUMBNAILSERVICE_HPP
+
+#include <string>
+#include <vector>
+#include <list>
+#include <queue>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <optional>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <iostream>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <stdexcept>
+
+/// <summary>
+/// decoded image, 8 bit RGB rows top to bottom
+/// </summary>
+struct Image
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+
+    size_t bytes() const
+    {
+        return pixels.size();
+    }
+};
+
+/// <summary>
+/// turns an image file into pixels. decoders are tried in the order they were added and the
+/// first that accepts the file wins, so a decoder backed by an image library goes in front of
+/// the built in PPM one
+/// </summary>
+class ImageDecoder {
+public:
+
+    virtual ~ImageDecoder() = default;
+
+    //empty when the file is not in a format this decoder reads
+    virtual std::optional<Image> decode(const std::string& path) = 0;
+};
+
+/// <summary>
+/// binary PPM (P6) with a maximum value of 255, the format the thumbnail disk cache is kept in
+/// </summary>
+class PpmDecoder : public ImageDecoder {
+public:
+
+    std::optional<Image> decode(const std::string& path) override
+    {
+        std::ifstream input(path, std::ios::binary);
+        std::string comment;
+        return read(input, comment);
+    }
+
+    //comment is the first # line of the header, the disk cache keeps the source path there
+    static std::optional<Image> read(std::istream& input, std::string& comment)
+    {
+        char magic[2] = {};
+        if (!input.read(magic, 2) || magic[0] != 'P' || magic[1] != '6') {
+            return std::nullopt;
+        }
+
+        uint32_t fields[3] = {};
+        for (uint32_t& field : fields) {
+            int character = input.get();
+            while (character == ' ' || character == '\t' || character == '\r' || character == '\n' || character == '#') {
+                if (character == '#') {
+                    std::string line;
+                    std::getline(input, line);
+                    if (comment.empty()) {
+                        comment = line.size() > 0 && line[0] == ' ' ? line.substr(1) : line;
+                    }
+                }
+                character = input.get();
+            }
+            input.unget();
+            if (!(input >> field)) {
+                return std::nullopt;
+            }
+        }
+        input.get();
+
+        const uint32_t max_edge = 1u << 15;
+        if (fields[0] == 0 || fields[1] == 0 || fields[0] > max_edge || fields[1] > max_edge || fields[2] != 255) {
+            return std::nullopt;
+        }
+
+        Image image;
+        image.width = fields[0];
+        image.height = fields[1];
+        image.pixels.resize(static_cast<size_t>(image.width) * image.height * 3);
+        if (!input.read(reinterpret_cast<char*>(image.pixels.data()), static_cast<std::streamsize>(image.pixels.size()))) {
+            return std::nullopt;
+        }
+        return image;
+    }
+
+    static bool write(std::ostream& output, const Image& image, const std::string& comment)
+    {
+        output << "P6\n# " << comment << "\n" << image.width << " " << image.height << "\n255\n";
+        output.write(reinterpret_cast<const char*>(image.pixels.data()), static_cast<std::streamsize>(image.pixels.size()));
+        return static_cast<bool>(output);
+    }
+};
+
+/// <summary>
+/// thumbnails for element_thumbpath images, decoded off the GUI thread. a request first
+/// checks a memory LRU bounded by bytes, and a miss is queued for the decode workers, which
+/// look in a disk cache of already downscaled copies before decoding the original. a disk
+/// cache entry is named after the source path, its modification time and the thumbnail size,
+/// so an edited image is decoded again and stale entries are simply never read. requests
+/// carry a priority and rows on screen are decoded before the ones scrolled past, the GUI
+/// calls setVisible as the list scrolls. the ready callback runs on a worker thread
+/// </summary>
+class ThumbnailService {
+public:
+
+    enum class Priority
+    {
+        VISIBLE,
+        NEARBY,
+        BACKGROUND
+    };
+
+    struct Statistics
+    {
+        size_t memory_hits = 0;
+        size_t disk_hits = 0;
+        size_t decodes = 0;
+        size_t failures = 0;
+        size_t cached_thumbnails = 0;
+        size_t cached_bytes = 0;
+    };
+
+    using ThumbnailPtr = std::shared_ptr<const Image>;
+    using Ready = std::function<void(const std::string& path, bool decoded)>;
+
+    ThumbnailService(const std::string& _cache_directory, uint32_t _max_edge = 128, size_t _memory_budget = 64u << 20, size_t decode_threads = 2)
+        : cache_directory(_cache_directory), max_edge(_max_edge == 0 ? 1 : _max_edge), memory_budget(_memory_budget)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(cache_directory, error);
+        if (error) {
+            throw std::runtime_error("cannot create thumbnail cache " + cache_directory + ": " + error.message());
+        }
+
+        if (decode_threads == 0) {
+            decode_threads = 1;
+        }
+        for (size_t i = 0; i < decode_threads; ++i) {
+            workers.emplace_back([this] { decodeLoop(); });
+        }
+    }
+
+    //pending requests are dropped, a thumbnail is only worth decoding while someone waits for it
+    ~ThumbnailService()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        queue_condition.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThumbnailService(const ThumbnailService&) = delete;
+    ThumbnailService& operator=(const ThumbnailService&) = delete;
+
+    //decoders added before the first request, ahead of the PPM fallback
+    void addDecoder(std::unique_ptr<ImageDecoder> decoder)
+    {
+        decoders.insert(decoders.end() - 1, std::move(decoder));
+    }
+
+    //set before the first request
+    void setReadyCallback(Ready callback)
+    {
+        ready = std::move(callback);
+    }
+
+    /// <summary>
+    /// the thumbnail when it is in memory, otherwise null and the path is queued for decoding
+    /// at priority, or moved up to it when already queued lower. a path that failed to decode
+    /// is not queued again until it is invalidated
+    /// </summary>
+    ThumbnailPtr get(const std::string& path, Priority priority = Priority::VISIBLE)
+    {
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            auto cached = thumbnails.find(path);
+            if (cached != thumbnails.end()) {
+                recency.splice(recency.begin(), recency, cached->second.position);
+                ++memory_hits;
+                return cached->second.thumbnail;
+            }
+            if (failed.count(path) > 0) {
+                return nullptr;
+            }
+        }
+
+        enqueue(path, priority);
+        return nullptr;
+    }
+
+    /// <summary>
+    /// paths on screen now. queued requests for them move to VISIBLE and every other queued
+    /// request drops to BACKGROUND, so a fast scroll does not leave the workers decoding rows
+    /// that went by
+    /// </summary>
+    void setVisible(const std::vector<std::string>& paths)
+    {
+        std::unordered_set<std::string> visible(paths.begin(), paths.end());
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            for (auto& [path, priority] : pending) {
+                priority = visible.count(path) > 0 ? Priority::VISIBLE : Priority::BACKGROUND;
+            }
+            rebuildQueue();
+        }
+        for (const std::string& path : paths) {
+            get(path, Priority::VISIBLE);
+        }
+    }
+
+    //forgets the thumbnail of path, for when the image or the element's thumbpath changed
+    void invalidate(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        failed.erase(path);
+        auto cached = thumbnails.find(path);
+        if (cached != thumbnails.end()) {
+            cached_bytes -= cached->second.thumbnail->bytes();
+            recency.erase(cached->second.position);
+            thumbnails.erase(cached);
+        }
+    }
+
+    //requests not yet started
+    size_t pendingRequests() const
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return pending.size();
+    }
+
+    Statistics statistics() const
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        Statistics snapshot;
+        snapshot.memory_hits = memory_hits;
+        snapshot.disk_hits = disk_hits;
+        snapshot.decodes = decodes;
+        snapshot.failures = failures;
+        snapshot.cached_thumbnails = thumbnails.size();
+        snapshot.cached_bytes = cached_bytes;
+        return snapshot;
+    }
+
+    /// <summary>
+    /// box filtered copy of image whose longer edge is at most max_edge, smaller images are
+    /// returned as they are
+    /// </summary>
+    static Image downscale(const Image& image, uint32_t max_edge)
+    {
+        if (image.width <= max_edge && image.height <= max_edge) {
+            return image;
+        }
+
+        Image scaled;
+        if (image.width >= image.height) {
+            scaled.width = max_edge;
+            scaled.height = std::max<uint32_t>(1, static_cast<uint32_t>(static_cast<uint64_t>(image.height) * max_edge / image.width));
+        }
+        else {
+            scaled.height = max_edge;
+            scaled.width = std::max<uint32_t>(1, static_cast<uint32_t>(static_cast<uint64_t>(image.width) * max_edge / image.height));
+        }
+        scaled.pixels.resize(static_cast<size_t>(scaled.width) * scaled.height * 3);
+
+        //every target pixel averages the block of source pixels it covers
+        for (uint32_t y = 0; y < scaled.height; ++y) {
+            uint32_t top = static_cast<uint32_t>(static_cast<uint64_t>(y) * image.height / scaled.height);
+            uint32_t bottom = std::max(top + 1, static_cast<uint32_t>(static_cast<uint64_t>(y + 1) * image.height / scaled.height));
+            for (uint32_t x = 0; x < scaled.width; ++x) {
+                uint32_t left = static_cast<uint32_t>(static_cast<uint64_t>(x) * image.width / scaled.width);
+                uint32_t right = std::max(left + 1, static_cast<uint32_t>(static_cast<uint64_t>(x + 1) * image.width / scaled.width));
+
+                uint64_t sums[3] = {};
+                for (uint32_t source_y = top; source_y < bottom; ++source_y) {
+                    const uint8_t* row = &image.pixels[(static_cast<size_t>(source_y) * image.width + left) * 3];
+                    for (uint32_t source_x = left; source_x < right; ++source_x, row += 3) {
+                        sums[0] += row[0];
+                        sums[1] += row[1];
+                        sums[2] += row[2];
+                    }
+                }
+                uint64_t count = static_cast<uint64_t>(bottom - top) * (right - left);
+                uint8_t* target = &scaled.pixels[(static_cast<size_t>(y) * scaled.width + x) * 3];
+                for (int channel = 0; channel < 3; ++channel) {
+                    target[channel] = static_cast<uint8_t>((sums[channel] + count / 2) / count);
+                }
+            }
+        }
+        return scaled;
+    }
+
+private:
+
+    struct QueuedRequest
+    {
+        Priority priority;
+        uint64_t sequence;
+        std::string path;
+
+        //lower priority value first, then first come first served
+        bool operator<(const QueuedRequest& other) const
+        {
+            if (priority != other.priority) {
+                return priority > other.priority;
+            }
+            return sequence > other.sequence;
+        }
+    };
+
+    struct CachedThumbnail
+    {
+        ThumbnailPtr thumbnail;
+        std::list<std::string>::iterator position;
+    };
+
+    void enqueue(const std::string& path, Priority priority)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (decoding.count(path) > 0) {
+                return;
+            }
+            auto queued = pending.find(path);
+            if (queued != pending.end()) {
+                if (priority >= queued->second) {
+                    return;
+                }
+                queued->second = priority;
+            }
+            else {
+                pending.emplace(path, priority);
+            }
+            //an entry left behind at the old priority is skipped when it comes up
+            queue.push({ priority, next_sequence++, path });
+        }
+        queue_condition.notify_one();
+    }
+
+    //queue_mutex held
+    void rebuildQueue()
+    {
+        std::priority_queue<QueuedRequest> rebuilt;
+        std::unordered_set<std::string> added;
+        while (!queue.empty()) {
+            QueuedRequest request = queue.top();
+            queue.pop();
+            auto queued = pending.find(request.path);
+            if (queued != pending.end() && added.insert(request.path).second) {
+                request.priority = queued->second;
+                rebuilt.push(std::move(request));
+            }
+        }
+        queue = std::move(rebuilt);
+    }
+
+    void decodeLoop()
+    {
+        while (true)
+        {
+            std::string path;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_condition.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (stopping) {
+                    return;
+                }
+                QueuedRequest request = queue.top();
+                queue.pop();
+                auto queued = pending.find(request.path);
+                if (queued == pending.end() || queued->second != request.priority) {
+                    continue;
+                }
+                pending.erase(queued);
+                path = std::move(request.path);
+                decoding.insert(path);
+            }
+
+            bool from_disk = false;
+            std::optional<Image> thumbnail = load(path, from_disk);
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                if (thumbnail.has_value()) {
+                    (from_disk ? disk_hits : decodes) += 1;
+                    store(path, std::make_shared<const Image>(std::move(thumbnail.value())));
+                }
+                else {
+                    ++failures;
+                    failed.insert(path);
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                decoding.erase(path);
+            }
+            if (ready) {
+                ready(path, thumbnail.has_value());
+            }
+        }
+    }
+
+    //disk cache first, then the decoders, writing what they produce back to the disk cache
+    std::optional<Image> load(const std::string& path, bool& from_disk)
+    {
+        std::error_code error;
+        auto modified = std::filesystem::last_write_time(path, error);
+        if (error) {
+            return std::nullopt;
+        }
+        std::filesystem::path cached_path = cachePath(path, static_cast<long long>(modified.time_since_epoch().count()));
+
+        {
+            std::ifstream cached(cached_path, std::ios::binary);
+            std::string source;
+            std::optional<Image> image = cached ? PpmDecoder::read(cached, source) : std::nullopt;
+            if (image.has_value() && source == path) {
+                from_disk = true;
+                return image;
+            }
+        }
+
+        std::optional<Image> decoded;
+        for (const std::unique_ptr<ImageDecoder>& decoder : decoders) {
+            decoded = decoder->decode(path);
+            if (decoded.has_value()) {
+                break;
+            }
+        }
+        if (!decoded.has_value()) {
+            return std::nullopt;
+        }
+
+        Image scaled = downscale(decoded.value(), max_edge);
+
+        //written beside and renamed over so a reader never sees half a file
+        std::filesystem::path temporary = cached_path;
+        temporary += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+            if (!PpmDecoder::write(output, scaled, path)) {
+                std::cerr << "Error in ThumbnailService: cannot write " << temporary.string() << std::endl;
+            }
+        }
+        std::filesystem::rename(temporary, cached_path, error);
+        if (error) {
+            std::filesystem::remove(temporary, error);
+        }
+        return scaled;
+    }
+
+    //FNV-1a over the source path, its modification time and the thumbnail size
+    std::filesystem::path cachePath(const std::string& path, long long modified) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const void* data, size_t length) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            for (size_t i = 0; i < length; ++i) {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+        };
+        mix(path.data(), path.size());
+        mix(&modified, sizeof(modified));
+        mix(&max_edge, sizeof(max_edge));
+
+        char name[24];
+        std::snprintf(name, sizeof(name), "%016llx.ppm", static_cast<unsigned long long>(hash));
+        return std::filesystem::path(cache_directory) / name;
+    }
+
+    //cache_mutex held, least recently used thumbnails go first once over budget
+    void store(const std::string& path, ThumbnailPtr thumbnail)
+    {
+        auto existing = thumbnails.find(path);
+        if (existing != thumbnails.end()) {
+            cached_bytes -= existing->second.thumbnail->bytes();
+            recency.erase(existing->second.position);
+            thumbnails.erase(existing);
+        }
+
+        cached_bytes += thumbnail->bytes();
+        recency.push_front(path);
+        thumbnails[path] = { std::move(thumbnail), recency.begin() };
+
+        while (cached_bytes > memory_budget && recency.size() > 1) {
+            auto evicted = thumbnails.find(recency.back());
+            cached_bytes -= evicted->second.thumbnail->bytes();
+            thumbnails.erase(evicted);
+            recency.pop_back();
+        }
+    }
+
+    std::string cache_directory;
+    uint32_t max_edge;
+    size_t memory_budget;
+    Ready ready;
+    std::vector<std::unique_ptr<ImageDecoder>> decoders = [] {
+        std::vector<std::unique_ptr<ImageDecoder>> fallback;
+        fallback.push_back(std::make_unique<PpmDecoder>());
+        return fallback;
+    }();
+
+    mutable std::mutex cache_mutex;
+    std::unordered_map<std::string, CachedThumbnail> thumbnails;
+    std::list<std::string> recency;
+    std::unordered_set<std::string> failed;
+    size_t cached_bytes = 0;
+    size_t memory_hits = 0;
+    size_t disk_hits = 0;
+    size_t decodes = 0;
+    size_t failures = 0;
+
+    mutable std::mutex queue_mutex;
+    std::condition_variable queue_condition;
+    std::priority_queue<QueuedRequest> queue;
+    //the priority each queued path currently holds
+    std::unordered_map<std::string, Priority> pending;
+    //taken by a worker, a request for one of these waits for its ready callback instead
+    std::unordered_set<std::string> decoding;
+    uint64_t next_sequence = 0;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+};
+
+#endif //THUMBNAILSERVICE_HPP
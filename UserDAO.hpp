@@ -53,6 +53,11 @@ public:
             return false;
         }
 
+        if (!observers.empty()) {
+            nlohmann::json inserted = json_data;
+            inserted["user_id"] = getIdGivenUsername(json_data["user_name"].get<std::string>()).value_or(0);
+            notifyInserted("Users", inserted);
+        }
         return true;
     }
 
@@ -83,6 +88,7 @@ public:
             db_manager->getParameter<int>(10, json_result, "user_timestamp", prepared_statement);
         }
 
+        sqlite3_finalize(prepared_statement);
         return json_result;
     }
 
@@ -154,6 +160,7 @@ public:
             return false;
         }
 
+        notifyUserUpdated(id);
         return true;
     }
 
@@ -169,6 +176,7 @@ public:
             return false;
         }
         std::cout << "Users table is append only. User has been set to invisible." << std::endl;
+        notifyUserUpdated(id);
         return true;
     }
 
@@ -197,6 +205,19 @@ public:
         return std::nullopt;
     }
 
+private:
+
+    //observers receive the whole row after a change, keyed by user_id
+    void notifyUserUpdated(int id)
+    {
+        if (observers.empty()) {
+            return;
+        }
+        nlohmann::json record = retrieveRecordById(id);
+        record["user_id"] = id;
+        notifyUpdated("Users", record);
+    }
+
     
 };
 
@@ -0,0 +1,385 @@
+#ifndef USERINTERFACE_HPP
+#define USERINTERFACE_HPP
+
+#include "sqlite3.h"
+#include "DatabaseManager.hpp"
+#include "Runtime.hpp"
+#include "nlohmann\\json.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <optional>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+/// <summary>
+/// row source for a virtual list control such as a wxListCtrl with wxLC_VIRTUAL: the control
+/// asks for rows by index and only the pages around what is on screen are ever read.
+/// pages are read with keyset pagination, WHERE key > last key of the previous page
+/// ORDER BY key LIMIT page size, so reading page 10,000 costs the same as reading page 1 and
+/// rows written meanwhile shift the list instead of duplicating or skipping rows at page edges.
+/// when opened the first page is read at once while a second connection scans the key column
+/// for the row count and the last key of every page, after which any page can be jumped to.
+/// reads run on background connections; a fetch whose page scrolled out of the wanted window
+/// before it started is dropped, and pages far from the visible window are evicted first.
+/// the callbacks run on a background thread, a GUI marshals them to its own thread, with
+/// wxWidgets through CallAfter
+/// </summary>
+class PagedListModel {
+public:
+
+    struct Query
+    {
+        std::string table;
+        //unique and indexed, the primary key in practice
+        std::string key_column;
+        std::string columns = "*";
+        //optional condition without parameters, ANDed into every read
+        std::string filter;
+    };
+
+    struct Statistics
+    {
+        size_t pages_fetched = 0;
+        size_t fetches_dropped = 0;
+        size_t cached_pages = 0;
+    };
+
+    using RowsReady = std::function<void(size_t first_row, size_t last_row)>;
+    using CountReady = std::function<void(size_t row_count)>;
+
+    PagedListModel(const std::string& database_path, Query _query, size_t _page_size = 100, size_t _neighbor_pages = 2, size_t _max_pages = 64)
+        : query(std::move(_query)), page_size(_page_size == 0 ? 1 : _page_size), neighbor_pages(_neighbor_pages),
+        max_pages(_max_pages < 2 * _neighbor_pages + 1 ? 2 * _neighbor_pages + 1 : _max_pages),
+        readers(database_path, 2, false) {}
+
+    //queued reads see closing and return without touching the database
+    ~PagedListModel()
+    {
+        closing = true;
+    }
+
+    PagedListModel(const PagedListModel&) = delete;
+    PagedListModel& operator=(const PagedListModel&) = delete;
+
+    //set before open, they are read from the background connections without locking
+    void setRowsReady(RowsReady callback)
+    {
+        rows_ready = std::move(callback);
+    }
+
+    void setCountReady(CountReady callback)
+    {
+        count_ready = std::move(callback);
+    }
+
+    /// <summary>
+    /// starts reading the list from the top, dropping every cached page and any read still
+    /// running for a previous open. also used to refresh the list after the table changed
+    /// </summary>
+    void open()
+    {
+        uint64_t current;
+        {
+            std::lock_guard<std::mutex> lock(model_mutex);
+            current = ++generation;
+            pages.clear();
+            boundaries.clear();
+            requested.clear();
+            row_count.reset();
+            visible_first_page = 0;
+            visible_last_page = 0;
+            requestPage(0);
+        }
+        readers.post([this, current](DatabaseManager& connection) { scanKeys(connection, current); });
+    }
+
+    //empty until the key scan has counted the rows
+    std::optional<size_t> rowCount() const
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        return row_count;
+    }
+
+    /// <summary>
+    /// the row at index when its page is cached, otherwise the page is requested and the
+    /// control shows a placeholder until rows_ready reports it. asking for a row outside the
+    /// visible range moves the range to it
+    /// </summary>
+    std::optional<nlohmann::json> rowAt(size_t row)
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        size_t page = row / page_size;
+        auto cached = pages.find(page);
+        if (cached == pages.end()) {
+            if (!wanted(page)) {
+                visible_first_page = page;
+                visible_last_page = page;
+                requestWindow();
+            }
+            requestPage(page);
+            return std::nullopt;
+        }
+        size_t offset = row % page_size;
+        if (offset >= cached->second.size()) {
+            return std::nullopt;
+        }
+        return cached->second[offset];
+    }
+
+    /// <summary>
+    /// rows currently on screen. the visible pages are requested first, then their
+    /// neighbors below and above, and queued reads of pages outside that window are dropped
+    /// </summary>
+    void setVisibleRange(size_t first_row, size_t last_row)
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        visible_first_page = first_row / page_size;
+        visible_last_page = (last_row < first_row ? first_row : last_row) / page_size;
+        requestWindow();
+    }
+
+    Statistics statistics() const
+    {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        Statistics snapshot;
+        snapshot.pages_fetched = pages_fetched;
+        snapshot.fetches_dropped = fetches_dropped;
+        snapshot.cached_pages = pages.size();
+        return snapshot;
+    }
+
+private:
+
+    //rows between two scan checks for a newer open or the model closing
+    static constexpr size_t scan_check_interval = 4096;
+
+    bool wanted(size_t page) const
+    {
+        size_t first = visible_first_page > neighbor_pages ? visible_first_page - neighbor_pages : 0;
+        return page >= first && page <= visible_last_page + neighbor_pages;
+    }
+
+    //model_mutex held, visible pages first and then their neighbors below and above
+    void requestWindow()
+    {
+        for (size_t page = visible_first_page; page <= visible_last_page; ++page) {
+            requestPage(page);
+        }
+        for (size_t distance = 1; distance <= neighbor_pages; ++distance) {
+            requestPage(visible_last_page + distance);
+            if (visible_first_page >= distance) {
+                requestPage(visible_first_page - distance);
+            }
+        }
+    }
+
+    //model_mutex held. a page past the first needs the last key of the page before it, a
+    //page that cannot be read yet is requested again once that key is known
+    void requestPage(size_t page)
+    {
+        if (!wanted(page) || pages.count(page) > 0 || requested.count(page) > 0) {
+            return;
+        }
+        if (row_count.has_value() && page * page_size >= row_count.value()) {
+            return;
+        }
+        if (page > 0 && boundaries.count(page - 1) == 0) {
+            return;
+        }
+
+        requested.insert(page);
+        uint64_t current = generation;
+        readers.post([this, current, page](DatabaseManager& connection) { fetchPage(connection, current, page); });
+    }
+
+    static void bindKey(DatabaseManager& connection, int index, const nlohmann::json& key)
+    {
+        if (key.is_number_integer()) {
+            connection.bindParameter<long long>(index, key.get<long long>());
+        }
+        else if (key.is_number()) {
+            connection.bindParameter<double>(index, key.get<double>());
+        }
+        else {
+            connection.bindParameter<std::string>(index, key.get<std::string>());
+        }
+    }
+
+    static nlohmann::json columnValue(sqlite3_stmt* statement, int column)
+    {
+        switch (sqlite3_column_type(statement, column)) {
+        case SQLITE_INTEGER:
+            return sqlite3_column_int64(statement, column);
+        case SQLITE_FLOAT:
+            return sqlite3_column_double(statement, column);
+        case SQLITE_TEXT:
+            return std::string(reinterpret_cast<const char*>(sqlite3_column_text(statement, column)), sqlite3_column_bytes(statement, column));
+        default:
+            return nullptr;
+        }
+    }
+
+    std::string whereClause(bool after_key) const
+    {
+        std::string clause;
+        if (!query.filter.empty()) {
+            clause = " WHERE (" + query.filter + ")";
+        }
+        if (after_key) {
+            clause += (clause.empty() ? " WHERE " : " AND ") + query.key_column + " > ?";
+        }
+        return clause;
+    }
+
+    void fetchPage(DatabaseManager& connection, uint64_t current, size_t page)
+    {
+        nlohmann::json after_key;
+        {
+            std::lock_guard<std::mutex> lock(model_mutex);
+            if (current != generation) {
+                return;
+            }
+            if (closing || !wanted(page)) {
+                requested.erase(page);
+                ++fetches_dropped;
+                return;
+            }
+            if (page > 0) {
+                after_key = boundaries[page - 1];
+            }
+        }
+
+        std::string sql = "SELECT " + query.key_column + ", " + query.columns + " FROM " + query.table + whereClause(page > 0)
+            + " ORDER BY " + query.key_column + " LIMIT " + std::to_string(page_size) + ";";
+        std::vector<nlohmann::json> rows;
+        nlohmann::json last_key;
+        if (connection.prepareStatement(sql)) {
+            if (page > 0) {
+                bindKey(connection, 1, after_key);
+            }
+            sqlite3_stmt* prepared_statement = connection.getPreparedStatement();
+            const int column_count = sqlite3_column_count(prepared_statement);
+            while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+                nlohmann::json row = nlohmann::json::object();
+                for (int column = 1; column < column_count; ++column) {
+                    row[sqlite3_column_name(prepared_statement, column)] = columnValue(prepared_statement, column);
+                }
+                last_key = columnValue(prepared_statement, 0);
+                rows.push_back(std::move(row));
+            }
+            sqlite3_finalize(prepared_statement);
+        }
+
+        size_t fetched = rows.size();
+        {
+            std::lock_guard<std::mutex> lock(model_mutex);
+            if (current != generation) {
+                return;
+            }
+            requested.erase(page);
+            ++pages_fetched;
+            if (fetched == page_size) {
+                boundaries[page] = last_key;
+            }
+            pages[page] = std::move(rows);
+            evict();
+
+            //the next page may have been waiting for this page's last key
+            requestPage(page + 1);
+        }
+
+        if (fetched > 0 && rows_ready) {
+            rows_ready(page * page_size, page * page_size + fetched - 1);
+        }
+    }
+
+    void scanKeys(DatabaseManager& connection, uint64_t current)
+    {
+        std::string sql = "SELECT " + query.key_column + " FROM " + query.table + whereClause(false) + " ORDER BY " + query.key_column + ";";
+        if (!connection.prepareStatement(sql)) {
+            return;
+        }
+
+        sqlite3_stmt* prepared_statement = connection.getPreparedStatement();
+        std::vector<nlohmann::json> page_ends;
+        size_t rows = 0;
+        while (sqlite3_step(prepared_statement) == SQLITE_ROW)
+        {
+            ++rows;
+            if (rows % page_size == 0) {
+                page_ends.push_back(columnValue(prepared_statement, 0));
+            }
+            if (rows % scan_check_interval == 0 && (closing || current != generation.load())) {
+                sqlite3_finalize(prepared_statement);
+                return;
+            }
+        }
+        sqlite3_finalize(prepared_statement);
+
+        {
+            std::lock_guard<std::mutex> lock(model_mutex);
+            if (current != generation) {
+                return;
+            }
+            for (size_t page = 0; page < page_ends.size(); ++page) {
+                boundaries.emplace(page, std::move(page_ends[page]));
+            }
+            row_count = rows;
+
+            //pages jumped to before the scan finished
+            requestWindow();
+        }
+
+        if (count_ready) {
+            count_ready(rows);
+        }
+    }
+
+    //model_mutex held, drops the cached pages farthest from the visible window
+    void evict()
+    {
+        while (pages.size() > max_pages)
+        {
+            auto farthest = pages.end();
+            size_t farthest_distance = 0;
+            for (auto page = pages.begin(); page != pages.end(); ++page) {
+                size_t distance = page->first < visible_first_page ? visible_first_page - page->first
+                    : page->first > visible_last_page ? page->first - visible_last_page : 0;
+                if (farthest == pages.end() || distance > farthest_distance) {
+                    farthest = page;
+                    farthest_distance = distance;
+                }
+            }
+            pages.erase(farthest);
+        }
+    }
+
+    Query query;
+    size_t page_size;
+    size_t neighbor_pages;
+    size_t max_pages;
+    RowsReady rows_ready;
+    CountReady count_ready;
+
+    mutable std::mutex model_mutex;
+    std::atomic<uint64_t> generation{ 0 };
+    std::atomic<bool> closing{ false };
+    std::unordered_map<size_t, std::vector<nlohmann::json>> pages;
+    //last key of each full page, known from a fetch of that page or from the key scan
+    std::unordered_map<size_t, nlohmann::json> boundaries;
+    std::unordered_set<size_t> requested;
+    std::optional<size_t> row_count;
+    size_t visible_first_page = 0;
+    size_t visible_last_page = 0;
+    size_t pages_fetched = 0;
+    size_t fetches_dropped = 0;
+
+    //declared last so its connections stop before anything above is destroyed
+    DatabaseExecutor readers;
+};
+
+#endif //USERINTERFACE_HPP
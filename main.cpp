@@ -1,6 +1,15 @@
 #include "DatabaseManager.hpp"
 #include "PasswordSecurity.hpp"
 #include "UserDAO.hpp"
+#include "LoginDAO.hpp"
+#include "ElementDAO.hpp"
+#include "CategoryDAO.hpp"
+#include "CategoryIndex.hpp"
+#include "ElementTree.hpp"
+#include "FullTextSearch.hpp"
+#include "Autocomplete.hpp"
+#include "MovementLedger.hpp"
+#include "Runtime.hpp"
 #include <iostream>
 #include <map>
 
@@ -30,10 +39,98 @@ int main()
         "Logins",
         "login_id           INTEGER     PRIMARY KEY     AUTOINCREMENT, "
         "login_user         INTEGER     NOT NULL, "
-        "FOREIGN KEY (login_user) REFERENCES Users(user_id), "
         "login_success      BOOLEAN     NOT NULL        DEFAULT 0, "
-        "login_timestamp    DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+        "login_timestamp    DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (login_user) REFERENCES Users(user_id)"
     );
+
+    LoginDAO login_dao(database);
+    login_dao.createRollupTables();
+
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    ElementDAO element_dao(database);
+    element_dao.createHierarchyTables();
+
+    ElementGuid element_guids(database);
+    element_guids.createCounterTable();
+    element_dao.setGuidGenerator(&element_guids);
+    element_dao.createStockTables();
+
+    //every placement, move, stock change and transfer is appended to the ledger by triggers
+    MovementLedger movement_ledger(database);
+    movement_ledger.createLedgerTables();
+    movement_ledger.load();
+
+    database.createTableIfNotExists
+    (
+        "Categories",
+        "category_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "category_name          TEXT        UNIQUE NOT NULL CHECK(length(category_name) <= 63), "
+        "category_description   TEXT, "
+        "category_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "category_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+
+    database.createTableIfNotExists
+    (
+        "ElementCategories",
+        "elemcat_item_guid      TEXT        NOT NULL, "
+        "elemcat_category_id    INTEGER     NOT NULL, "
+        "elemcat_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "elemcat_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "PRIMARY KEY (elemcat_item_guid, elemcat_category_id), "
+        "FOREIGN KEY (elemcat_item_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (elemcat_category_id) REFERENCES Categories(category_id) ON DELETE CASCADE"
+    );
+
+    CategoryDAO category_dao(database);
+
+    //category set queries are answered from bitmaps that follow both DAOs
+    CategoryIndex category_index;
+    category_index.load(database);
+    element_dao.addObserver(&category_index);
+    category_dao.addObserver(&category_index);
+
+    //paths and subtree walks for the interface, kept in memory and following the element DAO
+    ElementTree element_tree;
+    element_tree.load(database);
+    element_dao.addObserver(&element_tree);
+
+    FullTextSearch full_text_search(database);
+    full_text_search.createSearchTables();
+
+    //type-ahead for the command line and interface, never queries sqlite per keystroke
+    UserDAO user_dao(database);
+    Autocomplete autocomplete;
+    autocomplete.load(database);
+    user_dao.addObserver(&autocomplete);
+    element_dao.addObserver(&autocomplete);
+    category_dao.addObserver(&autocomplete);
+
+    //logged in users survive a restart through the snapshot, idle sessions expire in the background
+    SessionManager session_manager;
+    session_manager.loadSnapshot("sessions.snapshot", database);
+    session_manager.setSnapshotFile("sessions.snapshot");
+    session_manager.startMaintenance();
+    user_dao.addObserver(&session_manager);
+
+    //commands run as tasks: reads on the reader pool, writes on one writer, hashing and reports on compute workers
+    ApplicationController application_controller(session_manager, "test_database.db");
     
 
 
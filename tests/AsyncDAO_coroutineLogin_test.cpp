@@ -0,0 +1,127 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include "LoginDAO.hpp"
+#include "PasswordSecurity.hpp"
+#include "AsyncDAO.hpp"
+#include <iostream>
+#include <atomic>
+#include <chrono>
+
+//register a user with the hash computed on the pool, then log in twice
+Task<std::string> registerAndLogin(AsyncDAO& async_dao, std::string username, std::string password)
+{
+    std::string salt = PasswordSecurity::generate_salt();
+    std::string hashed = co_await async_dao.hashPassword(password, salt);
+    bool inserted = co_await async_dao.write([&](DatabaseManager& connection) {
+        UserDAO users(connection);
+        return users.insertRecord({ {"user_name", username}, {"user_salt", salt}, {"user_passhash", hashed} });
+    });
+
+    std::optional<int> wrong = co_await async_dao.login(username, "not " + password);
+    std::optional<int> right = co_await async_dao.login(username, password);
+    co_return "inserted " + std::to_string(inserted) + ", wrong password " + std::to_string(wrong.has_value())
+        + ", right password user " + std::to_string(right.value_or(-1));
+}
+
+Task<int> countLogins(AsyncDAO& async_dao, int success)
+{
+    co_return co_await async_dao.read([success](DatabaseManager& connection) {
+        connection.prepareStatement("SELECT count(*) FROM Logins WHERE login_success = ?;");
+        connection.bindParameter<int>(1, success);
+        sqlite3_stmt* prepared_statement = connection.getPreparedStatement();
+        int count = sqlite3_step(prepared_statement) == SQLITE_ROW ? sqlite3_column_int(prepared_statement, 0) : -1;
+        sqlite3_finalize(prepared_statement);
+        return count;
+    });
+}
+
+Task<void> failingRead(AsyncDAO& async_dao)
+{
+    co_await async_dao.read([](DatabaseManager&) -> int { throw std::runtime_error("read failed"); });
+}
+
+int main()
+{
+    {
+        DatabaseManager database("test_database.db");
+        database.createTableIfNotExists
+        (
+            "Users",
+            "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+            "user_name          TEXT        NOT NULL        UNIQUE,"
+            "user_salt          TEXT        NOT NULL, "
+            "user_passhash      TEXT        NOT NULL, "
+            "user_legalname     TEXT, "
+            "user_phonenumber   TEXT, "
+            "user_emailaddress  TEXT, "
+            "user_description   TEXT, "
+            "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+            "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+            "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+        );
+        database.createTableIfNotExists
+        (
+            "Logins",
+            "login_id           INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+            "login_user         INTEGER     NOT NULL, "
+            "login_success      BOOLEAN     NOT NULL        DEFAULT 0, "
+            "login_timestamp    DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+            "FOREIGN KEY (login_user) REFERENCES Users(user_id)"
+        );
+    }
+
+    //the database threads resume coroutines on the pool, so the pool outlives them
+    ThreadPool compute(2);
+    DatabaseExecutor writer("test_database.db", 1, true);
+    DatabaseExecutor readers("test_database.db", 2, false);
+    AsyncDAO async_dao(readers, writer, compute);
+
+    std::cout << syncWait(registerAndLogin(async_dao, "alice", "correct horse")) << std::endl;
+    std::cout << "Unknown user: " << syncWait(async_dao.login("nobody", "x")).has_value() << std::endl;
+
+    try {
+        syncWait(failingRead(async_dao));
+    }
+    catch (const std::exception& error) {
+        std::cout << "Exception carried to the awaiting coroutine: " << error.what() << std::endl;
+    }
+
+    //many logins in flight on two compute threads and one writer, none of them holding a thread while waiting
+    const int attempts = 500;
+    std::atomic<int> succeeded{ 0 };
+    std::atomic<int> finished{ 0 };
+    std::promise<void> all_done;
+    auto attempt = [&](int index) -> async_detail::DetachedTask {
+        std::optional<int> user = co_await async_dao.login("alice", index % 5 == 0 ? "wrong" : "correct horse");
+        succeeded += user.has_value();
+        if (++finished == attempts) {
+            all_done.set_value();
+        }
+    };
+    auto start = std::chrono::steady_clock::now();
+    for (int index = 0; index < attempts; ++index) {
+        attempt(index);
+    }
+    all_done.get_future().wait();
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Concurrent logins: " << succeeded << " of " << attempts << " succeeded, finished in under 10 s: " << (elapsed_ms < 10000.0) << std::endl;
+    std::cout << "Recorded: " << syncWait(countLogins(async_dao, 1)) << " successes, " << syncWait(countLogins(async_dao, 0)) << " failures" << std::endl;
+
+    //a controller going away while logins are suspended on its executors waits for them to finish
+    std::atomic<int> drained{ 0 };
+    {
+        SessionManager sessions;
+        ApplicationController controller(sessions, "test_database.db", 2, 2);
+        auto detached = [&drained](AsyncDAO controller_dao, int index) -> async_detail::DetachedTask {
+            co_await controller_dao.login("alice", index % 2 == 0 ? "wrong" : "correct horse");
+            ++drained;
+        };
+        for (int index = 0; index < 100; ++index) {
+            detached(AsyncDAO(controller), index);
+        }
+    }
+    std::cout << "Drained before the controller stopped: " << drained << " of 100" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include "ElementDAO.hpp"
+#include "CategoryDAO.hpp"
+#include "Autocomplete.hpp"
+#include <iostream>
+#include <chrono>
+
+void printCompletions(const std::string& label, const std::vector<std::string>& completions)
+{
+    std::cout << label << ":";
+    for (const std::string& completion : completions) {
+        std::cout << " [" << completion << "]";
+    }
+    std::cout << std::endl;
+}
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_legalname     TEXT, "
+        "user_phonenumber   TEXT, "
+        "user_emailaddress  TEXT, "
+        "user_description   TEXT, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+    database.createTableIfNotExists
+    (
+        "Categories",
+        "category_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "category_name          TEXT        UNIQUE NOT NULL CHECK(length(category_name) <= 63), "
+        "category_description   TEXT, "
+        "category_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "category_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+
+    UserDAO users(database);
+    for (const char* name : { "alice", "Albert", "alfred", "bob", "alina" }) {
+        users.insertRecord({ {"user_name", name}, {"user_salt", std::string("salt_") + name}, {"user_passhash", std::string("hash_") + name} });
+    }
+
+    //100,000 elements sharing 20,000 distinct names
+    database.executeQuery(
+        "INSERT INTO Element (element_guid, element_name, element_class, element_owner) "
+        "WITH RECURSIVE counter (value) AS (SELECT 200000 UNION ALL SELECT value + 1 FROM counter WHERE value < 299999) "
+        "SELECT printf('%06d', value), 'Bin ' || (value % 20000), 5, 1 FROM counter;");
+
+    CategoryDAO categories(database);
+    for (const char* name : { "tools", "toolboxes", "timber", "paint" }) {
+        categories.insertRecord({ {"category_name", name} });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Autocomplete autocomplete;
+    autocomplete.load(database);
+    std::cout << "Loaded in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+
+    printCompletions("al", autocomplete.completeUserName("al"));
+    printCompletions("AL limit 2", autocomplete.completeUserName("AL", 2));
+    printCompletions("too", autocomplete.completeCategoryName("too"));
+    printCompletions("bin 1999", autocomplete.completeElementName("bin 1999"));
+
+    //average over many keystrokes of a growing prefix
+    const std::string typed = "Bin 1234";
+    const int rounds = 20000;
+    size_t returned = 0;
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        returned += autocomplete.completeElementName(typed.substr(0, 1 + round % typed.size())).size();
+    }
+    double average_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+    std::cout << "Average completion: " << (average_us < 50.0 ? "under 50 us" : "slow") << " (" << returned / rounds << " results)" << std::endl;
+
+    //writes through the DAOs reach the completions
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+    users.addObserver(&autocomplete);
+    elements.addObserver(&autocomplete);
+    categories.addObserver(&autocomplete);
+
+    users.insertRecord({ {"user_name", "alvaro"}, {"user_salt", "salt_alvaro"}, {"user_passhash", "hash_alvaro"} });
+    nlohmann::json rename = { {"user_name", "zed"} };
+    users.updateRecordById(1, rename);
+    users.deleteRecordById(3);
+    printCompletions("al after writes", autocomplete.completeUserName("al"));
+    printCompletions("z", autocomplete.completeUserName("z"));
+
+    elements.insertRecord({ {"element_guid", "AC0001"}, {"element_name", "Bin 19999"}, {"element_class", 5}, {"element_owner", 1} });
+    elements.insertRecord({ {"element_guid", "AC0002"}, {"element_name", "Bin 19999b"}, {"element_class", 5}, {"element_owner", 1} });
+    printCompletions("bin 19999", autocomplete.completeElementName("bin 19999"));
+    elements.deleteElement("AC0002", ElementDAO::DeletionContingency::CASCADE);
+    printCompletions("bin 19999 after delete", autocomplete.completeElementName("bin 19999"));
+
+    //a shared name stays while any element still carries it
+    elements.deleteElement("AC0001", ElementDAO::DeletionContingency::CASCADE);
+    printCompletions("shared name kept", autocomplete.completeElementName("bin 19999"));
+
+    categories.insertRecord({ {"category_name", "toolchests"} });
+    categories.deleteRecordById(2);
+    printCompletions("too after writes", autocomplete.completeCategoryName("too"));
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "DatabaseManager.hpp"
+#include "BulkUserImport.hpp"
+#include "UserDAO.hpp"
+#include "Autocomplete.hpp"
+#include <iostream>
+#include <fstream>
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_legalname     TEXT, "
+        "user_phonenumber   TEXT, "
+        "user_emailaddress  TEXT, "
+        "user_description   TEXT, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+
+    //10000 valid users followed by a malformed line, a duplicate and a bad email
+    {
+        std::ofstream jsonl("test_users.jsonl");
+        for (int index = 0; index < 10000; ++index) {
+            jsonl << "{\"user_name\": \"bulk_user_" << index << "\", \"user_password\": \"secret" << index << "\"}\n";
+        }
+        jsonl << "{\"user_name\": \"broken\"\n";
+        jsonl << "{\"user_name\": \"bulk_user_7\", \"user_password\": \"again\"}\n";
+        jsonl << "{\"user_name\": \"mailer\", \"user_password\": \"pw\", \"user_emailaddress\": \"nowhere\"}\n";
+    }
+
+    {
+        std::ofstream csv("test_users.csv");
+        csv << "user_name,user_password,user_legalname,user_permission\n";
+        csv << "csv_admin,hunter2,\"Doe, Jane\",3\n";
+        csv << "csv_base,hunter3,,\n";
+        csv << "csv_bad,hunter4,Someone,9\n";
+        csv << "csv_short,hunter5\n";
+    }
+
+    ThreadPool hash_pool;
+    BulkUserImport importer(database, hash_pool, 512);
+    Autocomplete autocomplete;
+    importer.addObserver(&autocomplete);
+
+    BulkUserImport::ImportReport jsonl_report = importer.importFile("test_users.jsonl", BulkUserImport::FileFormat::JSONL);
+    BulkUserImport::printReport(jsonl_report, std::cout);
+
+    BulkUserImport::ImportReport csv_report = importer.importFile("test_users.csv", BulkUserImport::FileFormat::CSV);
+    BulkUserImport::printReport(csv_report, std::cout);
+
+    //imported users validate against their hashed passwords
+    UserDAO user_query(database);
+    nlohmann::json imported = user_query.retrieveRecordById(user_query.getIdGivenUsername("bulk_user_42").value_or(-1));
+    std::cout << "bulk_user_42 password valid: "
+        << PasswordSecurity::validate_password(imported["user_passhash"], "secret42", imported["user_salt"]) << std::endl;
+
+    std::cout << user_query.retrieveRecordById(user_query.getIdGivenUsername("csv_admin").value_or(-1)).dump() << std::endl;
+
+    //observers hear of every committed user, an import inside a transaction that rolls back tells them nothing
+    std::cout << "Autocomplete bulk_user_9999: " << autocomplete.completeUserName("bulk_user_9999").size()
+        << ", csv_: " << autocomplete.completeUserName("csv_").size() << std::endl;
+    {
+        std::ofstream jsonl("test_users.jsonl");
+        jsonl << "{\"user_name\": \"discarded\", \"user_password\": \"pw\"}\n";
+    }
+    database.beginTransaction();
+    importer.importFile("test_users.jsonl", BulkUserImport::FileFormat::JSONL);
+    database.rollbackTransaction();
+    std::cout << "Rolled back import completed: " << autocomplete.completeUserName("discarded").size() << std::endl;
+}
@@ -0,0 +1,162 @@
+#include "DatabaseManager.hpp"
+#include "ElementDAO.hpp"
+#include "CategoryDAO.hpp"
+#include "CategoryIndex.hpp"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+//guids matched by a SQL statement over ElementCategories, sorted for comparison
+std::vector<std::string> sqlGuids(DatabaseManager& database, const std::string& sql)
+{
+    std::vector<std::string> guids;
+    database.prepareStatement(sql);
+    sqlite3_stmt* prepared_statement = database.getPreparedStatement();
+    while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+        guids.push_back(reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 0)));
+    }
+    sqlite3_finalize(prepared_statement);
+    std::sort(guids.begin(), guids.end());
+    return guids;
+}
+
+std::vector<std::string> sorted(std::vector<std::string> guids)
+{
+    std::sort(guids.begin(), guids.end());
+    return guids;
+}
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+    database.createTableIfNotExists
+    (
+        "Categories",
+        "category_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "category_name          TEXT        UNIQUE NOT NULL CHECK(length(category_name) <= 63), "
+        "category_description   TEXT, "
+        "category_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "category_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+    database.createTableIfNotExists
+    (
+        "ElementCategories",
+        "elemcat_item_guid      TEXT        NOT NULL, "
+        "elemcat_category_id    INTEGER     NOT NULL, "
+        "elemcat_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "elemcat_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "PRIMARY KEY (elemcat_item_guid, elemcat_category_id), "
+        "FOREIGN KEY (elemcat_item_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (elemcat_category_id) REFERENCES Categories(category_id) ON DELETE CASCADE"
+    );
+
+    CategoryDAO categories(database);
+    for (const char* name : { "tools", "red", "blue", "broken", "power tools" }) {
+        categories.insertRecord({ {"category_name", name} });
+    }
+
+    //200,000 elements, each category assigned to a different deterministic share of them
+    database.executeQuery(
+        "INSERT INTO Element (element_guid, element_name, element_class, element_owner) "
+        "WITH RECURSIVE counter (value) AS (SELECT 200000 UNION ALL SELECT value + 1 FROM counter WHERE value < 399999) "
+        "SELECT printf('%06d', value), 'element ' || value, 6, 1 FROM counter;");
+    database.executeQuery(
+        "INSERT INTO ElementCategories (elemcat_item_guid, elemcat_category_id) "
+        "SELECT element_guid, category_id FROM Element, Categories "
+        "WHERE ((Element.rowid * 2654435761 + category_id * 40503) % 1000) < 150 + category_id * 100;");
+
+    auto start = std::chrono::steady_clock::now();
+    CategoryIndex index;
+    index.load(database);
+    std::cout << "Indexed " << index.elementCount() << " elements in "
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+
+    const std::string expression = "tools AND (red OR blue) AND NOT broken";
+    const std::string sql =
+        "SELECT elemcat_item_guid FROM ElementCategories JOIN Categories ON category_id = elemcat_category_id WHERE category_name = 'tools' "
+        "INTERSECT SELECT elemcat_item_guid FROM ElementCategories JOIN Categories ON category_id = elemcat_category_id WHERE category_name IN ('red', 'blue') "
+        "EXCEPT SELECT elemcat_item_guid FROM ElementCategories JOIN Categories ON category_id = elemcat_category_id WHERE category_name = 'broken';";
+
+    start = std::chrono::steady_clock::now();
+    size_t matching = index.countMatching(expression);
+    double bitmap_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::vector<std::string> expected = sqlGuids(database, sql);
+    double sql_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Bitmap query: " << matching << " elements in " << bitmap_ms << " ms" << std::endl;
+    std::cout << "SQL INTERSECT/EXCEPT: " << expected.size() << " elements in " << sql_ms << " ms" << std::endl;
+    std::cout << "Results match: " << (sorted(index.query(expression)) == expected) << std::endl;
+
+    //a leading NOT is taken against every visible element, including uncategorised ones
+    std::vector<std::string> not_tools = sqlGuids(database,
+        "SELECT element_guid FROM Element EXCEPT SELECT elemcat_item_guid FROM ElementCategories WHERE elemcat_category_id = 1;");
+    std::cout << "NOT tools matches: " << (sorted(index.query("NOT tools")) == not_tools) << std::endl;
+    std::cout << "Quoted and #id operands: " << (index.countMatching("\"power tools\" OR #1") == sqlGuids(database,
+        "SELECT elemcat_item_guid FROM ElementCategories WHERE elemcat_category_id IN (1, 5) GROUP BY elemcat_item_guid;").size()) << std::endl;
+
+    //nesting is limited instead of recursing until the stack runs out
+    std::string negations;
+    for (int i = 0; i < 100000; ++i) {
+        negations += "NOT ";
+    }
+    std::cout << "Nested 100 deep: " << index.evaluate(std::string(100, '(') + "tools" + std::string(100, ')')).has_value()
+        << ", 100000 deep refused: " << !index.evaluate(std::string(100000, '(') + "tools").has_value()
+        << ", 100000 NOTs refused: " << !index.evaluate(negations + "tools").has_value() << std::endl;
+
+    //writes through the DAOs reach the index without a reload
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+    elements.addObserver(&index);
+    categories.addObserver(&index);
+
+    elements.insertRecord({ {"element_guid", "CT0001"}, {"element_name", "Cordless drill"}, {"element_class", 6}, {"element_owner", 1} });
+    categories.insertRecord({ {"category_name", "cordless"} });
+    int cordless = categories.getLastInsertedId();
+    categories.assignCategory("CT0001", cordless);
+    categories.assignCategory("CT0001", 1);
+    std::cout << "cordless AND tools: " << index.query("cordless AND tools").size() << std::endl;
+
+    categories.unassignCategory("CT0001", 1);
+    std::cout << "After unassign: " << index.query("cordless AND tools").size() << std::endl;
+
+    nlohmann::json rename = { {"category_name", "battery"} };
+    categories.updateRecordById(cordless, rename);
+    std::cout << "Renamed category: " << index.query("battery").size() << std::endl;
+
+    elements.deleteRecordById(ElementDAO::getIdGivenGuid("CT0001").value());
+    std::cout << "Hidden element dropped: " << (index.elementCount() == 200000 && index.query("battery").empty()) << std::endl;
+
+    //restoring makes the element and a hidden category visible again with their assignments
+    nlohmann::json restore = { {"element_visibility", 1} };
+    elements.updateRecordById(ElementDAO::getIdGivenGuid("CT0001").value(), restore);
+    std::cout << "Restored element back: " << (index.elementCount() == 200001 && index.query("battery") == std::vector<std::string>{ "CT0001" }) << std::endl;
+
+    categories.deleteRecordById(cordless);
+    std::cout << "Hidden category dropped: " << !index.evaluate("battery").has_value() << std::endl;
+    nlohmann::json show = { {"category_visibility", 1} };
+    categories.updateRecordById(cordless, show);
+    std::cout << "Restored category back: " << (index.query("battery") == std::vector<std::string>{ "CT0001" }) << std::endl;
+
+    std::cout << "Unknown category refused: " << !index.evaluate("tools AND green").has_value() << std::endl;
+    std::cout << "Unbalanced refused: " << !index.evaluate("(tools OR red").has_value() << std::endl;
+
+    return 0;
+}
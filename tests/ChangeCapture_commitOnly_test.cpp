@@ -0,0 +1,167 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include "ChangeCapture.hpp"
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+void printSets(const std::string& label, ChangeSubscription& subscription)
+{
+    std::cout << label << ":";
+    subscription.drain([](const ChangeSet& change_set) {
+        std::cout << " #" << change_set.sequence << " [";
+        for (const RowChange& change : change_set.changes) {
+            const char* operation = change.operation == RowChange::INSERTED ? "+" : change.operation == RowChange::UPDATED ? "~" : "-";
+            std::cout << " " << operation << change.table << ":" << change.rowid;
+        }
+        std::cout << " ]";
+    });
+    std::cout << std::endl;
+}
+
+void insertUsers(DatabaseManager& database, int first, int count)
+{
+    database.prepareStatement("INSERT INTO Users (user_name, user_salt, user_passhash) VALUES (?, 's', 'h');");
+    for (int user = first; user < first + count; ++user) {
+        database.bindParameter<std::string>(1, "bulk" + std::to_string(user));
+        database.executeAndReset();
+    }
+    sqlite3_finalize(database.getPreparedStatement());
+}
+
+int main()
+{
+    //row ids and sequence numbers below are only stable from an empty database
+    std::remove("test_database.db");
+    std::remove("test_database.db-journal");
+
+    DatabaseManager database("test_database.db");
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_legalname     TEXT, "
+        "user_phonenumber   TEXT, "
+        "user_emailaddress  TEXT, "
+        "user_description   TEXT, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+
+    //the cost of the hooks on a bulk insert, before any capture exists
+    auto start = std::chrono::steady_clock::now();
+    database.beginTransaction();
+    insertUsers(database, 0, 100000);
+    database.commitTransaction();
+    double uncaptured_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    database.executeQuery("DELETE FROM Users WHERE user_name GLOB 'bulk*';");
+
+    ChangeCapture capture(database);
+    std::shared_ptr<ChangeSubscription> cache = capture.subscribe();
+    std::shared_ptr<ChangeSubscription> index = capture.subscribe(4);
+
+    UserDAO users(database);
+    users.insertRecord({ {"user_name", "alice"}, {"user_salt", "s"}, {"user_passhash", "h"} });
+    printSets("Autocommit insert", *cache);
+
+    //rolled back work is never published
+    database.beginTransaction();
+    users.insertRecord({ {"user_name", "bob"}, {"user_salt", "s"}, {"user_passhash", "h"} });
+    database.executeQuery("UPDATE Users SET user_permission = 2;");
+    database.rollbackTransaction();
+    printSets("Rolled back transaction", *cache);
+
+    //a rolled back savepoint takes only its own rows out of the transaction
+    database.beginTransaction();
+    users.insertRecord({ {"user_name", "carol"}, {"user_salt", "s"}, {"user_passhash", "h"} });
+    database.beginTransaction();
+    database.executeQuery("UPDATE Users SET user_permission = 3;");
+    database.rollbackTransaction();
+    database.beginTransaction();
+    database.executeQuery("UPDATE Users SET user_description = 'kept' WHERE user_name = 'alice';");
+    database.commitTransaction();
+    std::cout << "Buffered before commit: " << capture.bufferedChanges() << ", published so far: " << capture.committedSets() << std::endl;
+    database.commitTransaction();
+    database.executeQuery("DELETE FROM Users WHERE user_name = 'carol';");
+    printSets("Savepoints", *cache);
+
+    //a statement failing halfway inside a transaction is undone by sqlite and leaves no rows behind
+    database.beginTransaction();
+    database.prepareStatement("INSERT INTO Users (user_name, user_salt, user_passhash) VALUES ('dave', 's', 'h'), ('alice', 's', 'h');");
+    database.executePrepared();
+    users.insertRecord({ {"user_name", "erin"}, {"user_salt", "s"}, {"user_passhash", "h"} });
+    database.commitTransaction();
+    printSets("Failed statement", *cache);
+
+    //a COMMIT refused while another connection reads is not published until it goes through
+    {
+        DatabaseManager reader("test_database.db");
+        reader.beginTransaction();
+        reader.prepareStatement("SELECT count(*) FROM Users;");
+        sqlite3_step(reader.getPreparedStatement());
+        database.beginTransaction();
+        database.executeQuery("UPDATE Users SET user_description = 'busy' WHERE user_name = 'erin';");
+        bool committed = database.commitTransaction();
+        std::cout << "Busy commit: " << committed << ", published so far: " << capture.committedSets() << std::endl;
+        sqlite3_finalize(reader.getPreparedStatement());
+        reader.commitTransaction();
+        committed = database.commitTransaction();
+        std::cout << "Retried commit: " << committed << ", published so far: " << capture.committedSets() << std::endl;
+    }
+    printSets("After retry", *cache);
+    database.executeQuery("DELETE FROM Users WHERE user_name = 'erin';");
+    cache->drain([](const ChangeSet&) {});
+
+    //the subscriber holding four sets missed the rest
+    insertUsers(database, 300000, 1);
+    insertUsers(database, 300001, 1);
+    cache->drain([](const ChangeSet&) {});
+    std::cout << "Index queued " << index->queued() << ", overflowed: " << index->takeOverflow() << ", again: " << index->takeOverflow() << std::endl;
+    index->drain([](const ChangeSet&) {});
+    capture.unsubscribe(index);
+
+    //a consumer thread follows a stream of commits as they happen
+    const int commits = 2000;
+    std::atomic<bool> done{ false };
+    size_t consumed_rows = 0;
+    uint64_t last_sequence = capture.committedSets();
+    bool contiguous = true;
+    std::thread consumer([&] {
+        std::shared_ptr<const ChangeSet> change_set;
+        while (true) {
+            bool finished = done.load();
+            while (cache->poll(change_set)) {
+                contiguous = contiguous && change_set->sequence == last_sequence + 1;
+                last_sequence = change_set->sequence;
+                consumed_rows += change_set->changes.size();
+            }
+            if (finished) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    });
+    for (int commit = 0; commit < commits; ++commit) {
+        insertUsers(database, 200000 + commit, 1);
+    }
+    done = true;
+    consumer.join();
+    std::cout << "Streamed: " << consumed_rows << " rows in order: " << contiguous << ", overflowed: " << cache->takeOverflow() << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    database.beginTransaction();
+    insertUsers(database, 0, 100000);
+    database.commitTransaction();
+    double captured_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::shared_ptr<const ChangeSet> bulk;
+    cache->poll(bulk);
+    std::cout << "Bulk insert published as one set of " << bulk->changes.size() << " rows, touches Users: " << bulk->touches("Users") << std::endl;
+    std::cout << "Bulk insert with capture: " << captured_ms << " ms, without: " << uncaptured_ms << " ms" << std::endl;
+
+    return 0;
+}
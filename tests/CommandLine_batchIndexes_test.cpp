@@ -0,0 +1,128 @@
+#include "DatabaseManager.hpp"
+#include "ElementDAO.hpp"
+#include "CategoryDAO.hpp"
+#include "CategoryIndex.hpp"
+#include "Autocomplete.hpp"
+#include "ElementTree.hpp"
+#include "Runtime.hpp"
+#include "CommandLine.hpp"
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+
+int main()
+{
+    std::remove("test_database.db");
+
+    DatabaseManager database("test_database.db");
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+    database.createTableIfNotExists
+    (
+        "Categories",
+        "category_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "category_name          TEXT        UNIQUE NOT NULL CHECK(length(category_name) <= 63), "
+        "category_description   TEXT, "
+        "category_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "category_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+    database.createTableIfNotExists
+    (
+        "ElementCategories",
+        "elemcat_item_guid      TEXT        NOT NULL, "
+        "elemcat_category_id    INTEGER     NOT NULL, "
+        "elemcat_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "elemcat_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "PRIMARY KEY (elemcat_item_guid, elemcat_category_id), "
+        "FOREIGN KEY (elemcat_item_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (elemcat_category_id) REFERENCES Categories(category_id) ON DELETE CASCADE"
+    );
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+    ElementDAO(database).createHierarchyTables();
+    CategoryDAO(database).insertRecord({ {"category_name", "tools"} });
+
+    CategoryIndex category_index;
+    Autocomplete autocomplete;
+    ElementTree element_tree;
+    category_index.load(database);
+    autocomplete.load(database);
+    element_tree.load(database);
+
+    SessionManager sessions;
+    std::string admin = sessions.createSession(1, UserDAO::UserPermission::ADMIN);
+
+    {
+        ApplicationController controller(sessions, "test_database.db", 2, 2);
+
+        //additem guid name parent category, the element is written before its category is checked
+        controller.registerCommand("additem", Capabilities::NONE, ApplicationController::Workload::WRITE,
+            [&](ApplicationController::CommandContext& context) {
+                ElementDAO elements(*context.database);
+                CategoryDAO categories(*context.database);
+                for (RecordObserver* index : std::initializer_list<RecordObserver*>{ &category_index, &autocomplete, &element_tree }) {
+                    elements.addObserver(index);
+                    categories.addObserver(index);
+                }
+
+                nlohmann::json element = { {"element_guid", context.arguments.at(1)}, {"element_name", context.arguments.at(2)}, {"element_class", 6}, {"element_owner", 1} };
+                if (context.arguments.at(3) != "-") {
+                    element["element_parent_guid"] = context.arguments.at(3);
+                }
+                if (!elements.insertRecord(element)) {
+                    return ApplicationController::CommandResult{ false, nullptr, "insert failed" };
+                }
+                std::string category(context.arguments.at(4));
+                if (!categories.existenceOfRecordByField("category_id", category)) {
+                    return ApplicationController::CommandResult{ false, nullptr, "unknown category" };
+                }
+                bool assigned = categories.assignCategory(std::string(context.arguments.at(1)), std::stoi(category));
+                return ApplicationController::CommandResult{ assigned, nullptr, assigned ? "" : "assign failed" };
+            });
+
+        //the third command fails after its element was written and its savepoint rolls back, the
+        //indexes must not keep the element they were told about inside the transaction
+        std::istringstream script(
+            "additem TA0001 Anvil - 1\n"
+            "additem TB0001 Bellows TA0001 1\n"
+            "additem TC0001 Chisel TA0001 99\n"
+            "additem TD0001 Drill - 1\n");
+        std::ostringstream report;
+        BatchMode::Summary summary = BatchMode(controller, admin).run(script, report);
+        std::cout << "Commands " << summary.commands << ", failed " << summary.failed << ", transactions " << summary.transactions << std::endl;
+    }
+
+    database.prepareStatement("SELECT group_concat(element_guid, ' ') FROM (SELECT element_guid FROM Element ORDER BY element_guid);");
+    sqlite3_stmt* prepared_statement = database.getPreparedStatement();
+    sqlite3_step(prepared_statement);
+    std::cout << "Stored: " << sqlite3_column_text(prepared_statement, 0) << std::endl;
+    sqlite3_finalize(prepared_statement);
+
+    std::cout << "Tree: " << element_tree.size() << " elements, chisel found " << (element_tree.find("TC0001") >= 0) << std::endl;
+    std::cout << "Autocomplete 'c': " << autocomplete.completeElementName("c").size() << ", 'd': " << autocomplete.completeElementName("d").size() << std::endl;
+    std::cout << "Tagged tools: " << category_index.countMatching("tools") << ", chisel indexed " << category_index.ordinalOf("TC0001").has_value() << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include "Runtime.hpp"
+#include "CommandLine.hpp"
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+
+void registerCommands(ApplicationController& controller)
+{
+    controller.registerCommand("adduser", Capabilities::MANAGE_USERS, ApplicationController::Workload::WRITE,
+        [](ApplicationController::CommandContext& context) {
+            UserDAO users(*context.database);
+            bool inserted = users.insertRecord({ {"user_name", context.arguments.at(1)}, {"user_salt", "salt"}, {"user_passhash", "hash"} });
+            return ApplicationController::CommandResult{ inserted, nullptr, inserted ? "" : "insert failed" };
+        });
+    controller.registerCommand("countusers", Capabilities::VIEW_USERS, ApplicationController::Workload::READ,
+        [](ApplicationController::CommandContext& context) {
+            context.database->prepareStatement("SELECT count(*) FROM Users;");
+            sqlite3_stmt* prepared_statement = context.database->getPreparedStatement();
+            int count = sqlite3_step(prepared_statement) == SQLITE_ROW ? sqlite3_column_int(prepared_statement, 0) : -1;
+            sqlite3_finalize(prepared_statement);
+            return ApplicationController::CommandResult{ true, count, "" };
+        });
+    controller.registerCommand("echo", Capabilities::NONE, ApplicationController::Workload::COMPUTE,
+        [](ApplicationController::CommandContext& context) {
+            return ApplicationController::CommandResult{ true, context.arguments.size() > 1 ? context.arguments[1] : "", "" };
+        });
+}
+
+int main()
+{
+    {
+        DatabaseManager database("test_database.db");
+        database.createTableIfNotExists
+        (
+            "Users",
+            "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+            "user_name          TEXT        NOT NULL        UNIQUE,"
+            "user_salt          TEXT        NOT NULL, "
+            "user_passhash      TEXT        NOT NULL, "
+            "user_legalname     TEXT, "
+            "user_phonenumber   TEXT, "
+            "user_emailaddress  TEXT, "
+            "user_description   TEXT, "
+            "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+            "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+            "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+        );
+
+        //a DAO transaction inside an open one becomes a savepoint, its rollback leaves the outer work alone
+        database.beginTransaction();
+        database.executeQuery("INSERT INTO Users (user_name, user_salt, user_passhash) VALUES ('outer', 's', 'h');");
+        database.beginTransaction();
+        database.executeQuery("INSERT INTO Users (user_name, user_salt, user_passhash) VALUES ('inner', 's', 'h');");
+        database.rollbackTransaction();
+        database.commitTransaction();
+        database.prepareStatement("SELECT group_concat(user_name) FROM Users;");
+        sqlite3_stmt* prepared_statement = database.getPreparedStatement();
+        sqlite3_step(prepared_statement);
+        std::cout << "After nested rollback: " << sqlite3_column_text(prepared_statement, 0) << std::endl;
+        sqlite3_finalize(prepared_statement);
+        database.executeQuery("DELETE FROM Users;");
+    }
+
+    SessionManager sessions;
+    std::string admin = sessions.createSession(1, UserDAO::UserPermission::ADMIN);
+    std::string base = sessions.createSession(2, UserDAO::UserPermission::BASE);
+
+    {
+        ApplicationController controller(sessions, "test_database.db", 4, 4);
+        registerCommands(controller);
+
+        //the duplicate and the refused command fail alone, the writes around them still commit
+        std::istringstream script(
+            "# nightly import\n"
+            "adduser alice\n"
+            "adduser bob\n"
+            "adduser alice\n"
+            "\n"
+            "countusers\n"
+            "echo \"two words\"\n"
+            "frobnicate\n"
+            "adduser carol\n"
+            "countusers\n");
+        std::ostringstream report;
+        BatchMode batch(controller, admin);
+        BatchMode::Summary summary = batch.run(script, report);
+        std::cout << report.str();
+        std::cout << "Commands " << summary.commands << ", failed " << summary.failed << ", transactions " << summary.transactions << std::endl;
+
+        //a session without the capability has every write refused inside the transaction
+        std::istringstream refused("adduser mallory\nadduser trent\n");
+        std::ostringstream refused_report;
+        summary = BatchMode(controller, base).run(refused, refused_report);
+        std::cout << "Base session: " << summary.failed << " of " << summary.commands << " refused" << std::endl;
+
+        //the same 5,000 inserts as one autocommit each against grouped into transactions
+        const int rows = 5000;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::future<ApplicationController::CommandResult>> singles;
+        for (int row = 0; row < rows; ++row) {
+            singles.push_back(controller.execute(admin, "adduser single" + std::to_string(row)));
+        }
+        int single_written = 0;
+        for (auto& single : singles) {
+            single_written += single.get().success;
+        }
+        double single_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        {
+            std::ofstream file("batch_script.txt");
+            for (int row = 0; row < rows; ++row) {
+                file << "adduser batched" << row << "\n";
+            }
+            file << "countusers\n";
+        }
+        std::ostringstream bulk_report;
+        std::optional<BatchMode::Summary> bulk = BatchMode(controller, admin).runFile("batch_script.txt", bulk_report);
+        std::remove("batch_script.txt");
+
+        bool missing_ran = BatchMode(controller, admin).runFile("missing_script.txt", bulk_report).has_value();
+        std::cout << "Missing file ran: " << missing_ran << std::endl;
+        std::cout << "Batched: " << bulk->succeeded << " ok in " << bulk->transactions << " transactions, " << bulk->elapsed_ms
+            << " ms; one autocommit each: " << single_written << " ok in " << single_ms << " ms" << std::endl;
+        std::cout << "Batched is faster: " << (bulk->elapsed_ms < single_ms) << std::endl;
+    }
+
+    return 0;
+}
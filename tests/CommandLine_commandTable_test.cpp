@@ -0,0 +1,171 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include "Runtime.hpp"
+#include "CommandLine.hpp"
+#include <iostream>
+#include <sstream>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+//every allocation of the program is counted, parsing a line should add none. the default
+//operator delete releases with free
+std::atomic<size_t> allocations{ 0 };
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+using Result = ApplicationController::CommandResult;
+using Context = ApplicationController::CommandContext;
+using Workload = ApplicationController::Workload;
+
+Result countUsers(Context& context)
+{
+    context.database->prepareStatement("SELECT count(*) FROM Users;");
+    sqlite3_stmt* prepared_statement = context.database->getPreparedStatement();
+    int count = sqlite3_step(prepared_statement) == SQLITE_ROW ? sqlite3_column_int(prepared_statement, 0) : -1;
+    sqlite3_finalize(prepared_statement);
+    return { true, count, "" };
+}
+
+Result addUser(Context& context)
+{
+    UserDAO users(*context.database);
+    bool inserted = users.insertRecord({ {"user_name", context.arguments.at(1)}, {"user_salt", "salt"}, {"user_passhash", "hash"},
+        {"user_permission", context.arguments.size() > 2 ? std::stoi(std::string(context.arguments[2])) : 1} });
+    return { inserted, nullptr, inserted ? "" : "insert failed" };
+}
+
+Result echo(Context& context)
+{
+    return { true, context.arguments.at(1), "" };
+}
+
+Result unused(Context&)
+{
+    return { true, nullptr, "" };
+}
+
+inline constexpr auto commands = makeCommandTable({
+    CommandSpec{ "countusers", Capabilities::VIEW_USERS, Workload::READ, &countUsers },
+    CommandSpec{ "adduser", Capabilities::MANAGE_USERS, Workload::WRITE, &addUser,
+        { {"name"}, {"permission", ArgumentKind::INTEGER, true} } },
+    CommandSpec{ "echo", Capabilities::NONE, Workload::COMPUTE, &echo, { {"text"} } },
+    CommandSpec{ "move", Capabilities::EDIT_OWN_ELEMENTS, Workload::WRITE, &unused,
+        { {"element", ArgumentKind::GUID}, {"parent", ArgumentKind::GUID} } },
+    CommandSpec{ "transfer", Capabilities::TRANSFER_OWN_ELEMENTS, Workload::WRITE, &unused,
+        { {"element", ArgumentKind::GUID}, {"owner", ArgumentKind::INTEGER} } },
+    CommandSpec{ "stock", Capabilities::EDIT_OWN_ELEMENTS, Workload::WRITE, &unused,
+        { {"element", ArgumentKind::GUID}, {"key"}, {"quantity", ArgumentKind::INTEGER} } },
+    CommandSpec{ "search", Capabilities::VIEW_ELEMENTS, Workload::READ, &unused, { {"query"}, {"limit", ArgumentKind::INTEGER, true} } },
+    CommandSpec{ "history", Capabilities::VIEW_ELEMENTS, Workload::READ, &unused, { {"element", ArgumentKind::GUID} } },
+    CommandSpec{ "contents", Capabilities::VIEW_ELEMENTS, Workload::READ, &unused, { {"element", ArgumentKind::GUID} } },
+    CommandSpec{ "logins", Capabilities::VIEW_LOGINS, Workload::READ, &unused, { {"user", ArgumentKind::INTEGER} } },
+    CommandSpec{ "deluser", Capabilities::MANAGE_USERS, Workload::WRITE, &unused, { {"user", ArgumentKind::INTEGER} } },
+    CommandSpec{ "logout", Capabilities::NONE, Workload::COMPUTE, &unused },
+});
+
+static_assert(commands.find("move") != nullptr && commands.find("move")->argument_count == 2, "move is found at compile time");
+static_assert(commands.find("mover") == nullptr && commands.find("") == nullptr, "other words are not");
+
+int main()
+{
+    {
+        DatabaseManager database("test_database.db");
+        database.createTableIfNotExists
+        (
+            "Users",
+            "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+            "user_name          TEXT        NOT NULL        UNIQUE,"
+            "user_salt          TEXT        NOT NULL, "
+            "user_passhash      TEXT        NOT NULL, "
+            "user_legalname     TEXT, "
+            "user_phonenumber   TEXT, "
+            "user_emailaddress  TEXT, "
+            "user_description   TEXT, "
+            "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+            "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+            "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+        );
+    }
+
+    const CommandTableView table = commands.view();
+    std::cout << "Commands in order:";
+    for (const CommandSpec& command : table) {
+        std::cout << " " << command.name;
+    }
+    std::cout << std::endl;
+
+    std::string quoted = "echo \"say \"\"hi\"\" twice\"";
+    TokenList words = tokenizeInPlace(quoted);
+    std::cout << "Quoted word: [" << words[1] << "] of " << words.size() << std::endl;
+
+    const char* lines[] = { "", "frobnicate 1", "move DR0001", "move DR0001 SH0001 extra", "move DR-001 SH0001", "move DRU001 SH0001",
+        "transfer DR0001 two", "search \"washer m6\"", "stock DR0001 m6 -40", "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17" };
+    for (const char* line : lines) {
+        std::string buffer = line;
+        ParsedCommand parsed = table.parse(buffer);
+        std::cout << "[" << line << "]: " << parseStatusMessage(parsed.status) << " " << parsed.subject << std::endl;
+    }
+
+    //allocations of a parse against tokenizing into strings and a hash map lookup, as the controller used to
+    const size_t rounds = 200000;
+    std::string source = "stock DR0001 \"m6 washer\" 250";
+    std::string buffer;
+    buffer.reserve(source.size());
+    size_t found = 0;
+    size_t before = allocations.load();
+    for (size_t round = 0; round < rounds; ++round) {
+        buffer.assign(source);
+        found += table.parse(buffer).ok();
+    }
+    size_t table_allocations = allocations.load() - before;
+
+    std::unordered_map<std::string, int> map;
+    for (const CommandSpec& command : table) {
+        map[std::string(command.name)] = 1;
+    }
+    before = allocations.load();
+    for (size_t round = 0; round < rounds; ++round) {
+        buffer.assign(source);
+        TokenList words = tokenizeInPlace(buffer);
+        std::vector<std::string> tokens(words.words.begin(), words.words.begin() + words.size());
+        found += map.count(tokens.front());
+    }
+    size_t map_allocations = allocations.load() - before;
+
+    std::cout << "Parsed " << found << " lines. table: " << table_allocations << " allocations; tokenize and map: "
+        << map_allocations / rounds << " allocations per line" << std::endl;
+
+    SessionManager sessions;
+    std::string admin = sessions.createSession(1, UserDAO::UserPermission::ADMIN);
+    {
+        ApplicationController controller(sessions, "test_database.db", 2, 2);
+        table.install(controller);
+
+        //the installed handler holds lines sent straight to the controller to the schema
+        std::cout << "Straight to controller: " << controller.execute(admin, "adduser eve notanumber").get().error << std::endl;
+
+        std::istringstream script(
+            "adduser alice\n"
+            "adduser bob 2\n"
+            "adduser carol x\n"
+            "adduser dave\n"
+            "countusers\n"
+            "echo\n"
+            "echo done\n");
+        std::ostringstream report;
+        BatchMode batch(controller, admin);
+        batch.setCommandTable(table);
+        batch.run(script, report);
+        std::cout << report.str();
+    }
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include "DatabaseManager.hpp"
+#include "ElementDAO.hpp"
+#include <iostream>
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+
+    //WAREHOUSE > STOREROOM > RACK > SHELF > ITEM, plus a second storeroom
+    const char* rows[][4] =
+    {
+        {"WH0001", "Main warehouse", "0", ""},
+        {"SR0001", "North storeroom", "1", "WH0001"},
+        {"SR0002", "South storeroom", "1", "WH0001"},
+        {"RK0001", "Rack A", "3", "SR0001"},
+        {"SH0001", "Top shelf", "4", "RK0001"},
+        {"DR0001", "Drill", "6", "SH0001"}
+    };
+
+    for (const auto& row : rows)
+    {
+        nlohmann::json element_data =
+        {
+            {"element_guid", row[0]},
+            {"element_name", row[1]},
+            {"element_class", std::stoi(row[2])},
+            {"element_owner", 1}
+        };
+        if (row[3][0] != '\0') {
+            element_data["element_parent_guid"] = row[3];
+        }
+        elements.insertRecord(element_data);
+    }
+
+    std::cout << "Subtree of WH0001:";
+    for (const auto& element : elements.retrieveSubtree("WH0001")) {
+        std::cout << " " << element["element_guid"].get<std::string>() << "@" << element["closure_depth"];
+    }
+    std::cout << std::endl;
+
+    std::cout << "Path to DR0001:";
+    for (const auto& element : elements.retrieveAncestorPath("DR0001")) {
+        std::cout << " / " << element["element_name"].get<std::string>();
+    }
+    std::cout << std::endl;
+
+    std::cout << "DR0001 inside SR0001: " << elements.isInside("DR0001", "SR0001") << std::endl;
+    std::cout << "DR0001 inside SR0002: " << elements.isInside("DR0001", "SR0002") << std::endl;
+
+    //moving the rack carries its shelf and item along
+    elements.moveElement("RK0001", std::string("SR0002"));
+    std::cout << "After move, DR0001 inside SR0001: " << elements.isInside("DR0001", "SR0001") << std::endl;
+    std::cout << "After move, DR0001 inside SR0002: " << elements.isInside("DR0001", "SR0002") << std::endl;
+    std::cout << "Path depth to DR0001: " << elements.retrieveAncestorPath("DR0001").size() << std::endl;
+
+    //an element cannot be moved below itself
+    std::cout << "Cycle refused: " << !elements.moveElement("SR0002", std::string("SH0001")) << std::endl;
+
+    //a missing parent is refused
+    nlohmann::json orphan = { {"element_guid", "DR0002"}, {"element_name", "Orphan"}, {"element_class", 6}, {"element_owner", 1}, {"element_parent_guid", "XXXXXX"} };
+    std::cout << "Orphan refused: " << !elements.insertRecord(orphan) << std::endl;
+
+    std::cout << elements.retrieveRecordByGuid("DR0001").dump() << std::endl;
+}
@@ -0,0 +1,81 @@
+#include "DatabaseManager.hpp"
+#include "ElementDAO.hpp"
+#include <iostream>
+
+//prints guid@depth for every element below the given one
+void printSubtree(ElementDAO& elements, const std::string& guid)
+{
+    std::cout << "Subtree of " << guid << ":";
+    for (const auto& element : elements.retrieveSubtree(guid)) {
+        std::cout << " " << element["element_guid"].get<std::string>() << "@" << element["closure_depth"];
+    }
+    std::cout << std::endl;
+}
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+    elements.createReservedRoots(1);
+
+    //DW0001 > DB0001 > DR0001 > (DS0001 > DC0001, DS0002)
+    const char* rows[][3] =
+    {
+        {"DW0001", "0", ""},
+        {"DB0001", "2", "DW0001"},
+        {"DR0001", "3", "DB0001"},
+        {"DS0001", "4", "DR0001"},
+        {"DC0001", "5", "DS0001"},
+        {"DS0002", "4", "DR0001"}
+    };
+
+    for (const auto& row : rows)
+    {
+        nlohmann::json element_data = { {"element_guid", row[0]}, {"element_name", row[0]}, {"element_class", std::stoi(row[1])}, {"element_owner", 1} };
+        if (row[2][0] != '\0') {
+            element_data["element_parent_guid"] = row[2];
+        }
+        elements.insertRecord(element_data);
+    }
+
+    printSubtree(elements, "DW0001");
+
+    //deleting the rack hands both shelves to the bay, the container moves up with its shelf
+    elements.deleteElement("DR0001", ElementDAO::DeletionContingency::ASSIGN_TO_PARENT);
+    printSubtree(elements, "DW0001");
+
+    //deprecating the first shelf parks its container under 111111
+    elements.deleteElement("DS0001", ElementDAO::DeletionContingency::DEPRECATE);
+    printSubtree(elements, "111111");
+
+    //deleting the bay sends the remaining shelf to the root
+    elements.deleteElement("DB0001", ElementDAO::DeletionContingency::ASSIGN_TO_ROOT);
+    printSubtree(elements, "000000");
+    printSubtree(elements, "DW0001");
+
+    //cascade removes the warehouse, an element that no longer exists cannot be deleted again
+    elements.deleteElement("DW0001", ElementDAO::DeletionContingency::CASCADE);
+    std::cout << "DW0001 gone: " << elements.retrieveRecordByGuid("DW0001").is_null() << std::endl;
+    std::cout << "Second delete refused: " << !elements.deleteElement("DW0001", ElementDAO::DeletionContingency::CASCADE) << std::endl;
+    std::cout << "Reserved root refused: " << !elements.deleteElement("000000", ElementDAO::DeletionContingency::CASCADE) << std::endl;
+
+    std::cout << "DS0002 path length: " << elements.retrieveAncestorPath("DS0002").size() << std::endl;
+}
@@ -0,0 +1,124 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include "ElementDAO.hpp"
+#include <iostream>
+#include <chrono>
+
+void printReport(const std::string& label, const ElementDAO::TransferReport& report)
+{
+    std::cout << label << ": success " << report.success << ", " << report.affected_rows << " rows" << std::endl;
+}
+
+int ownerOf(DatabaseManager& database, const std::string& guid)
+{
+    database.prepareStatement("SELECT element_owner FROM Element WHERE element_guid = ?;");
+    database.bindParameter<std::string>(1, guid);
+    sqlite3_stmt* prepared_statement = database.getPreparedStatement();
+    int owner = sqlite3_step(prepared_statement) == SQLITE_ROW ? sqlite3_column_int(prepared_statement, 0) : -1;
+    sqlite3_finalize(prepared_statement);
+    return owner;
+}
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_legalname     TEXT, "
+        "user_phonenumber   TEXT, "
+        "user_emailaddress  TEXT, "
+        "user_description   TEXT, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    //1 owns the storeroom, 2 is another base user, 3 is an admin, 4 is locked and 5 hidden
+    UserDAO users(database);
+    users.insertRecord({ {"user_name", "owner"}, {"user_salt", "s1"}, {"user_passhash", "h1"} });
+    users.insertRecord({ {"user_name", "other"}, {"user_salt", "s2"}, {"user_passhash", "h2"} });
+    users.insertRecord({ {"user_name", "admin"}, {"user_salt", "s3"}, {"user_passhash", "h3"}, {"user_permission", 3} });
+    users.insertRecord({ {"user_name", "locked"}, {"user_salt", "s4"}, {"user_passhash", "h4"}, {"user_permission", 0} });
+    users.insertRecord({ {"user_name", "hidden"}, {"user_salt", "s5"}, {"user_passhash", "h5"}, {"user_visibility", 0} });
+
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+    elements.insertRecord({ {"element_guid", "TR0001"}, {"element_name", "Storeroom"}, {"element_class", 1}, {"element_owner", 1} });
+    elements.insertRecord({ {"element_guid", "TS0001"}, {"element_name", "Shelf"}, {"element_class", 4}, {"element_parent_guid", "TR0001"}, {"element_owner", 1} });
+    elements.insertRecord({ {"element_guid", "TB0001"}, {"element_name", "Bin"}, {"element_class", 5}, {"element_parent_guid", "TS0001"}, {"element_owner", 2} });
+    elements.insertRecord({ {"element_guid", "TM0001"}, {"element_name", "Admin's meter"}, {"element_class", 6}, {"element_parent_guid", "TS0001"}, {"element_owner", 3} });
+    elements.insertRecord({ {"element_guid", "TK0001"}, {"element_name", "Locked user's box"}, {"element_class", 5}, {"element_owner", 4} });
+    elements.insertRecord({ {"element_guid", "TH0001"}, {"element_name", "Hidden user's box"}, {"element_class", 5}, {"element_owner", 5} });
+
+    //20,000 containers on the shelf
+    database.executeQuery(
+        "INSERT INTO Element (element_guid, element_name, element_class, element_parent_guid, element_owner) "
+        "WITH RECURSIVE counter (value) AS (SELECT 200000 UNION ALL SELECT value + 1 FROM counter WHERE value < 219999) "
+        "SELECT printf('%06d', value), 'Box ' || value, 5, 'TS0001', 1 FROM counter;");
+    database.executeQuery(
+        "INSERT INTO ElementClosure (closure_ancestor, closure_descendant, closure_depth) "
+        "SELECT closure_ancestor, element_guid, closure_depth + 1 FROM Element JOIN ElementClosure ON closure_descendant = 'TS0001' "
+        "WHERE element_guid GLOB '2[0-9][0-9][0-9][0-9][0-9]' "
+        "UNION ALL SELECT element_guid, element_guid, 0 FROM Element WHERE element_guid GLOB '2[0-9][0-9][0-9][0-9][0-9]';");
+
+    printReport("Other user refused", elements.transferOwnership("TR0001", 2, 2));
+    printReport("Locked recipient refused", elements.transferOwnership("TR0001", 4, 1));
+    printReport("Missing element refused", elements.transferOwnership("TX0001", 2, 1));
+    printReport("Locked owner refused", elements.transferOwnership("TK0001", 1, 4));
+    printReport("Hidden owner refused", elements.transferOwnership("TH0001", 1, 5));
+    std::cout << "Owner unchanged after refusals: " << ownerOf(database, "TR0001") << " " << ownerOf(database, "TK0001") << " " << ownerOf(database, "TH0001") << std::endl;
+
+    //the bin already belongs to 2 and the meter to the admin, neither is counted
+    ElementDAO::TransferReport report = elements.transferOwnership("TR0001", 2, 1);
+    printReport("Owner transfers storeroom", report);
+    std::cout << "Write lock held: " << (report.locked_ms <= report.elapsed_ms) << ", under 1 s: " << (report.elapsed_ms < 1000.0) << std::endl;
+    std::cout << "Owners now: " << ownerOf(database, "TR0001") << " " << ownerOf(database, "TS0001") << " " << ownerOf(database, "219999")
+        << ", foreign item kept by: " << ownerOf(database, "TM0001") << std::endl;
+
+    printReport("Previous owner refused", elements.transferOwnership("TS0001", 1, 1));
+    printReport("Admin transfers shelf", elements.transferOwnership("TS0001", 1, 3));
+    std::cout << "Owners now: " << ownerOf(database, "TR0001") << " " << ownerOf(database, "TS0001") << " " << ownerOf(database, "TB0001")
+        << " " << ownerOf(database, "TM0001") << std::endl;
+
+    //owners cannot be changed through updateRecordById
+    nlohmann::json direct = { {"element_owner", 2} };
+    std::cout << "Owner refused by update: " << !elements.updateRecordById(ElementDAO::getIdGivenGuid("TM0001").value(), direct)
+        << ", kept by: " << ownerOf(database, "TM0001") << std::endl;
+
+    //against one UPDATE per element
+    auto start = std::chrono::steady_clock::now();
+    database.beginTransaction();
+    for (int number = 200000; number < 220000; ++number) {
+        database.prepareStatement("UPDATE Element SET element_owner = 2 WHERE element_guid = ?;");
+        database.bindParameter<std::string>(1, std::to_string(number));
+        database.executePrepared();
+    }
+    database.commitTransaction();
+    double per_element_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    report = elements.transferOwnership("TS0001", 1, 3);
+    std::cout << "Set based: " << report.affected_rows << " rows in " << report.elapsed_ms << " ms, per element updates: " << per_element_ms << " ms" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "DatabaseManager.hpp"
+#include "ElementDAO.hpp"
+#include <iostream>
+#include <chrono>
+
+//true when every materialized level equals the sum recomputed over the closure
+bool levelsConsistent(DatabaseManager& database)
+{
+    database.prepareStatement(
+        "WITH recomputed AS (SELECT closure_ancestor AS node, stock_key AS key, round(sum(stock_quantity), 6) AS quantity "
+        "FROM ElementStock JOIN ElementClosure ON closure_descendant = stock_element GROUP BY 1, 2 HAVING quantity <> 0), "
+        "materialized AS (SELECT level_node, level_key, round(level_quantity, 6) FROM StockLevels WHERE round(level_quantity, 6) <> 0) "
+        "SELECT NOT EXISTS (SELECT * FROM recomputed EXCEPT SELECT * FROM materialized) "
+        "AND NOT EXISTS (SELECT * FROM materialized EXCEPT SELECT * FROM recomputed);");
+    return database.fetchBooleanResult();
+}
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+    elements.createStockTables();
+
+    //warehouse with two storerooms, a rack of two shelves and bins of bolts and paint
+    const char* rows[][4] =
+    {
+        {"SW0001", "Warehouse", "0", ""},
+        {"SR0001", "North storeroom", "1", "SW0001"},
+        {"SR0002", "South storeroom", "1", "SW0001"},
+        {"SK0001", "Rack", "3", "SR0001"},
+        {"SS0001", "Top shelf", "4", "SK0001"},
+        {"SS0002", "Bottom shelf", "4", "SK0001"},
+        {"SB0001", "Bolt bin", "7", "SS0001"},
+        {"SB0002", "Bolt bin", "7", "SS0002"},
+        {"SB0003", "Paint drum", "8", "SR0002"}
+    };
+    for (const auto& row : rows)
+    {
+        nlohmann::json element_data = { {"element_guid", row[0]}, {"element_name", row[1]}, {"element_class", std::stoi(row[2])}, {"element_owner", 1} };
+        if (row[3][0] != '\0') {
+            element_data["element_parent_guid"] = row[3];
+        }
+        elements.insertRecord(element_data);
+    }
+
+    elements.setQuantity("SB0001", "M6 bolt", 500);
+    elements.setQuantity("SB0002", "M6 bolt", 250);
+    elements.setQuantity("SB0002", "M8 bolt", 40);
+    elements.setQuantity("SB0003", "white paint", 18.5);
+
+    std::cout << "M6 bolts in warehouse: " << elements.retrieveStockLevel("SW0001", "M6 bolt") << std::endl;
+    std::cout << "M6 bolts in north storeroom: " << elements.retrieveStockLevel("SR0001", "M6 bolt") << std::endl;
+    std::cout << "Warehouse levels: " << elements.retrieveStockLevels("SW0001").dump() << std::endl;
+
+    elements.adjustQuantity("SB0001", "M6 bolt", -120);
+    elements.setQuantity("SB0002", "M6 bolt", 300);
+    std::cout << "After picking and recount: " << elements.retrieveStockLevel("SK0001", "M6 bolt") << std::endl;
+    std::cout << "Overdraw refused: " << !elements.adjustQuantity("SB0001", "M6 bolt", -1000) << std::endl;
+    std::cout << "Stock on a shelf refused: " << !elements.setQuantity("SS0001", "M6 bolt", 5) << std::endl;
+    std::cout << "Level unchanged after refusal: " << elements.retrieveStockLevel("SW0001", "M6 bolt") << std::endl;
+
+    //a bin holding stock cannot become a container, it may still become material
+    nlohmann::json to_container = { {"element_class", 5} };
+    nlohmann::json to_material = { {"element_class", 8} };
+    std::cout << "Class change to container refused: " << !elements.updateRecordById(ElementDAO::getIdGivenGuid("SB0001").value(), to_container)
+        << ", to material: " << elements.updateRecordById(ElementDAO::getIdGivenGuid("SB0001").value(), to_material) << std::endl;
+
+    //the rack with both shelves moves to the south storeroom
+    elements.moveElement("SK0001", std::string("SR0002"));
+    std::cout << "After move, north: " << elements.retrieveStockLevel("SR0001", "M6 bolt")
+        << " south: " << elements.retrieveStockLevel("SR0002", "M6 bolt")
+        << " warehouse: " << elements.retrieveStockLevel("SW0001", "M6 bolt") << std::endl;
+
+    //a shelf deleted with its bin takes the bolts out of every total above it
+    elements.deleteElement("SS0002", ElementDAO::DeletionContingency::CASCADE);
+    std::cout << "After deleting bottom shelf: " << elements.retrieveStockLevels("SW0001").dump() << std::endl;
+
+    //deleting the top shelf hands its bin to the rack, the totals above stay
+    elements.deleteElement("SS0001", ElementDAO::DeletionContingency::ASSIGN_TO_PARENT);
+    std::cout << "After relocating top shelf bin: " << elements.retrieveStockLevel("SK0001", "M6 bolt") << std::endl;
+    std::cout << "Levels consistent: " << levelsConsistent(database) << std::endl;
+
+    //a wide tree of bins under one storeroom, where the lookup replaces a subtree sum
+    database.executeQuery(
+        "INSERT INTO Element (element_guid, element_name, element_class, element_parent_guid, element_owner) "
+        "WITH RECURSIVE counter (value) AS (SELECT 200000 UNION ALL SELECT value + 1 FROM counter WHERE value < 219999) "
+        "SELECT printf('%06d', value), 'Bin ' || value, 7, 'SR0001', 1 FROM counter;");
+    database.executeQuery(
+        "INSERT INTO ElementClosure (closure_ancestor, closure_descendant, closure_depth) "
+        "SELECT closure_ancestor, element_guid, closure_depth + 1 FROM Element JOIN ElementClosure ON closure_descendant = 'SR0001' "
+        "WHERE element_guid GLOB '2[0-9][0-9][0-9][0-9][0-9]' "
+        "UNION ALL SELECT element_guid, element_guid, 0 FROM Element WHERE element_guid GLOB '2[0-9][0-9][0-9][0-9][0-9]';");
+    database.executeQuery(
+        "INSERT INTO ElementStock (stock_element, stock_key, stock_quantity) "
+        "SELECT element_guid, 'washer', 10 FROM Element WHERE element_guid GLOB '2[0-9][0-9][0-9][0-9][0-9]';");
+    elements.rebuildStockLevels();
+
+    auto start = std::chrono::steady_clock::now();
+    double level = elements.retrieveStockLevel("SW0001", "washer");
+    double lookup_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    database.prepareStatement(
+        "SELECT sum(stock_quantity) FROM ElementClosure JOIN ElementStock ON stock_element = closure_descendant "
+        "WHERE closure_ancestor = 'SW0001' AND stock_key = 'washer';");
+    sqlite3_stmt* prepared_statement = database.getPreparedStatement();
+    sqlite3_step(prepared_statement);
+    double summed = sqlite3_column_double(prepared_statement, 0);
+    sqlite3_finalize(prepared_statement);
+    double sum_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Washers: lookup " << level << " in " << lookup_us << " us, subtree sum " << summed << " in " << sum_us << " us" << std::endl;
+
+    elements.moveElement("SR0001", std::string("SR0002"));
+    std::cout << "After moving 20,000 bins, south washers: " << elements.retrieveStockLevel("SR0002", "washer") << std::endl;
+    std::cout << "Levels consistent: " << levelsConsistent(database) << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "DatabaseManager.hpp"
+#include "ElementDAO.hpp"
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+
+//times set based hierarchy maintenance on a subtree of 111,111 elements:
+//one warehouse over five levels with a fan out of ten
+int main()
+{
+    std::remove("test_benchmark.db");
+    DatabaseManager database("test_benchmark.db");
+
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    //node n has children 10n+1 .. 10n+10, guids are the node number in hex
+    database.executeQuery(
+        "INSERT INTO Element (element_guid, element_name, element_class, element_parent_guid, element_owner) "
+        "WITH RECURSIVE children (value) AS (SELECT 1 UNION ALL SELECT value + 1 FROM children WHERE value < 10), "
+        "nodes (node, parent, level) AS ("
+        "SELECT 0, NULL, 0 "
+        "UNION ALL "
+        "SELECT node * 10 + children.value, node, level + 1 FROM nodes, children WHERE level < 5) "
+        "SELECT printf('%06X', node), 'node ' || node, level, CASE WHEN parent IS NULL THEN NULL ELSE printf('%06X', parent) END, 1 FROM nodes;");
+
+    ElementDAO elements(database);
+
+    auto start = std::chrono::steady_clock::now();
+    elements.createHierarchyTables();
+    auto seeded = std::chrono::steady_clock::now();
+    std::cout << "Seeded closure for " << elements.retrieveSubtree("000000").size() + 1 << " elements in "
+        << std::chrono::duration<double, std::milli>(seeded - start).count() << " ms" << std::endl;
+
+    //a second tree three levels deep to move the warehouse under
+    for (const char* guid : { "F00000", "F00001", "F00002" }) {
+        nlohmann::json element_data = { {"element_guid", guid}, {"element_name", guid}, {"element_class", 0}, {"element_owner", 1} };
+        if (guid[5] != '0') {
+            element_data["element_parent_guid"] = std::string("F0000") + static_cast<char>(guid[5] - 1);
+        }
+        elements.insertRecord(element_data);
+    }
+
+    auto timeOperation = [](const char* label, auto operation) {
+        auto begin = std::chrono::steady_clock::now();
+        bool success = operation();
+        auto end = std::chrono::steady_clock::now();
+        std::cout << label << ": " << (success ? "ok" : "failed") << " in "
+            << std::chrono::duration<double, std::milli>(end - begin).count() << " ms" << std::endl;
+    };
+
+    timeOperation("Move 111,111 element subtree under a depth 3 parent", [&] { return elements.moveElement("000000", std::string("F00002")); });
+    timeOperation("Move it under a depth 1 parent", [&] { return elements.moveElement("000000", std::string("F00000")); });
+    timeOperation("Move it back to the top level", [&] { return elements.moveElement("000000", std::nullopt); });
+
+    std::cout << "Leaf 002B67 inside 000000: " << elements.isInside("002B67", "000000") << std::endl;
+    std::cout << "Leaf 002B67 path length: " << elements.retrieveAncestorPath("002B67").size() << std::endl;
+}
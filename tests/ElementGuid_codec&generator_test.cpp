@@ -0,0 +1,98 @@
+#include "DatabaseManager.hpp"
+#include "ElementDAO.hpp"
+#include "ElementGuid.hpp"
+#include <iostream>
+#include <unordered_set>
+#include <chrono>
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    //codec round trips and the reserved roots
+    std::cout << "000000 packs to " << ElementGuid::decode("000000").value() << std::endl;
+    std::cout << "111111 is reserved: " << (ElementGuid::decode("111111").value() == ElementGuid::deprecated_packed) << std::endl;
+    std::cout << "ZZZZZZ packs to " << ElementGuid::decode("ZZZZZZ").value() << std::endl;
+    std::cout << "Round trip WH0001: " << ElementGuid::encode(ElementGuid::decode("WH0001").value()) << std::endl;
+    std::cout << "Hand typed wh0o1l reads as " << ElementGuid::canonicalize("wh0o1l").value() << std::endl;
+    std::cout << "U rejected: " << !ElementGuid::decode("WHU001").has_value() << std::endl;
+    std::cout << "Short rejected: " << !ElementGuid::decode("WH001").has_value() << std::endl;
+    std::cout << "Lower case not canonical: " << !ElementGuid::isCanonical("wh0001") << std::endl;
+
+    //the first million counters map to a million distinct values
+    std::unordered_set<uint32_t> permuted;
+    for (uint32_t counter = 0; counter < 1000000; ++counter) {
+        permuted.insert(ElementGuid::permute(counter));
+    }
+    std::cout << "Distinct permuted values: " << permuted.size() << std::endl;
+
+    //two generators over the same counter reserve disjoint blocks
+    ElementGuid first(database, 64);
+    ElementGuid second(database, 64);
+    first.createCounterTable();
+
+    std::unordered_set<std::string> generated;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < 100000; ++i) {
+        generated.insert((i % 2 == 0 ? first : second).next().value());
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Generated 100000 guids, distinct: " << generated.size() << " in " << elapsed << "ms" << std::endl;
+    std::cout << "Reserved roots never generated: " << (generated.count("000000") == 0 && generated.count("111111") == 0) << std::endl;
+
+    //elements inserted without a guid are given one
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+    elements.setGuidGenerator(&first);
+
+    nlohmann::json warehouse = { {"element_name", "Generated warehouse"}, {"element_class", 0}, {"element_owner", 1} };
+    std::cout << "Insert without guid: " << elements.insertRecord(warehouse) << std::endl;
+    std::string warehouse_guid = elements.getLastInsertedGuid();
+    std::cout << "Stored under generated guid: " << elements.retrieveRecordByGuid(warehouse_guid)["element_name"] << std::endl;
+
+    nlohmann::json malformed = { {"element_guid", "AB-123"}, {"element_name", "Bad"}, {"element_class", 0}, {"element_owner", 1} };
+    std::cout << "Malformed guid refused: " << !elements.insertRecord(malformed) << std::endl;
+
+    //a block reserved inside a transaction that rolls back is dropped with the counter update,
+    //the next generator to reserve gets the same values and they must not be handed out twice
+    ElementGuid rolled_back(database, 4);
+    database.beginTransaction();
+    std::string abandoned = rolled_back.next().value();
+    database.rollbackTransaction();
+    ElementGuid later(database, 4);
+    std::unordered_set<std::string> reused;
+    for (int i = 0; i < 4; ++i) {
+        reused.insert(later.next().value());
+        reused.insert(rolled_back.next().value());
+    }
+    std::cout << "Rolled back block dropped: " << (reused.size() == 8) << ", abandoned guid reissued once: " << reused.count(abandoned) << std::endl;
+
+    //a guid supplied by hand that the counter reaches later is skipped
+    database.prepareStatement("SELECT counter_next FROM ElementGuidCounter WHERE counter_id = 0;");
+    sqlite3_stmt* prepared_statement = database.getPreparedStatement();
+    sqlite3_step(prepared_statement);
+    std::string upcoming = ElementGuid::encode(ElementGuid::permute(static_cast<uint32_t>(sqlite3_column_int64(prepared_statement, 0))));
+    sqlite3_finalize(prepared_statement);
+    nlohmann::json claimed = { {"element_guid", upcoming}, {"element_name", "Hand labelled bin"}, {"element_class", 0}, {"element_owner", 1} };
+    elements.insertRecord(claimed);
+    ElementGuid after_claim(database, 4);
+    std::cout << "Hand supplied guid skipped: " << (after_claim.next().value() != upcoming) << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "DatabaseManager.hpp"
+#include "ElementDAO.hpp"
+#include "ElementTree.hpp"
+#include <iostream>
+#include <chrono>
+
+//prints the guids of a subtree in preorder
+void printSubtree(const ElementTree& tree, const std::string& guid)
+{
+    std::cout << "Subtree of " << guid << ":";
+    tree.forEachInSubtree(tree.find(guid), [&](int32_t node) { std::cout << " " << tree.guidOf(node); });
+    std::cout << std::endl;
+}
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+
+    const char* rows[][4] =
+    {
+        {"TW0001", "Garage", "0", ""},
+        {"TR0001", "Tool rack", "3", "TW0001"},
+        {"TS0001", "Top shelf", "4", "TR0001"},
+        {"TS0002", "Bottom shelf", "4", "TR0001"}
+    };
+    for (const auto& row : rows)
+    {
+        nlohmann::json element_data = { {"element_guid", row[0]}, {"element_name", row[1]}, {"element_class", std::stoi(row[2])}, {"element_owner", 1} };
+        if (row[3][0] != '\0') {
+            element_data["element_parent_guid"] = row[3];
+        }
+        elements.insertRecord(element_data);
+    }
+
+    //snapshot loaded once, then kept current by the DAO
+    ElementTree tree;
+    tree.load(database);
+    elements.addObserver(&tree);
+    std::cout << "Loaded " << tree.size() << " elements" << std::endl;
+
+    nlohmann::json hammer = { {"element_guid", "TH0001"}, {"element_name", "Hammer"}, {"element_class", 6}, {"element_owner", 1}, {"element_parent_guid", "TS0001"} };
+    elements.insertRecord(hammer);
+
+    auto start = std::chrono::steady_clock::now();
+    std::string path = tree.renderPath(tree.find("TH0001"));
+    auto end = std::chrono::steady_clock::now();
+    std::cout << path << " (" << std::chrono::duration<double, std::micro>(end - start).count() << " us)" << std::endl;
+
+    printSubtree(tree, "TW0001");
+
+    elements.moveElement("TH0001", std::string("TS0002"));
+    std::cout << tree.renderPath(tree.find("TH0001")) << std::endl;
+
+    nlohmann::json rename = { {"element_name", "Lower shelf"} };
+    elements.updateRecordById(ElementDAO::getIdGivenGuid("TS0002").value(), rename);
+    std::cout << tree.renderPath(tree.find("TH0001")) << std::endl;
+
+    elements.deleteElement("TR0001", ElementDAO::DeletionContingency::ASSIGN_TO_PARENT);
+    std::cout << tree.renderPath(tree.find("TH0001")) << std::endl;
+    printSubtree(tree, "TW0001");
+
+    //the incrementally maintained tree matches a fresh load
+    ElementTree reloaded;
+    reloaded.load(database);
+    std::cout << "Reloaded path matches: " << (reloaded.renderPath(reloaded.find("TH0001")) == tree.renderPath(tree.find("TH0001"))) << std::endl;
+    std::cout << "Sizes match: " << (reloaded.size() == tree.size()) << std::endl;
+}
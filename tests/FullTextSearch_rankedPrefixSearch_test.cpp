@@ -0,0 +1,125 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include "ElementDAO.hpp"
+#include "FullTextSearch.hpp"
+#include <iostream>
+#include <chrono>
+
+void printUserHits(const std::string& label, const std::vector<FullTextSearch::UserHit>& hits)
+{
+    std::cout << label << ":";
+    for (const auto& hit : hits) {
+        std::cout << " " << hit.user_id;
+    }
+    std::cout << std::endl;
+}
+
+void printElementHits(const std::string& label, const std::vector<FullTextSearch::ElementHit>& hits)
+{
+    std::cout << label << ":";
+    for (const auto& hit : hits) {
+        std::cout << " " << hit.element_guid;
+    }
+    std::cout << std::endl;
+}
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_legalname     TEXT, "
+        "user_phonenumber   TEXT, "
+        "user_emailaddress  TEXT, "
+        "user_description   TEXT, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    UserDAO users(database);
+    users.insertRecord({ {"user_name", "mmartin"}, {"user_salt", "s1"}, {"user_passhash", "h1"}, {"user_legalname", "Maria Martinez"}, {"user_description", "Warehouse lead"} });
+    users.insertRecord({ {"user_name", "jmartel"}, {"user_salt", "s2"}, {"user_passhash", "h2"}, {"user_legalname", "Jean Martel"}, {"user_description", "Works with Maria on receiving"} });
+
+    //rows written before the index exists are picked up when it is created
+    database.executeQuery(
+        "INSERT INTO Element (element_guid, element_name, element_description, element_class, element_owner) "
+        "WITH RECURSIVE counter (value) AS (SELECT 200000 UNION ALL SELECT value + 1 FROM counter WHERE value < 299999) "
+        "SELECT printf('%06d', value), 'Bin ' || value, 'Spare parts for line ' || (value % 97), 5, 1 FROM counter;");
+
+    FullTextSearch search(database);
+    auto start = std::chrono::steady_clock::now();
+    search.createSearchTables();
+    std::cout << "Indexed existing rows in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+
+    printUserHits("mart", search.searchUsers("mart"));
+    printUserHits("maria", search.searchUsers("maria"));
+    printUserHits("ma re", search.searchUsers("ma re"));
+
+    //later writes reach the index through the triggers
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+    elements.insertRecord({ {"element_guid", "FT0001"}, {"element_name", "Cordless drill"}, {"element_description", "18V with spare battery"}, {"element_class", 6}, {"element_owner", 1} });
+    elements.insertRecord({ {"element_guid", "FT0002"}, {"element_name", "Battery charger"}, {"element_description", "Fits the cordless drill"}, {"element_class", 6}, {"element_owner", 1} });
+    printElementHits("drill", search.searchElements("drill"));
+    printElementHits("batt", search.searchElements("batt"));
+
+    nlohmann::json rename = { {"element_name", "Impact driver"} };
+    elements.updateRecordById(ElementDAO::getIdGivenGuid("FT0001").value(), rename);
+    printElementHits("drill after rename", search.searchElements("drill"));
+    printElementHits("impact", search.searchElements("impact"));
+
+    nlohmann::json hide = { {"user_visibility", 0} };
+    users.updateRecordById(2, hide);
+    printUserHits("mart after hiding user 2", search.searchUsers("mart"));
+
+    elements.deleteElement("FT0002", ElementDAO::DeletionContingency::CASCADE);
+    printElementHits("charger after delete", search.searchElements("charger"));
+
+    //the index is keyed by guid, compacting the database cannot point a hit at another element
+    database.executeQuery("DELETE FROM Element WHERE element_guid < '200100'; VACUUM;");
+    printElementHits("impact after vacuum", search.searchElements("impact"));
+
+    std::cout << "Query syntax searched literally: " << FullTextSearch::toMatchExpression("line \"7\" OR NEAR(") << std::endl;
+    std::cout << "Odd input matches nothing: " << search.searchElements("\"*)(").size() << std::endl;
+
+    //against the LIKE scan it replaces
+    start = std::chrono::steady_clock::now();
+    size_t ranked = search.searchElements("bin 29999").size();
+    double fts_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    database.prepareStatement("SELECT count(*) FROM Element WHERE element_name LIKE '%bin 29999%';");
+    sqlite3_stmt* prepared_statement = database.getPreparedStatement();
+    sqlite3_step(prepared_statement);
+    int scanned = sqlite3_column_int(prepared_statement, 0);
+    sqlite3_finalize(prepared_statement);
+    double like_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "FTS5 'bin 29999': " << ranked << " hits in " << fts_ms << " ms, LIKE: " << scanned << " hits in " << like_ms << " ms" << std::endl;
+    std::cout << "Rebuild: " << search.rebuild() << std::endl;
+    printElementHits("impact after rebuild", search.searchElements("impact"));
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_legalname     TEXT, "
+        "user_phonenumber   TEXT, "
+        "user_emailaddress  TEXT, "
+        "user_description   TEXT, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+
+    UserDAO user_export(database);
+
+    nlohmann::json user_data =
+    {
+        {"user_name", "export_user"},
+        {"user_salt", "salt"},
+        {"user_passhash", "hash"},
+        {"user_description", "quotes \" backslashes \\ and\na newline"}
+    };
+    user_export.insertRecord(user_data);
+
+    FILE* export_file = std::fopen("test_export.jsonl", "wb");
+    long long exported = user_export.exportTable("Users", fileno(export_file));
+    std::fclose(export_file);
+
+    std::cout << "Exported rows: " << exported << std::endl;
+
+    //every exported line parses back into the original values
+    std::ifstream exported_lines("test_export.jsonl");
+    std::string line;
+    while (std::getline(exported_lines, line)) {
+        nlohmann::json row = nlohmann::json::parse(line);
+        if (row["user_name"] == "export_user") {
+            std::cout << row.dump() << std::endl;
+            std::cout << "Description round trip: " << (row["user_description"] == user_data["user_description"]) << std::endl;
+        }
+    }
+
+    //unknown table reports failure
+    std::cout << "Exported rows: " << user_export.exportTable("NoSuchTable", fileno(stdout)) << std::endl;
+}
@@ -0,0 +1,59 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include <iostream>
+#include <sstream>
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_legalname     TEXT, "
+        "user_phonenumber   TEXT, "
+        "user_emailaddress  TEXT, "
+        "user_description   TEXT, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+
+    UserDAO user_ingestion(database);
+
+    //defaults apply to missing and null fields, unknown keys and their nested values are skipped
+    std::istringstream payload(R"([
+        {"user_name": "sax_user_1", "user_salt": "salt", "user_passhash": "hash", "unknown": {"nested": [1, 2]}},
+        {"user_name": "sax_user_2", "user_salt": "salt", "user_passhash": "hash", "user_permission": 3, "user_visibility": null},
+        {"user_name": "sax_user_3", "user_salt": "salt", "user_passhash": "hash", "user_permission": "ADMIN"},
+        {"user_name": "sax_user_4", "user_salt": "salt", "user_passhash": "hash", "user_description": ["nested"]},
+        {"user_name": "sax_user_1", "user_salt": "salt", "user_passhash": "hash"},
+        {"user_name": "sax_user_5", "user_passhash": "hash"}
+    ])");
+
+    JsonInsertSax::IngestReport report = user_ingestion.insertRecordsFromJson("Users", payload);
+    std::cout << "Inserted: " << report.records_inserted << " Rejected: " << report.records_rejected << std::endl;
+    for (const std::string& error : report.errors) {
+        std::cout << "  " << error << std::endl;
+    }
+
+    std::cout << user_ingestion.retrieveRecordById(user_ingestion.getIdGivenUsername("sax_user_2").value_or(-1)).dump() << std::endl;
+
+    //the defaulted timestamp is stored as epoch seconds like UserDAO writes it, not as CURRENT_TIMESTAMP text
+    database.prepareStatement("SELECT typeof(user_timestamp), abs(user_timestamp - CAST(strftime('%s', 'now') AS INTEGER)) < 60 FROM Users WHERE user_name = 'sax_user_1';");
+    sqlite3_stmt* timestamp_statement = database.getPreparedStatement();
+    if (sqlite3_step(timestamp_statement) == SQLITE_ROW) {
+        std::cout << "user_timestamp stored as " << sqlite3_column_text(timestamp_statement, 0) << ", current: " << sqlite3_column_int(timestamp_statement, 1) << std::endl;
+    }
+    sqlite3_finalize(timestamp_statement);
+
+    //malformed input rolls back every record of the document
+    std::istringstream truncated(R"([{"user_name": "sax_user_6", "user_salt": "salt", "user_passhash": "hash"}, {"user_name": )");
+    report = user_ingestion.insertRecordsFromJson("Users", truncated);
+    std::cout << "Inserted: " << report.records_inserted << " Rejected: " << report.records_rejected << std::endl;
+    std::cout << "sax_user_6 exists: " << user_ingestion.getIdGivenUsername("sax_user_6").has_value() << std::endl;
+}
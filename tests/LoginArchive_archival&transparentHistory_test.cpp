@@ -0,0 +1,59 @@
+#include "DatabaseManager.hpp"
+#include "LoginDAO.hpp"
+#include "LoginArchive.hpp"
+#include <iostream>
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Logins",
+        "login_id           INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "login_user         INTEGER     NOT NULL, "
+        "login_success      BOOLEAN     NOT NULL        DEFAULT 0, "
+        "login_timestamp    DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+
+    LoginDAO login_log(database);
+    login_log.createRollupTables();
+
+    LoginArchive login_archive(database, "test_archive.db");
+    login_log.setArchive(&login_archive);
+
+    const int start = 1700000000;
+    for (int index = 0; index < 1000; ++index)
+    {
+        nlohmann::json login_data =
+        {
+            {"login_user", std::to_string(1 + index % 3)},
+            {"login_success", index % 4 == 0 ? 1 : 0},
+            {"login_timestamp", start + index * 30}
+        };
+        login_log.insertRecord(login_data);
+    }
+
+    std::cout << "Before archival: " << login_log.countLoginsInRange(1, start, start + 30000).dump() << std::endl;
+
+    //archive the first 800 logins in segments of 256 rows
+    std::cout << "Archived rows: " << login_archive.archiveOlderThan(start + 800 * 30, 256) << std::endl;
+
+    //counts and history are unchanged by archival
+    std::cout << "After archival: " << login_log.countLoginsInRange(1, start, start + 30000).dump() << std::endl;
+    std::cout << "History entries for user 1: " << login_log.retrieveLoginHistory(1, start, start + 30000).size() << std::endl;
+    std::cout << "History around the horizon: " << login_log.retrieveLoginHistory(2, start + 790 * 30, start + 806 * 30).dump() << std::endl;
+
+    //id 5 comes from the archive, id 900 from the hot table
+    std::cout << login_log.retrieveRecordById(5).dump() << std::endl;
+    std::cout << login_log.retrieveRecordById(900).dump() << std::endl;
+
+    //a corrupt segment claiming four billion rows is rejected without sizing its columns
+    LoginArchive::LoginSegment corrupt;
+    const unsigned char corrupt_data[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x0F, 0x02, 0x02, 0x02 };
+    std::cout << "Corrupt segment decoded: " << LoginArchive::decodeSegment(corrupt_data, sizeof(corrupt_data), corrupt)
+        << ", rows allocated: " << corrupt.login_ids.capacity() << std::endl;
+
+    //a second run has nothing left to move
+    std::cout << "Archived rows: " << login_archive.archiveOlderThan(start + 800 * 30, 256) << std::endl;
+}
@@ -0,0 +1,59 @@
+#include "DatabaseManager.hpp"
+#include "LoginDAO.hpp"
+#include <iostream>
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Logins",
+        "login_id           INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "login_user         INTEGER     NOT NULL, "
+        "login_success      BOOLEAN     NOT NULL        DEFAULT 0, "
+        "login_timestamp    DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+
+    LoginDAO login_log(database);
+
+    //history recorded before the rollups existed, a success every 2 hours on the previous day for user 3
+    const int previous_day = 1700006400 - 86400;
+    for (int offset = 0; offset < 24 * 60 * 60; offset += 2 * 60 * 60)
+    {
+        login_log.insertRecord({ {"login_user", "3"}, {"login_success", 1}, {"login_timestamp", previous_day + offset} });
+    }
+
+    login_log.createRollupTables();
+
+    //one day of history for user 1, a failed attempt every 10 minutes and a success every hour
+    const int day_start = 1700006400; //a UTC midnight
+    for (int offset = 0; offset < 24 * 60 * 60; offset += 10 * 60)
+    {
+        nlohmann::json login_data =
+        {
+            {"login_user", "1"},
+            {"login_success", offset % 3600 == 0 ? 1 : 0},
+            {"login_timestamp", day_start + offset + 7}
+        };
+        login_log.insertRecord(login_data);
+    }
+
+    //whole day is answered from the day bucket, expect 24 successes and 120 failures
+    std::cout << login_log.countLoginsInRange(1, day_start, day_start + 86400).dump() << std::endl;
+
+    //unaligned range mixing hour, minute and raw edges, expect 2 successes and 10 failures
+    std::cout << login_log.countLoginsInRange(1, day_start + 3600 + 5, day_start + 3 * 3600 + 5).dump() << std::endl;
+
+    //sub minute range only touching the raw table, expect 1 failure
+    std::cout << login_log.countLoginsInRange(1, day_start + 600, day_start + 610).dump() << std::endl;
+
+    //history is counted by the rollups created after it, expect 12 successes for the day and 2 for an unaligned range
+    std::cout << login_log.countLoginsInRange(3, previous_day, previous_day + 86400).dump() << std::endl;
+    std::cout << login_log.countLoginsInRange(3, previous_day + 1, previous_day + 4 * 3600 + 1).dump() << std::endl;
+
+    //unknown user, expect zeros
+    std::cout << login_log.countLoginsInRange(2, day_start, day_start + 86400).dump() << std::endl;
+
+    std::cout << login_log.retrieveRollupSeries(1, LoginDAO::RollupGranularity::HOUR, day_start, day_start + 3 * 3600).dump() << std::endl;
+}
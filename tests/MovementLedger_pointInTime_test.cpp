@@ -0,0 +1,173 @@
+#include "DatabaseManager.hpp"
+#include "ElementDAO.hpp"
+#include "MovementLedger.hpp"
+#include <iostream>
+#include <chrono>
+
+void printContents(const std::string& label, const std::vector<std::string>& contents)
+{
+    std::cout << label << ":";
+    for (const std::string& guid : contents) {
+        std::cout << " " << guid;
+    }
+    std::cout << std::endl;
+}
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Element",
+        "element_guid           TEXT        PRIMARY KEY     CHECK(length(element_guid) = 6), "
+        "element_name           TEXT        NOT NULL, "
+        "element_description    TEXT, "
+        "element_class          INTEGER     NOT NULL, "
+        "element_parent_guid    TEXT, "
+        "element_owner          INTEGER     NOT NULL, "
+        "element_thumbpath      TEXT, "
+        "element_visibility     BOOLEAN     NOT NULL        DEFAULT 1, "
+        "element_timestamp      DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP, "
+        "FOREIGN KEY (element_parent_guid) REFERENCES Element(element_guid) ON DELETE CASCADE, "
+        "FOREIGN KEY (element_owner) REFERENCES Users(user_id)"
+    );
+
+    database.createTableIfNotExists("Users", "user_id INTEGER PRIMARY KEY, user_permission INTEGER NOT NULL, user_visibility BOOLEAN NOT NULL");
+    database.executeQuery("INSERT INTO Users (user_id, user_permission, user_visibility) VALUES (1, 1, 1), (2, 1, 1);");
+
+    ElementDAO elements(database);
+    elements.createHierarchyTables();
+    elements.createStockTables();
+
+    //a snapshot every 4 events so the queries below start from one
+    MovementLedger ledger(database, 4);
+    ledger.createLedgerTables();
+    ledger.load();
+    ledger.setTimestamp(1);
+    ledger.setActingUser(7);
+
+    const char* rows[][4] =
+    {
+        {"MR0001", "Storeroom", "1", ""},
+        {"MS0001", "Shelf A", "4", "MR0001"},
+        {"MS0002", "Shelf B", "4", "MR0001"},
+        {"MB0001", "Drill case", "5", "MS0001"},
+        {"MB0002", "Bolt bin", "7", "MS0001"}
+    };
+    for (const auto& row : rows)
+    {
+        nlohmann::json element_data = { {"element_guid", row[0]}, {"element_name", row[1]}, {"element_class", std::stoi(row[2])}, {"element_owner", 1} };
+        if (row[3][0] != '\0') {
+            element_data["element_parent_guid"] = row[3];
+        }
+        elements.insertRecord(element_data);
+    }
+    elements.setQuantity("MB0002", "M6 bolt", 500);
+
+    ledger.setTimestamp(2);
+    elements.moveElement("MB0001", std::string("MS0002"));
+    elements.adjustQuantity("MB0002", "M6 bolt", -120);
+
+    ledger.setTimestamp(3);
+    elements.transferOwnership("MB0001", 2, 1);
+    elements.moveElement("MB0002", std::string("MS0002"));
+
+    ledger.setTimestamp(4);
+    elements.deleteElement("MB0001", ElementDAO::DeletionContingency::CASCADE);
+
+    //a write that rolls back leaves no event, one through another connection is recorded all the same
+    database.beginTransaction();
+    elements.moveElement("MB0002", std::string("MS0001"));
+    database.rollbackTransaction();
+    {
+        DatabaseManager other_connection("test_database.db");
+        ElementDAO other_elements(other_connection);
+        other_elements.insertRecord({ {"element_guid", "MB0003"}, {"element_name", "Glue"}, {"element_class", 4}, {"element_owner", 1}, {"element_parent_guid", "MS0002"} });
+    }
+    printContents("Shelf B after other writers", ledger.currentState().contentsOf("MS0002"));
+
+    printContents("Shelf A on day 1", ledger.contentsAt("MS0001", 1));
+    printContents("Shelf A on day 2", ledger.contentsAt("MS0001", 2));
+    printContents("Shelf B on day 3", ledger.contentsAt("MS0002", 3));
+    printContents("Shelf B on day 4", ledger.contentsAt("MS0002", 4));
+    printContents("Shelf B now", ledger.currentState().contentsOf("MS0002"));
+
+    auto day_two = ledger.stateAt(2);
+    std::cout << "Bolts on day 1: " << ledger.stateAt(1)->find("MB0002")->quantities.at("M6 bolt")
+        << ", day 2: " << day_two->find("MB0002")->quantities.at("M6 bolt") << std::endl;
+    std::cout << "Drill case owner on day 2: " << day_two->find("MB0001")->owner
+        << ", day 3: " << ledger.stateAt(3)->find("MB0001")->owner << std::endl;
+
+    std::cout << "History of MB0001:";
+    for (const auto& movement : ledger.retrieveHistory("MB0001")) {
+        std::cout << " [" << movement.movement_id << " day " << movement.timestamp << " kind " << static_cast<int>(movement.kind)
+            << " from " << movement.previous_parent.value_or("-") << " to " << movement.parent.value_or("-") << " by " << movement.user << "]";
+    }
+    std::cout << std::endl;
+
+    //the ledger cannot be rewritten
+    std::cout << "Update refused: " << !database.tryExecuteQuery("UPDATE Movements SET movement_timestamp = 0;") << std::endl;
+    std::cout << "Delete refused: " << !database.tryExecuteQuery("DELETE FROM Movements;") << std::endl;
+
+    //a restarted ledger comes back to the same state
+    MovementLedger restarted(database, 4);
+    restarted.load();
+    std::cout << "Reloaded state matches: " << (restarted.currentState().serialize() == ledger.currentState().serialize()) << std::endl;
+
+    //a transfer of a whole subtree is recorded inside its own transaction
+    int before_transfer = static_cast<int>(ledger.retrieveHistory("MB0002").size());
+    elements.transferOwnership("MR0001", 2, 1);
+    std::cout << "Transfer recorded: " << ledger.retrieveHistory("MB0002").size() - before_transfer
+        << ", owner now: " << ledger.currentState().find("MB0003")->owner << std::endl;
+
+    //a long history where a late query replays from a snapshot instead of the start
+    MovementLedger busy(database, 1000);
+    busy.load();
+    const int events = 200000;
+    auto start = std::chrono::steady_clock::now();
+    database.beginTransaction();
+    for (int event = 0; event < events; ++event) {
+        MovementLedger::Movement movement;
+        movement.timestamp = 10 + event / 100;
+        movement.kind = MovementLedger::MovementKind::MOVE;
+        movement.element_guid = "MB0002";
+        movement.parent = (event % 2 == 0) ? "MS0001" : "MS0002";
+        movement.user = 7;
+        busy.append(movement);
+    }
+    database.commitTransaction();
+    double append_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / events;
+    std::cout << "Average append: " << (append_us < 50.0 ? "under 50 us" : "slow") << std::endl;
+    busy.refresh();
+
+    start = std::chrono::steady_clock::now();
+    auto late = busy.stateAt(10 + (events - 1) / 100);
+    double snapshot_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    MovementLedger::InventoryState replayed;
+    database.prepareStatement("SELECT movement_kind, movement_element, movement_to, movement_owner, movement_key, movement_quantity FROM Movements ORDER BY movement_id;");
+    sqlite3_stmt* prepared_statement = database.getPreparedStatement();
+    while (sqlite3_step(prepared_statement) == SQLITE_ROW) {
+        MovementLedger::Movement movement;
+        movement.kind = static_cast<MovementLedger::MovementKind>(sqlite3_column_int(prepared_statement, 0));
+        movement.element_guid = reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 1));
+        if (sqlite3_column_type(prepared_statement, 2) != SQLITE_NULL) {
+            movement.parent = std::string(reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 2)));
+        }
+        movement.owner = sqlite3_column_int(prepared_statement, 3);
+        if (sqlite3_column_type(prepared_statement, 4) != SQLITE_NULL) {
+            movement.stock_key = reinterpret_cast<const char*>(sqlite3_column_text(prepared_statement, 4));
+        }
+        movement.quantity = sqlite3_column_double(prepared_statement, 5);
+        replayed.apply(movement);
+    }
+    sqlite3_finalize(prepared_statement);
+    double full_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Late state matches full replay: " << (late->serialize() == replayed.serialize())
+        << ", from snapshot " << snapshot_ms << " ms, full replay " << full_ms << " ms" << std::endl;
+
+    return 0;
+}
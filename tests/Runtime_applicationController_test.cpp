@@ -0,0 +1,167 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include "PasswordSecurity.hpp"
+#include "Runtime.hpp"
+#include <iostream>
+#include <chrono>
+
+int main()
+{
+    {
+        DatabaseManager database("test_database.db");
+        database.createTableIfNotExists
+        (
+            "Users",
+            "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+            "user_name          TEXT        NOT NULL        UNIQUE,"
+            "user_salt          TEXT        NOT NULL, "
+            "user_passhash      TEXT        NOT NULL, "
+            "user_legalname     TEXT, "
+            "user_phonenumber   TEXT, "
+            "user_emailaddress  TEXT, "
+            "user_description   TEXT, "
+            "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+            "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+            "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+        );
+    }
+
+    //tasks that fan out from inside the pool are stolen by idle workers
+    {
+        ThreadPool pool(4);
+        std::vector<std::future<std::future<int>>> outer;
+        for (int burst = 0; burst < 4; ++burst) {
+            outer.push_back(pool.submit([&pool] {
+                return pool.submit([] {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    return 1;
+                });
+            }));
+        }
+        std::vector<std::future<int>> fanned;
+        for (int task = 0; task < 200; ++task) {
+            fanned.push_back(pool.submit([] { std::this_thread::sleep_for(std::chrono::microseconds(200)); return 1; }));
+        }
+        int total = 0;
+        for (auto& future : outer) {
+            total += future.get().get();
+        }
+        for (auto& future : fanned) {
+            total += future.get();
+        }
+        std::cout << "Pool ran " << total << " tasks, pending " << pool.pendingTasks() << std::endl;
+    }
+
+    SessionManager sessions;
+    std::string base = sessions.createSession(1, UserDAO::UserPermission::BASE);
+    std::string admin = sessions.createSession(2, UserDAO::UserPermission::ADMIN);
+
+    {
+        ApplicationController controller(sessions, "test_database.db", 4, 4);
+
+        controller.registerCommand("whoami", Capabilities::NONE, ApplicationController::Workload::COMPUTE,
+            [](ApplicationController::CommandContext& context) {
+                return ApplicationController::CommandResult{ true, context.session.user_id, "" };
+            });
+
+        //salting and hashing on the compute stage, the insert on the writer
+        controller.registerCommand("hash", Capabilities::MANAGE_USERS, ApplicationController::Workload::COMPUTE,
+            [](ApplicationController::CommandContext& context) {
+                std::string salt = PasswordSecurity::generate_salt();
+                return ApplicationController::CommandResult{ true, { {"salt", salt}, {"hash", PasswordSecurity::hash_password(std::string(context.arguments.at(1)), salt)} }, "" };
+            });
+        controller.registerCommand("adduser", Capabilities::MANAGE_USERS, ApplicationController::Workload::WRITE,
+            [](ApplicationController::CommandContext& context) {
+                UserDAO users(*context.database);
+                bool inserted = users.insertRecord({ {"user_name", context.arguments.at(1)}, {"user_salt", context.arguments.at(2)}, {"user_passhash", context.arguments.at(3)} });
+                return ApplicationController::CommandResult{ inserted, nullptr, inserted ? "" : "insert failed" };
+            });
+        controller.registerCommand("countusers", Capabilities::VIEW_USERS, ApplicationController::Workload::READ,
+            [](ApplicationController::CommandContext& context) {
+                context.database->prepareStatement("SELECT count(*) FROM Users;");
+                sqlite3_stmt* prepared_statement = context.database->getPreparedStatement();
+                int count = sqlite3_step(prepared_statement) == SQLITE_ROW ? sqlite3_column_int(prepared_statement, 0) : -1;
+                sqlite3_finalize(prepared_statement);
+                return ApplicationController::CommandResult{ true, count, "" };
+            });
+
+        std::cout << "whoami: " << controller.execute(admin, "whoami").get().output << std::endl;
+        std::cout << "Unknown command: " << controller.execute(admin, "frobnicate").get().error << std::endl;
+        std::cout << "Base user adding: " << controller.execute(base, "adduser eve s h").get().error << std::endl;
+        std::cout << "Bad token: " << controller.execute("nope", "whoami").get().error << std::endl;
+        std::string quoted = "adduser \"Mary \"\"Mo\"\" Lee\" salt hash";
+        std::cout << "Quoted words: " << tokenizeInPlace(quoted).at(1) << std::endl;
+
+        //hash in parallel, then write each user through the one writer while readers keep counting
+        const int users = 400;
+        std::vector<std::future<ApplicationController::CommandResult>> hashes;
+        for (int user = 0; user < users; ++user) {
+            hashes.push_back(controller.execute(admin, "hash password" + std::to_string(user)));
+        }
+        std::vector<std::future<ApplicationController::CommandResult>> writes;
+        std::vector<std::future<ApplicationController::CommandResult>> reads;
+        for (int user = 0; user < users; ++user) {
+            ApplicationController::CommandResult hashed = hashes[user].get();
+            writes.push_back(controller.execute(admin, "adduser user" + std::to_string(user) + " " +
+                hashed.output["salt"].get<std::string>() + " " + hashed.output["hash"].get<std::string>()));
+            reads.push_back(controller.execute(base, "countusers"));
+        }
+        int written = 0;
+        for (auto& write : writes) {
+            written += write.get().success;
+        }
+        bool counts_valid = true;
+        for (auto& read : reads) {
+            ApplicationController::CommandResult counted = read.get();
+            counts_valid = counts_valid && counted.success && counted.output.get<int>() >= 0 && counted.output.get<int>() <= users;
+        }
+        std::cout << "Written: " << written << ", reads valid: " << counts_valid << ", final count: "
+            << controller.execute(base, "countusers").get().output << std::endl;
+
+        //a stage counts a task once its body returns, just after the future was completed
+        auto settled = [&controller] {
+            for (const auto& stage : controller.metrics()) {
+                if (stage.completed != stage.submitted) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        while (!settled()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        for (const auto& stage : controller.metrics()) {
+            std::cout << ApplicationController::stageName(stage.stage) << ": submitted " << stage.submitted << ", completed " << stage.completed
+                << ", failed " << stage.failed << ", queued " << stage.queued << std::endl;
+        }
+
+        //a role change made by a handler through its own UserDAO reaches the open sessions once it commits
+        controller.registerCommand("setrole", Capabilities::MANAGE_USERS, ApplicationController::Workload::WRITE,
+            [](ApplicationController::CommandContext& context) {
+                UserDAO users(*context.database);
+                nlohmann::json role = { {"user_permission", std::stoi(std::string(context.arguments.at(2)))} };
+                bool updated = users.updateRecordById(std::stoi(std::string(context.arguments.at(1))), role);
+                return ApplicationController::CommandResult{ updated, nullptr, updated ? "" : "update failed" };
+            });
+        std::string manager = sessions.createSession(3, UserDAO::UserPermission::ADMIN);
+        std::string locked = sessions.createSession(4, UserDAO::UserPermission::BASE);
+        std::cout << "Manager demoted: " << controller.execute(admin, "setrole 3 1").get().success
+            << ", manager adding: " << controller.execute(manager, "adduser mallory s h").get().error << std::endl;
+        std::cout << "User locked: " << controller.execute(admin, "setrole 4 0").get().success
+            << ", locked user: " << controller.execute(locked, "whoami").get().error << std::endl;
+
+        //a conflict resolved with ROLLBACK ends the whole group, a promotion made earlier in it
+        //never reaches the sessions
+        controller.registerCommand("conflict", Capabilities::MANAGE_USERS, ApplicationController::Workload::WRITE,
+            [](ApplicationController::CommandContext& context) {
+                bool inserted = context.database->tryExecuteQuery("INSERT OR ROLLBACK INTO Users (user_name, user_salt, user_passhash) VALUES ('user0', 's', 'h');");
+                return ApplicationController::CommandResult{ inserted, nullptr, inserted ? "" : "name taken" };
+            });
+        std::string promoted = sessions.createSession(5, UserDAO::UserPermission::BASE);
+        auto group = controller.executeTransaction(admin, { "setrole 5 3", "conflict" });
+        std::cout << "Promotion in rolled back group: " << group[0].get().error << ", " << group[1].get().error
+            << "; promoted adding: " << controller.execute(promoted, "adduser eve s h").get().error << std::endl;
+    }
+
+    return 0;
+}
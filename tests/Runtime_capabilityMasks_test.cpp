@@ -0,0 +1,85 @@
+#include "DatabaseManager.hpp"
+#include "UserDAO.hpp"
+#include "Runtime.hpp"
+#include <iostream>
+#include <chrono>
+
+//what a few commands would declare
+constexpr uint32_t list_elements = Capabilities::VIEW_ELEMENTS;
+constexpr uint32_t rename_category = Capabilities::VIEW_ELEMENTS | Capabilities::MANAGE_CATEGORIES;
+constexpr uint32_t delete_element = Capabilities::EDIT_ALL_ELEMENTS | Capabilities::DELETE_ELEMENTS;
+
+static_assert(Capabilities::grants(Capabilities::ofPermission(UserDAO::UserPermission::ADMIN), delete_element), "admins delete");
+static_assert(!Capabilities::grants(Capabilities::ofPermission(UserDAO::UserPermission::SUPER), delete_element), "supervisors do not");
+
+int main()
+{
+    DatabaseManager database("test_database.db");
+
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_legalname     TEXT, "
+        "user_phonenumber   TEXT, "
+        "user_emailaddress  TEXT, "
+        "user_description   TEXT, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+        "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+    );
+
+    UserDAO users(database);
+    users.insertRecord({ {"user_name", "base"}, {"user_salt", "s1"}, {"user_passhash", "h1"} });
+    users.insertRecord({ {"user_name", "super"}, {"user_salt", "s2"}, {"user_passhash", "h2"}, {"user_permission", 2} });
+
+    SessionManager sessions;
+    users.addObserver(&sessions);
+    std::string base = sessions.createSession(1, UserDAO::UserPermission::BASE);
+    std::string base_other_device = sessions.createSession(1, UserDAO::UserPermission::BASE);
+    std::string super = sessions.createSession(2, UserDAO::UserPermission::SUPER);
+
+    std::cout << "Base lists: " << sessions.authorize(base, list_elements) << ", renames category: " << sessions.authorize(base, rename_category) << std::endl;
+    std::cout << "Super renames category: " << sessions.authorize(super, rename_category) << ", deletes: " << sessions.authorize(super, delete_element) << std::endl;
+
+    //promotion through the DAO reaches both open sessions without a new login
+    nlohmann::json promote = { {"user_permission", 3} };
+    users.updateRecordById(1, promote);
+    std::cout << "Promoted deletes: " << sessions.authorize(base, delete_element) << ", other device: " << sessions.authorize(base_other_device, delete_element) << std::endl;
+
+    nlohmann::json demote = { {"user_permission", 1} };
+    users.updateRecordById(1, demote);
+    std::cout << "Demoted deletes: " << sessions.authorize(base, delete_element) << ", still lists: " << sessions.authorize(base, list_elements) << std::endl;
+
+    nlohmann::json lock = { {"user_permission", 0} };
+    users.updateRecordById(1, lock);
+    std::cout << "Locked user logged out: " << !sessions.validate(base).has_value() << " " << !sessions.validate(base_other_device).has_value() << std::endl;
+
+    users.deleteRecordById(2);
+    std::cout << "Hidden user logged out: " << !sessions.validate(super).has_value() << ", sessions left: " << sessions.size() << std::endl;
+
+    //per command check against the database read it replaces
+    std::string admin = sessions.createSession(3, UserDAO::UserPermission::ADMIN);
+    const int checks = 100000;
+    int granted = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int check = 0; check < checks; ++check) {
+        granted += sessions.authorize(admin, delete_element);
+    }
+    double mask_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / checks;
+
+    start = std::chrono::steady_clock::now();
+    for (int check = 0; check < checks / 10; ++check) {
+        database.prepareStatement("SELECT user_permission = 3 FROM Users WHERE user_id = ?;");
+        database.bindParameter<int>(1, 2);
+        granted += database.fetchBooleanResult();
+    }
+    double query_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / (checks / 10);
+
+    std::cout << "Granted: " << granted << ", mask check faster than a query: " << (mask_us < query_us) << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "Runtime.hpp"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+int main()
+{
+    //a manual clock in seconds so idle expiry can be stepped through
+    int64_t now = 1000;
+    SessionManager sessions(std::chrono::minutes(30));
+    sessions.setClock([&now] { return now; });
+
+    std::string alice = sessions.createSession(1, UserDAO::UserPermission::BASE);
+    std::string admin = sessions.createSession(2, UserDAO::UserPermission::ADMIN);
+    std::cout << "Token length: " << alice.size() << ", distinct: " << (alice != admin) << std::endl;
+    std::cout << "Locked user refused: " << sessions.createSession(3, UserDAO::UserPermission::LOCK).empty() << std::endl;
+
+    auto found = sessions.validate(admin);
+    std::cout << "Admin session: user " << found->user_id << ", admin " << (found->permission == UserDAO::UserPermission::ADMIN) << std::endl;
+    std::cout << "Unknown token: " << !sessions.validate("00000000000000000000000000000000").has_value() << std::endl;
+
+    //alice stays active, the admin goes idle
+    now += 20 * 60;
+    sessions.validate(alice);
+    now += 15 * 60;
+    std::cout << "Expired after 35 min: " << sessions.collectExpired() << ", alice live: " << sessions.validate(alice).has_value()
+        << ", admin live: " << sessions.validate(admin).has_value() << std::endl;
+
+    now += 31 * 60;
+    std::cout << "Expired after alice idles: " << sessions.collectExpired() << ", remaining: " << sessions.size() << std::endl;
+
+    //a long absence far past the lowest wheel levels still fires every timer once
+    for (int user = 0; user < 1000; ++user) {
+        sessions.createSession(100 + user, UserDAO::UserPermission::BASE);
+    }
+    std::string bob = sessions.createSession(5, UserDAO::UserPermission::SUPER);
+    std::cout << "Logout: " << sessions.endSession(bob) << ", again: " << sessions.endSession(bob) << std::endl;
+    std::string carol = sessions.createSession(6, UserDAO::UserPermission::BASE);
+    sessions.createSession(6, UserDAO::UserPermission::BASE);
+    std::cout << "Ended user 6 sessions: " << sessions.endUserSessions(6) << ", carol live: " << sessions.validate(carol).has_value() << std::endl;
+    now += 7 * 24 * 3600;
+    std::cout << "Expired after a week: " << sessions.collectExpired() << ", remaining: " << sessions.size() << std::endl;
+
+    //concurrent permission checks over a shared population of sessions
+    std::vector<std::string> tokens;
+    for (int user = 0; user < 10000; ++user) {
+        tokens.push_back(sessions.createSession(user, UserDAO::UserPermission::BASE));
+    }
+    const size_t thread_count = std::max<size_t>(2, std::thread::hardware_concurrency());
+    const size_t lookups = 200000;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> valid{ 0 };
+    auto start = std::chrono::steady_clock::now();
+    for (size_t thread = 0; thread < thread_count; ++thread) {
+        threads.emplace_back([&, thread] {
+            size_t local = 0;
+            for (size_t lookup = 0; lookup < lookups; ++lookup) {
+                local += sessions.validate(tokens[(lookup * 7919 + thread) % tokens.size()]).has_value();
+            }
+            valid += local;
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "All lookups valid: " << (valid == thread_count * lookups) << ", average lookup: "
+        << (elapsed_ms * 1000.0 / lookups < 5.0 ? "under 5 us" : "slow") << std::endl;
+
+    //the background thread expires sessions without being asked
+    now += 3600;
+    sessions.startMaintenance(std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    sessions.stopMaintenance();
+    std::cout << "Remaining after maintenance: " << sessions.size() << std::endl;
+
+    return 0;
+}
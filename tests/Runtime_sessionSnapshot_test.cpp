@@ -0,0 +1,115 @@
+#include "DatabaseManager.hpp"
+#include "Runtime.hpp"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+
+int main()
+{
+    const std::string path = "sessions.snapshot";
+    std::filesystem::remove(path);
+
+    DatabaseManager database("test_snapshot.db");
+    database.createTableIfNotExists
+    (
+        "Users",
+        "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+        "user_name          TEXT        NOT NULL        UNIQUE,"
+        "user_salt          TEXT        NOT NULL, "
+        "user_passhash      TEXT        NOT NULL, "
+        "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+        "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1"
+    );
+    database.executeQuery("DELETE FROM Users;");
+    database.executeQuery(
+        "WITH RECURSIVE n(id) AS (SELECT 1 UNION ALL SELECT id + 1 FROM n WHERE id < 100099) "
+        "INSERT INTO Users (user_id, user_name, user_salt, user_passhash) SELECT id, 'user' || id, 's', 'h' FROM n WHERE id <= 2 OR id >= 100;");
+    database.executeQuery("UPDATE Users SET user_permission = 3 WHERE user_id = 2;");
+
+    int64_t now = 5000;
+    std::string alice;
+    std::string admin;
+    {
+        SessionManager sessions(std::chrono::minutes(30));
+        sessions.setClock([&now] { return now; });
+        alice = sessions.createSession(1, UserDAO::UserPermission::BASE);
+        now += 29 * 60;
+        admin = sessions.createSession(2, UserDAO::UserPermission::ADMIN);
+        for (int user = 0; user < 100000; ++user) {
+            sessions.createSession(100 + user, UserDAO::UserPermission::BASE);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::cout << "Saved: " << sessions.saveSnapshot(path) << " in "
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms, "
+            << std::filesystem::file_size(path) << " bytes" << std::endl;
+    }
+
+    //the snapshot holds live tokens and is readable by its owner only
+    const std::filesystem::perms others = std::filesystem::perms::group_all | std::filesystem::perms::others_all;
+    std::cout << "Owner only: " << ((std::filesystem::status(path).permissions() & others) == std::filesystem::perms::none) << std::endl;
+
+    //while the process was down one user was hidden, one locked and one deleted
+    database.executeQuery("UPDATE Users SET user_visibility = 0 WHERE user_id = 100;");
+    database.executeQuery("UPDATE Users SET user_permission = 0 WHERE user_id = 101;");
+    database.executeQuery("DELETE FROM Users WHERE user_id = 102;");
+
+    //after the restart the same tokens are still logged in with their idle time carried over
+    SessionManager restarted(std::chrono::minutes(30));
+    int64_t later = 90000;
+    restarted.setClock([&later] { return later; });
+    auto start = std::chrono::steady_clock::now();
+    auto restored = restarted.loadSnapshot(path, database);
+    std::cout << "Restored: " << restored.value_or(0) << " in "
+        << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms" << std::endl;
+
+    auto found = restarted.validate(admin);
+    std::cout << "Admin still logged in: " << found.has_value() << ", admin " << (found->permission == UserDAO::UserPermission::ADMIN) << std::endl;
+
+    //a demotion made while down applies to the restored session and not the role stored in the file
+    std::string demoted;
+    {
+        SessionManager sessions(std::chrono::minutes(30));
+        sessions.setClock([&later] { return later; });
+        demoted = sessions.createSession(2, UserDAO::UserPermission::ADMIN);
+        sessions.saveSnapshot("demoted.snapshot");
+    }
+    database.executeQuery("UPDATE Users SET user_permission = 1 WHERE user_id = 2;");
+    SessionManager demoting;
+    demoting.setClock([&later] { return later; });
+    demoting.loadSnapshot("demoted.snapshot", database);
+    std::cout << "Demoted while down: " << (demoting.validate(demoted)->permission == UserDAO::UserPermission::BASE) << std::endl;
+    database.executeQuery("UPDATE Users SET user_permission = 3 WHERE user_id = 2;");
+    std::filesystem::remove("demoted.snapshot");
+    later += 2 * 60;
+    std::cout << "Alice expires on schedule: " << (restarted.collectExpired() >= 1) << ", alice live: " << restarted.validate(alice).has_value()
+        << ", admin live: " << restarted.validate(admin).has_value() << std::endl;
+
+    //a flipped byte, a short file and a foreign file are all refused
+    std::vector<char> bytes(std::filesystem::file_size(path));
+    std::ifstream(path, std::ios::binary).read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+    bytes[100] ^= 0x40;
+    std::ofstream("corrupt.snapshot", std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    SessionManager checking;
+    std::cout << "Corrupt refused: " << !checking.loadSnapshot("corrupt.snapshot", database).has_value() << std::endl;
+    std::ofstream("corrupt.snapshot", std::ios::binary | std::ios::trunc).write(bytes.data(), 40);
+    std::cout << "Truncated refused: " << !checking.loadSnapshot("corrupt.snapshot", database).has_value() << std::endl;
+    std::ofstream("corrupt.snapshot", std::ios::binary | std::ios::trunc) << "not a snapshot at all, just some text";
+    std::cout << "Foreign refused: " << !checking.loadSnapshot("corrupt.snapshot", database).has_value() << std::endl;
+    std::cout << "Missing file: " << !checking.loadSnapshot("missing.snapshot", database).has_value() << ", sessions: " << checking.size() << std::endl;
+
+    //the maintenance thread keeps the snapshot current and writes a last one when stopped
+    std::filesystem::remove(path);
+    restarted.setSnapshotFile(path, std::chrono::seconds(3600));
+    restarted.startMaintenance(std::chrono::milliseconds(10));
+    restarted.endSession(admin);
+    restarted.stopMaintenance();
+    SessionManager reloaded;
+    reloaded.setClock([&later] { return later; });
+    std::cout << "Snapshot on stop: " << reloaded.loadSnapshot(path, database).value_or(0) << ", admin live: " << reloaded.validate(admin).has_value() << std::endl;
+
+    std::filesystem::remove(path);
+    std::filesystem::remove("corrupt.snapshot");
+    return 0;
+}
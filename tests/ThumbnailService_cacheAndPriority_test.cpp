@@ -0,0 +1,176 @@
+#include "ThumbnailService.hpp"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
+
+//a 1024 x 768 gradient tinted by seed
+void writeImage(const std::string& path, int seed)
+{
+    Image image;
+    image.width = 1024;
+    image.height = 768;
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height * 3);
+    for (uint32_t y = 0; y < image.height; ++y) {
+        for (uint32_t x = 0; x < image.width; ++x) {
+            uint8_t* pixel = &image.pixels[(static_cast<size_t>(y) * image.width + x) * 3];
+            pixel[0] = static_cast<uint8_t>(x / 4);
+            pixel[1] = static_cast<uint8_t>(y / 3);
+            pixel[2] = static_cast<uint8_t>(seed * 7);
+        }
+    }
+    std::ofstream output(path, std::ios::binary);
+    PpmDecoder::write(output, image, "test image");
+}
+
+//a one line text file "solid r g b" decoded as an 8 x 8 image, standing in for a library decoder
+class SolidDecoder : public ImageDecoder {
+public:
+    std::optional<Image> decode(const std::string& path) override
+    {
+        std::ifstream input(path);
+        std::string word;
+        int r = 0, g = 0, b = 0;
+        if (!(input >> word >> r >> g >> b) || word != "solid") {
+            return std::nullopt;
+        }
+        Image image;
+        image.width = 8;
+        image.height = 8;
+        for (int i = 0; i < 64; ++i) {
+            image.pixels.insert(image.pixels.end(), { static_cast<uint8_t>(r), static_cast<uint8_t>(g), static_cast<uint8_t>(b) });
+        }
+        return image;
+    }
+};
+
+//collects ready callbacks in order, as the GUI thread would through CallAfter
+struct ReadyLog
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::string> order;
+
+    void record(const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(path);
+        changed.notify_all();
+    }
+
+    void waitFor(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait_for(lock, std::chrono::seconds(30), [this, count] { return order.size() >= count; });
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.clear();
+    }
+};
+
+int main()
+{
+    namespace fs = std::filesystem;
+    const fs::path root = fs::temp_directory_path() / "thumbnail_service_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "images");
+
+    const int images = 40;
+    std::vector<std::string> paths;
+    for (int i = 0; i < images; ++i) {
+        paths.push_back((root / "images" / ("image" + std::to_string(i) + ".ppm")).string());
+        writeImage(paths.back(), i);
+    }
+    std::string solid = (root / "images" / "solid.txt").string();
+    std::ofstream(solid) << "solid 10 200 30\n";
+    std::string broken = (root / "images" / "broken.bin").string();
+    std::ofstream(broken) << "not an image";
+
+    Image small = ThumbnailService::downscale({ 4, 2, { 0,0,0, 100,100,100, 200,200,200, 50,50,50, 0,0,0, 100,100,100, 200,200,200, 50,50,50 } }, 2);
+    std::cout << "Downscaled 4x2 to " << small.width << "x" << small.height << ", first pixel " << int(small.pixels[0]) << std::endl;
+
+    ReadyLog log;
+    double cold_ms = 0.0;
+    {
+        //one worker, so the order requests are served in is the order of their priority
+        ThumbnailService service((root / "cache").string(), 128, 64u << 20, 1);
+        service.addDecoder(std::make_unique<SolidDecoder>());
+        service.setReadyCallback([&log](const std::string& path, bool) { log.record(path); });
+
+        //everything is queued in the background, then the list settles on rows 30 to 34
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& path : paths) {
+            service.get(path, ThumbnailService::Priority::BACKGROUND);
+        }
+        service.setVisible({ paths.begin() + 30, paths.begin() + 35 });
+        log.waitFor(images);
+        cold_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        size_t visible_first = 0;
+        {
+            std::lock_guard<std::mutex> lock(log.mutex);
+            //the worker may already have started on one background row
+            for (size_t position = 0; position < 6 && position < log.order.size(); ++position) {
+                for (int row = 30; row < 35; ++row) {
+                    visible_first += log.order[position] == paths[row];
+                }
+            }
+        }
+        std::cout << "Visible rows among the first decoded: " << visible_first << " of 5" << std::endl;
+
+        ThumbnailService::ThumbnailPtr thumbnail = service.get(paths[0]);
+        std::cout << "Thumbnail " << thumbnail->width << "x" << thumbnail->height << ", pixel (127, 95) red " << int(thumbnail->pixels[(95 * 128 + 127) * 3])
+            << " green " << int(thumbnail->pixels[(95 * 128 + 127) * 3 + 1]) << std::endl;
+
+        log.clear();
+        service.get(solid);
+        service.get(broken);
+        log.waitFor(2);
+        ThumbnailService::ThumbnailPtr solid_thumbnail = service.get(solid);
+        std::cout << "Plugged decoder: " << (solid_thumbnail != nullptr) << " green " << int(solid_thumbnail->pixels[1])
+            << ", broken file: " << (service.get(broken) == nullptr) << ", queued again: " << service.pendingRequests() << std::endl;
+
+        ThumbnailService::Statistics statistics = service.statistics();
+        std::cout << "Cold: " << statistics.decodes << " decoded, " << statistics.disk_hits << " from disk, " << statistics.failures << " failed, "
+            << statistics.cached_bytes << " bytes in memory" << std::endl;
+    }
+
+    //a new service finds the downscaled copies on disk instead of decoding again
+    {
+        ThumbnailService service((root / "cache").string(), 128, 10 * 128 * 96 * 3, 2);
+        service.setReadyCallback([&log](const std::string& path, bool) { log.record(path); });
+        log.clear();
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& path : paths) {
+            service.get(path);
+        }
+        log.waitFor(images);
+        double warm_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        ThumbnailService::Statistics statistics = service.statistics();
+        std::cout << "Warm: " << statistics.decodes << " decoded, " << statistics.disk_hits << " from disk, faster than cold: " << (warm_ms < cold_ms) << std::endl;
+        std::cout << "Memory bounded: " << statistics.cached_thumbnails << " thumbnails, " << statistics.cached_bytes << " bytes" << std::endl;
+        log.clear();
+        std::cout << "Most recent kept: " << (service.get(paths[images - 1]) != nullptr) << ", oldest evicted: " << (service.get(paths[0]) == nullptr) << std::endl;
+
+        //the evicted thumbnail comes back from disk
+        log.waitFor(1);
+
+        //an edited image has a new modification time and is decoded again
+        writeImage(paths[5], 99);
+        fs::last_write_time(paths[5], fs::last_write_time(paths[5]) + std::chrono::seconds(5));
+        service.invalidate(paths[5]);
+        log.clear();
+        service.get(paths[5]);
+        log.waitFor(1);
+        std::cout << "Edited image decoded again: " << (service.statistics().decodes == 1) << std::endl;
+    }
+
+    fs::remove_all(root);
+    return 0;
+}
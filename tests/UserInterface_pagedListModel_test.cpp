@@ -0,0 +1,111 @@
+#include "DatabaseManager.hpp"
+#include "UserInterface.hpp"
+#include <iostream>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+//stands in for the GUI thread that CallAfter would deliver the callbacks to
+struct ListView
+{
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t rows_ready = 0;
+    std::optional<size_t> row_count;
+
+    template <typename Predicate>
+    bool waitFor(Predicate predicate)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, std::chrono::seconds(10), predicate);
+    }
+};
+
+int main()
+{
+    const int users = 300000;
+    {
+        DatabaseManager database("test_database.db");
+        database.createTableIfNotExists
+        (
+            "Users",
+            "user_id            INTEGER     PRIMARY KEY     AUTOINCREMENT, "
+            "user_name          TEXT        NOT NULL        UNIQUE,"
+            "user_salt          TEXT        NOT NULL, "
+            "user_passhash      TEXT        NOT NULL, "
+            "user_legalname     TEXT, "
+            "user_phonenumber   TEXT, "
+            "user_emailaddress  TEXT, "
+            "user_description   TEXT, "
+            "user_permission    INTEGER     NOT NULL        DEFAULT 1, "
+            "user_visibility    BOOLEAN     NOT NULL        DEFAULT 1, "
+            "user_timestamp     DATETIME    NOT NULL        DEFAULT CURRENT_TIMESTAMP"
+        );
+        database.executeQuery("PRAGMA journal_mode = WAL;");
+        database.executeQuery(
+            "INSERT INTO Users (user_id, user_name, user_salt, user_passhash, user_visibility) "
+            "WITH RECURSIVE counter (value) AS (SELECT 1 UNION ALL SELECT value + 1 FROM counter WHERE value < " + std::to_string(users) + ") "
+            "SELECT value * 2, printf('user%07d', value * 2), 's', 'h', value % 10 <> 0 FROM counter;");
+    }
+
+    ListView view;
+    PagedListModel::Query query{ "Users", "user_id", "user_name, user_permission", "user_visibility = 1" };
+    PagedListModel model("test_database.db", query, 100, 2, 32);
+    model.setRowsReady([&view](size_t, size_t) {
+        std::lock_guard<std::mutex> lock(view.mutex);
+        ++view.rows_ready;
+        view.changed.notify_all();
+    });
+    model.setCountReady([&view](size_t count) {
+        std::lock_guard<std::mutex> lock(view.mutex);
+        view.row_count = count;
+        view.changed.notify_all();
+    });
+
+    //the first rows arrive long before all 270,000 visible users are counted
+    auto start = std::chrono::steady_clock::now();
+    model.open();
+    view.waitFor([&model] { return model.rowAt(0).has_value(); });
+    double first_rows_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    view.waitFor([&view] { return view.row_count.has_value(); });
+    double counted_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "First rows in under 50 ms: " << (first_rows_ms < 50.0) << ", rows counted: " << model.rowCount().value()
+        << ", first row before count: " << (first_rows_ms <= counted_ms) << std::endl;
+    std::cout << "Row 0: " << model.rowAt(0).value() << std::endl;
+
+    //the hidden users are skipped by the filter, row 250,000 is the 250,001st visible user
+    start = std::chrono::steady_clock::now();
+    model.setVisibleRange(250000, 250030);
+    view.waitFor([&model] { return model.rowAt(250030).has_value(); });
+    double jump_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Row 250000: " << model.rowAt(250000).value() << ", jump in under 50 ms: " << (jump_ms < 50.0) << std::endl;
+    std::cout << "Neighbor cached: " << model.rowAt(250250).has_value() << std::endl;
+
+    //a fast scroll from the top to the bottom, only the window the list stops on is worth reading
+    PagedListModel::Statistics before = model.statistics();
+    for (size_t row = 0; row < 270000; row += 500) {
+        model.setVisibleRange(row, row + 30);
+    }
+    model.setVisibleRange(269970, 269999);
+    view.waitFor([&model] { return model.rowAt(269999).has_value(); });
+    PagedListModel::Statistics after = model.statistics();
+    std::cout << "Last row: " << model.rowAt(269999).value() << ", past the end: " << model.rowAt(270000).has_value() << std::endl;
+    std::cout << "Scroll requested " << 540 << " windows, fetched " << after.pages_fetched - before.pages_fetched << " pages, dropped "
+        << after.fetches_dropped - before.fetches_dropped << ", cached " << after.cached_pages << " of at most 32" << std::endl;
+
+    //reopening after a change counts the new rows
+    {
+        DatabaseManager database("test_database.db");
+        database.executeQuery("INSERT INTO Users (user_id, user_name, user_salt, user_passhash) VALUES (1, 'aaa_first', 's', 'h');");
+    }
+    {
+        std::lock_guard<std::mutex> lock(view.mutex);
+        view.row_count.reset();
+    }
+    model.open();
+    view.waitFor([&view] { return view.row_count.has_value(); });
+    view.waitFor([&model] { return model.rowAt(0).has_value(); });
+    std::cout << "After refresh: " << model.rowCount().value() << " rows, row 0: " << model.rowAt(0).value() << std::endl;
+
+    return 0;
+}